@@ -0,0 +1,95 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Single-pass colour segmentation.
+// ColourClassifier maps each BGR pixel straight to a colour label through a
+// lookup table built once from colour_ranges. ComponentLabeller then finds
+// the connected components of every label in one pass. The per-frame cost
+// does not depend on the number of colours.
+
+#ifndef WALL_FOLLOWER__COLOUR_SEGMENTATION_HPP_
+#define WALL_FOLLOWER__COLOUR_SEGMENTATION_HPP_
+
+#include <opencv2/core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "wall_follower/marker_types.hpp"
+
+
+#define NO_COLOUR	0	// label of pixels that match no colour, colour c is c + 1
+
+class ColourClassifier
+{
+public:
+	// Bits kept per channel, 6 gives a 256 KB table
+	static const int LUT_BITS = 6;
+
+	// Build the table from the HSV ranges of colours 0 .. num_colours-1
+	explicit ColourClassifier(const HsvRange * ranges = colour_ranges, int num_colours = NUM_COLOURS);
+
+	// Label image (CV_8UC1) of a BGR image, or of the roi of it. With
+	// step > 1 only every step-th pixel of every step-th row is classified,
+	// giving a label image (rows + step - 1) / step high.
+	void classify(const cv::Mat & bgr, cv::Mat & labels, int step = 1) const;
+
+	uint8_t label(uint8_t b, uint8_t g, uint8_t r) const
+	{
+		const int shift = 8 - LUT_BITS;
+		return lut_[((b >> shift) << (2 * LUT_BITS)) | ((g >> shift) << LUT_BITS) | (r >> shift)];
+	}
+
+private:
+	std::vector<uint8_t> lut_;
+};
+
+// One 4-connected region of a single label
+struct Component
+{
+	int colour;
+	int area;
+	int left, top, right, bottom;	// inclusive bounding box
+	double sum_x, sum_y;		// for the centroid
+
+	int width() const { return right - left + 1; }
+	int height() const { return bottom - top + 1; }
+	double cx() const { return sum_x / area; }
+	double cy() const { return sum_y / area; }
+};
+
+class ComponentLabeller
+{
+public:
+	// 4-way connected components of all non-zero labels, with statistics.
+	// Pixels are only connected to neighbours with the same label.
+	// labels is rows x cols bytes, step bytes apart; offset_x/y are added
+	// to the coordinates in the results.
+	void label(const uint8_t * labels, int rows, int cols, size_t step,
+		std::vector<Component> & components, int offset_x = 0, int offset_y = 0);
+
+	void label(const cv::Mat & labels, std::vector<Component> & components, int offset_x = 0, int offset_y = 0)
+	{
+		label(labels.ptr<uint8_t>(0), labels.rows, labels.cols, labels.step, components, offset_x, offset_y);
+	}
+
+private:
+	int find(int i);
+	int unite(int a, int b);
+
+	std::vector<int> ids_;
+	std::vector<int> parent_;
+	std::vector<int> index_;
+};
+
+#endif  // WALL_FOLLOWER__COLOUR_SEGMENTATION_HPP_
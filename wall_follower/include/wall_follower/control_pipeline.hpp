@@ -0,0 +1,127 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// The scan to command logic of the wall follower, free of ROS so that the
+// node and the offline benchmark (wall_follower_bench) run the same code.
+
+#ifndef WALL_FOLLOWER__CONTROL_PIPELINE_HPP_
+#define WALL_FOLLOWER__CONTROL_PIPELINE_HPP_
+
+#include <string>
+
+#include "wall_follower/gap_planner.hpp"
+#include "wall_follower/rule_table.hpp"
+#include "wall_follower/scan_filter.hpp"
+#include "wall_follower/sector_reducer.hpp"
+#include "wall_follower/sectors.hpp"
+#include "wall_follower/wall_controller.hpp"
+
+
+#define START_RANGE	0.2	// metres either side of the start position
+#define NEAR_START_RULE	-2	// Command::rule when stopped back at the start
+#define STEER_RULE	-3	// Command::rule for a continuous steering command
+#define EXPLORE_RULE	-4	// Command::rule when heading for a map frontier
+
+// How the velocity command is chosen
+enum class SteeringMode
+{
+	RULES,		// rule table over the sector distances
+	GAP,		// follow-the-gap over the full scan (GapPlanner)
+	WALL_PID	// line fit of the left wall and PD control (WallController)
+};
+
+// Mode named "rules", "gap" or "wall_pid". Returns false for other names.
+bool parse_steering_mode(const std::string & name, SteeringMode & mode);
+
+
+// Detects the robot coming back to where it started, from odometry
+class StartDetector
+{
+public:
+	explicit StartDetector(double range = START_RANGE) : range_(range) {}
+
+	// Feed one odometry position. Returns true on the update where the
+	// robot re-enters the start box after having left it.
+	bool update(double x, double y);
+	bool near_start() const { return near_start_; }
+
+private:
+	double range_;
+	double start_x_ = 0.0, start_y_ = 0.0;
+	bool first_ = true;
+	bool start_moving_ = true;
+	bool near_start_ = false;
+};
+
+struct Command
+{
+	double linear;
+	double angular;
+	int rule;		// index into the rule table, or NEAR_START_RULE
+};
+
+class ControlPipeline
+{
+public:
+	// Sectors FRONT .. FRONT_RIGHT with BEAM_WIDTH, and the default rules
+	ControlPipeline();
+
+	// Half width of each sector in radians
+	void set_beam_width(double half_width);
+	// Quantile used to reduce each sector, 0 for the minimum
+	void set_percentile(double q) { percentile_ = q; }
+
+	// Pre-filter a scan (ScanFilter). Returns the ranges to pass to reduce()
+	// and steer(), which are the input ranges if the filter is disabled.
+	const float * filter(const ScanGeometry & geometry, const float * ranges, float range_min, float range_max)
+	{
+		return filter_.apply(geometry, ranges, range_min, range_max);
+	}
+
+	// Reduce a scan to the NUM_SECTORS sector distances. Returns false if
+	// the scan geometry cannot be used, in which case sectors is untouched.
+	bool reduce(const ScanGeometry & geometry, const float * ranges, float range_min, float range_max,
+		double * sectors);
+
+	void set_steering_mode(SteeringMode mode) { steering_mode_ = mode; }
+	SteeringMode steering_mode() const { return steering_mode_; }
+
+	// Continuous steering command from the full scan, for the modes other
+	// than RULES. Runs with the reduction, on the scan side; stamp is the
+	// scan time in seconds. Returns false if the mode is RULES or the scan
+	// cannot be used.
+	bool steer(const ScanGeometry & geometry, const float * ranges, float range_min, float range_max,
+		double stamp, Command & cmd);
+
+	// Choose the velocity command for the sector distances. steered is the
+	// result of steer() for the same scan, or nullptr if there is none.
+	Command decide(const double * sectors, bool near_start, const Command * steered = nullptr) const;
+
+	ScanFilter & scan_filter() { return filter_; }
+	SectorReducer & reducer() { return reducer_; }
+	GapPlanner & gap_planner() { return gap_planner_; }
+	WallController & wall_controller() { return wall_controller_; }
+	RuleTable & rules() { return rules_; }
+	const RuleTable & rules() const { return rules_; }
+
+private:
+	ScanFilter filter_;
+	SectorReducer reducer_;
+	RuleTable rules_;
+	double percentile_ = 0.0;
+	SteeringMode steering_mode_ = SteeringMode::RULES;
+	GapPlanner gap_planner_;
+	WallController wall_controller_;
+	double last_stamp_ = 0.0;
+};
+
+#endif  // WALL_FOLLOWER__CONTROL_PIPELINE_HPP_
@@ -0,0 +1,106 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Frontiers of an occupancy grid, kept up to date tile by tile.
+// A frontier cell is a free cell next to an unknown one. The grid is split
+// into square tiles, and each map update only re-examines the tiles whose
+// cells changed (and their neighbours, whose edge cells depend on them).
+// Each tile keeps its frontier cell count and the frontier cell nearest
+// their centroid, which serves as the exploration target for that tile.
+//
+// Tiles are aligned to the cells of the first map rather than to the
+// current origin, and each keeps a copy of its cells. When Cartographer
+// grows the map and moves its origin by whole cells, the existing tiles
+// carry over and only those whose cells changed, including cells that
+// have come into the map, are re-examined. A change of resolution, or an
+// origin that moves by a fraction of a cell, starts again.
+
+#ifndef WALL_FOLLOWER__FRONTIER_MAP_HPP_
+#define WALL_FOLLOWER__FRONTIER_MAP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+#define FRONTIER_TILE		32	// cells along a tile side
+#define FRONTIER_FREE		25	// occupancy below which a known cell is free
+#define FRONTIER_MIN_CELLS	8	// frontier cells for a tile to be a target
+#define FRONTIER_OUTSIDE	-128	// a tile cell that is off the map
+
+// The placement of an OccupancyGrid in its frame
+struct GridInfo
+{
+	uint32_t width = 0, height = 0;
+	double resolution = 0.0;
+	double origin_x = 0.0, origin_y = 0.0;	// world position of cell (0, 0), unrotated
+
+	bool operator==(const GridInfo & other) const
+	{
+		return width == other.width && height == other.height && resolution == other.resolution &&
+			origin_x == other.origin_x && origin_y == other.origin_y;
+	}
+	bool operator!=(const GridInfo & other) const { return !(*this == other); }
+};
+
+struct FrontierTile
+{
+	uint32_t cells;		// frontier cells in the tile
+	double x, y;		// target, in the grid frame
+};
+
+class FrontierMap
+{
+public:
+	// Feed one map. data holds width * height occupancy values, row-major
+	// from the origin, -1 for unknown. Returns the number of tiles that
+	// were re-examined.
+	size_t update(const GridInfo & info, const int8_t * data);
+
+	bool empty() const { return tiles_.empty(); }
+	const GridInfo & info() const { return info_; }
+	size_t frontier_cells() const { return frontier_cells_; }
+	size_t size() const { return tiles_.size(); }
+	const FrontierTile & tile(size_t i) const { return tiles_[i].result; }
+
+	// Target of the tile with at least min_cells frontier cells that is
+	// nearest to (x, y) but at least min_distance away, in the grid frame.
+	// Returns false if there is none.
+	bool nearest(double x, double y, double min_distance, double & target_x, double & target_y,
+		uint32_t min_cells = FRONTIER_MIN_CELLS) const;
+
+private:
+	struct Tile
+	{
+		FrontierTile result;
+		int8_t cells[FRONTIER_TILE * FRONTIER_TILE];	// as last seen
+	};
+
+	bool place(const GridInfo & info, long & cell_x, long & cell_y) const;
+	void layout(const GridInfo & info, long cell_x, long cell_y);
+	bool load_tile(size_t i, const int8_t * data);
+	void scan_tile(size_t i, const int8_t * data);
+
+	GridInfo info_;
+	// The first map's cell (0, 0) is cell (0, 0) of the tiling. The current
+	// map's cell (0, 0) is at (cell_x_, cell_y_) in it, and the tiles cover
+	// tile columns tile_x_ .. tile_x_ + tiles_x_ - 1, rows likewise.
+	double anchor_x_ = 0.0, anchor_y_ = 0.0;
+	long cell_x_ = 0, cell_y_ = 0;
+	long tile_x_ = 0, tile_y_ = 0;
+	size_t tiles_x_ = 0, tiles_y_ = 0;
+	std::vector<Tile> tiles_;
+	std::vector<uint8_t> dirty_;
+	size_t frontier_cells_ = 0;
+};
+
+#endif  // WALL_FOLLOWER__FRONTIER_MAP_HPP_
@@ -0,0 +1,64 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Follow-the-gap steering over every beam of the scan.
+// Ranges across the front field of view are clipped to a lookahead, a
+// safety bubble is cut around the nearest obstacle, and the robot steers
+// towards a gap wide enough to drive through. Speed follows the clearance
+// ahead, so the robot runs faster than LINEAR_VELOCITY in open corridors and
+// slows smoothly instead of stopping to spin.
+
+#ifndef WALL_FOLLOWER__GAP_PLANNER_HPP_
+#define WALL_FOLLOWER__GAP_PLANNER_HPP_
+
+#include <vector>
+
+#include "wall_follower/sector_reducer.hpp"
+#include "wall_follower/sectors.hpp"
+
+
+struct GapConfig
+{
+	double half_fov = 90.0 * DEG2RAD;	// field of view either side of the front
+	double lookahead = 2.0;		// metres, ranges are clipped to this
+	double safety_radius = 0.2;	// metres, robot half width plus margin
+	double clearance = 0.45;	// metres, nearer beams are not part of a gap
+	double stop_distance = 0.25;	// front clearance at which linear reaches 0
+	double max_linear = 0.5;
+	double max_angular = ANGULAR_VELOCITY;
+	double heading_gain = 1.5;	// rad/s per rad of heading error
+	double smoothing = 0.5;		// weight of the previous angular command
+	bool prefer_left = true;	// take the leftmost passable gap, to keep
+					// following the left wall through the maze
+};
+
+class GapPlanner
+{
+public:
+	GapPlanner() { configure(GapConfig()); }
+
+	void configure(const GapConfig & config);
+	const GapConfig & config() const { return config_; }
+
+	// Velocity command for one scan. Returns false if the scan geometry
+	// cannot be used.
+	bool plan(const ScanGeometry & geometry, const float * ranges, float range_min, float range_max,
+		double & linear, double & angular);
+
+private:
+	GapConfig config_;
+	BeamFan fan_;
+	std::vector<float> work_;
+	double angular_ = 0.0;
+};
+
+#endif  // WALL_FOLLOWER__GAP_PLANNER_HPP_
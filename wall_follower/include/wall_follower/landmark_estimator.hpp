@@ -0,0 +1,72 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Position estimate of one marker in constant memory, the same estimator as
+// Landmark in wall_follower/landmark.py.
+// The first observations are averaged with Welford's algorithm, which turns
+// into an exponentially weighted mean and covariance after 1/alpha
+// observations. Observations outside a Mahalanobis gate are rejected, and a
+// run of rejections restarts the estimate.
+
+#ifndef WALL_FOLLOWER__LANDMARK_ESTIMATOR_HPP_
+#define WALL_FOLLOWER__LANDMARK_ESTIMATOR_HPP_
+
+#include <cstdint>
+
+
+#define GATE_99		9.21	// chi-square 99% point, 2 degrees of freedom
+
+struct LandmarkConfig
+{
+	double alpha = 0.05;
+	double gate = GATE_99;
+	uint32_t min_count = 5;		// observations before gating starts
+	uint32_t max_rejects = 10;	// rejections in a row before restarting
+	double min_sigma = 0.05;	// observation noise floor, metres
+	double min_change = 0.01;	// metres before the shown position moves
+};
+
+class LandmarkEstimator
+{
+public:
+	explicit LandmarkEstimator(const LandmarkConfig & config = LandmarkConfig());
+
+	// Add an observation. Returns true if the shown position changed, false
+	// if the observation was rejected or moved it less than min_change.
+	bool update(double x, double y);
+	void reset();
+
+	// Start from a saved estimate
+	void restore(uint32_t count, double x, double y, double cov_xx, double cov_xy, double cov_yy);
+
+	// Squared Mahalanobis distance of a point from the estimate
+	double mahalanobis2(double x, double y) const;
+
+	bool seen() const { return seen_; }
+	uint32_t count() const { return count_; }
+	double x() const { return shown_x_; }
+	double y() const { return shown_y_; }
+	double cov_xx() const { return var_xx_; }
+	double cov_xy() const { return var_xy_; }
+	double cov_yy() const { return var_yy_; }
+
+private:
+	LandmarkConfig config_;
+	bool seen_ = false;
+	uint32_t count_ = 0;
+	uint32_t rejects_ = 0;
+	double mean_x_ = 0.0, mean_y_ = 0.0;
+	double var_xx_ = 0.0, var_xy_ = 0.0, var_yy_ = 0.0;
+	double shown_x_ = 0.0, shown_y_ = 0.0;
+};
+
+#endif  // WALL_FOLLOWER__LANDMARK_ESTIMATOR_HPP_
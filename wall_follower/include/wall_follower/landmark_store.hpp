@@ -0,0 +1,99 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Landmark snapshot file, the same format as wall_follower/landmark_store.py.
+// A 16 byte header is followed by one fixed 64 byte record per marker type,
+// little-endian. The file is memory mapped and only the records that changed
+// are rewritten, from a background thread, so saving never holds up
+// observation handling. Records with a bad CRC are ignored on load.
+
+#ifndef WALL_FOLLOWER__LANDMARK_STORE_HPP_
+#define WALL_FOLLOWER__LANDMARK_STORE_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+#define LANDMARK_STORE_VERSION	1
+
+struct LandmarkStoreHeader
+{
+	char magic[4];		// "WFLM"
+	uint32_t version;
+	uint32_t num_records;
+	uint32_t record_size;
+};
+
+struct LandmarkRecord
+{
+	uint32_t type;
+	uint32_t count;		// 0 for a landmark never seen
+	double x, y;
+	double cov_xx, cov_xy, cov_yy;
+	double stamp;		// time of the last update, seconds, on the clock of the writer
+	uint32_t reserved;
+	uint32_t crc;		// CRC-32 (zlib) of the bytes before it
+};
+
+static_assert(sizeof(LandmarkStoreHeader) == 16, "LandmarkStoreHeader layout");
+static_assert(sizeof(LandmarkRecord) == 64, "LandmarkRecord layout");
+
+class LandmarkStore
+{
+public:
+	~LandmarkStore();
+
+	// Map the file, creating or re-initialising it if it does not match.
+	// Returns false and sets error() on failure.
+	bool open(const std::string & path, uint32_t num_records);
+	const std::string & error() const { return error_; }
+
+	// Records with a valid CRC and a non-zero count
+	std::vector<LandmarkRecord> load() const;
+
+	// Queue a record to be written. Only takes a short lock.
+	void update(const LandmarkRecord & record);
+
+	// Write the queued records every period on a background thread
+	void start(std::chrono::milliseconds period);
+
+	// Stop the thread, write anything still queued and unmap the file
+	void close();
+
+private:
+	void write_pending();
+	void writer_loop();
+
+	uint8_t * map_ = nullptr;
+	size_t size_ = 0;
+	uint32_t num_records_ = 0;
+	std::string error_;
+
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::map<uint32_t, LandmarkRecord> pending_;
+	bool stopping_ = false;
+	std::chrono::milliseconds period_{1000};
+	std::thread writer_;
+};
+
+// CRC-32 as computed by zlib.crc32()
+uint32_t crc32(const void * data, size_t size);
+
+#endif  // WALL_FOLLOWER__LANDMARK_STORE_HPP_
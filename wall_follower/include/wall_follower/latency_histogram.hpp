@@ -0,0 +1,62 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Lock-free latency histogram with HDR-style log-linear buckets.
+// Each power of two is split into 16 buckets, so a reported percentile is
+// within 1/16 (6.25%) of the true value. Recording is a couple of relaxed
+// atomic adds and can be done from any thread.
+
+#ifndef WALL_FOLLOWER__LATENCY_HISTOGRAM_HPP_
+#define WALL_FOLLOWER__LATENCY_HISTOGRAM_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+// Latencies over one reporting interval, all in nanoseconds
+struct LatencySummary
+{
+	uint64_t count;
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t max;
+};
+
+class LatencyHistogram
+{
+public:
+	static const int SUB_BUCKET_BITS = 4;
+	static const int MAX_EXPONENT = 40;		// values are clamped to 2^41 ns (~36 min)
+	static const size_t SUB_BUCKETS = (size_t) 1 << SUB_BUCKET_BITS;
+	static const size_t NUM_BUCKETS = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	LatencyHistogram();
+
+	// Record one latency, negative values count as zero
+	void record(int64_t ns);
+
+	// Summarise the values recorded since the last call and start a new
+	// interval. Values recorded while this runs land in one interval or
+	// the other.
+	LatencySummary take();
+
+	static size_t bucket_index(uint64_t value);
+	// Largest value that falls in bucket i
+	static uint64_t bucket_upper(size_t i);
+
+private:
+	std::atomic<uint64_t> counts_[NUM_BUCKETS];
+	std::atomic<uint64_t> max_;
+};
+
+#endif  // WALL_FOLLOWER__LATENCY_HISTOGRAM_HPP_
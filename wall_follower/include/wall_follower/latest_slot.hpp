@@ -0,0 +1,82 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Single-slot mailbox that keeps only the newest value. A producer that is
+// faster than the consumer replaces the waiting value instead of queueing
+// behind it, so the consumer always works on the latest data.
+
+#ifndef WALL_FOLLOWER__LATEST_SLOT_HPP_
+#define WALL_FOLLOWER__LATEST_SLOT_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+
+template<typename T>
+class LatestSlot
+{
+public:
+	// Store a value, replacing any the consumer has not taken yet
+	void put(T value)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (full_)
+				dropped_++;
+			value_ = std::move(value);
+			full_ = true;
+		}
+		cv_.notify_one();
+	}
+
+	// Wait for a value. Returns false once close() has been called.
+	bool take(T & value)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_.wait(lock, [this] {return closed_ || full_;});
+		if (closed_)
+			return false;
+		value = std::move(value_);
+		value_ = T();
+		full_ = false;
+		return true;
+	}
+
+	// Wake the consumer and make every later take() fail
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			closed_ = true;
+		}
+		cv_.notify_all();
+	}
+
+	// Values replaced before they were taken
+	uint64_t dropped()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return dropped_;
+	}
+
+private:
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	T value_ = T();
+	bool full_ = false;
+	bool closed_ = false;
+	uint64_t dropped_ = 0;
+};
+
+#endif  // WALL_FOLLOWER__LATEST_SLOT_HPP_
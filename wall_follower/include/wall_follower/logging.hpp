@@ -0,0 +1,35 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Logging policy for the control path:
+//  - WF_TRACE is for per-scan / per-tick detail. It logs at DEBUG level and
+//    is compiled out completely unless WALL_FOLLOWER_TICK_TRACE is defined
+//    (CMake option of the same name, off for Release builds).
+//  - Periodic state (pose, distances) uses the RCLCPP_*_THROTTLE macros
+//    with WF_STATE_PERIOD_MS.
+//  - Behaviour changes are logged once, when they happen.
+
+#ifndef WALL_FOLLOWER__LOGGING_HPP_
+#define WALL_FOLLOWER__LOGGING_HPP_
+
+#include <rclcpp/logging.hpp>
+
+
+#define WF_STATE_PERIOD_MS	2000
+
+#ifdef WALL_FOLLOWER_TICK_TRACE
+#define WF_TRACE(logger, ...)	RCLCPP_DEBUG(logger, __VA_ARGS__)
+#else
+#define WF_TRACE(logger, ...)	do {} while (0)
+#endif
+
+#endif  // WALL_FOLLOWER__LOGGING_HPP_
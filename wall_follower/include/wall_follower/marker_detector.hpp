@@ -0,0 +1,109 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Colour marker detection, ported from scripts/see_marker.py.
+// A marker is a pink blob vertically aligned with a blue, green or yellow
+// blob. The range to a marker comes from the height of its colour blob.
+//
+// In tracking mode, once a marker has been found only a region around it is
+// segmented in the following frames. The whole frame is searched again every
+// full_search_period frames, or as soon as the marker is lost or reaches the
+// edge of the region.
+//
+// Blobs can be searched for on a subsampled level of the image. The box of
+// each blob found there is then segmented again at full resolution, so the
+// height used for the range keeps full-resolution precision.
+
+#ifndef WALL_FOLLOWER__MARKER_DETECTOR_HPP_
+#define WALL_FOLLOWER__MARKER_DETECTOR_HPP_
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+#include "wall_follower/colour_segmentation.hpp"
+#include "wall_follower/marker_types.hpp"
+
+
+#define FIELD_OF_VIEW_H	62.2	// degrees
+#define FIELD_OF_VIEW_V	48.8
+
+// Largest connected component of one colour
+struct Blob
+{
+	double cx, cy;		// centroid, pixels
+	int h;			// bounding box height, pixels
+	double distance;	// metres, from the height
+	double angle;		// degrees anticlockwise from the optical axis, 0-360
+};
+
+struct MarkerDetection
+{
+	int type;		// index into marker_type
+	double x, y;		// camera_link frame, metres
+};
+
+#define ROI_MARGIN		40	// pixels added around the last detection
+#define FULL_SEARCH_PERIOD	15	// frames between full-frame searches
+
+class MarkerDetector
+{
+public:
+	// Find the markers in a BGR image
+	void detect(const cv::Mat & image, std::vector<MarkerDetection> & detections);
+
+	void set_tracking(bool enable, int roi_margin = ROI_MARGIN, int full_search_period = FULL_SEARCH_PERIOD);
+
+	// Search on 1/2^level resolution, 0 for full resolution
+	void set_pyramid_level(int level);
+
+	// Region segmented by the last call to detect()
+	const cv::Rect & last_roi() const { return last_roi_; }
+
+	// Range and bearing of a blob, as in get_stats() in see_marker.py
+	static Blob make_blob(double cx, double cy, int w, int h);
+
+private:
+	// Label every pixel of roi at the search resolution and find the
+	// largest component of each colour, in one pass over the image
+	void segment(const cv::Mat & image, const cv::Rect & roi);
+
+	// Largest component of a colour in the last segment(), in full
+	// resolution frame coordinates
+	bool blob_component(const cv::Mat & image, const cv::Rect & roi, int colour, Component & comp);
+
+	// Detect within roi. Returns false if nothing was found or a blob that
+	// was used touches an edge of roi that is not an edge of the frame.
+	bool search(const cv::Mat & image, const cv::Rect & roi, std::vector<MarkerDetection> & detections,
+		cv::Rect & bounds);
+
+	ColourClassifier classifier_;
+	ComponentLabeller labeller_;
+	cv::Mat labels_;
+	std::vector<Component> components_;
+	int largest_[NUM_COLOURS];	// index into components_, or -1
+
+	// Search resolution
+	int scale_ = 1;
+	cv::Mat refine_labels_;
+	std::vector<Component> refine_components_;
+
+	// Tracking
+	bool tracking_ = false;
+	int roi_margin_ = ROI_MARGIN;
+	int full_search_period_ = FULL_SEARCH_PERIOD;
+	int frames_since_full_ = 0;
+	cv::Rect track_;		// bounding box of the last detections, empty if none
+	cv::Rect last_roi_;
+};
+
+#endif  // WALL_FOLLOWER__MARKER_DETECTOR_HPP_
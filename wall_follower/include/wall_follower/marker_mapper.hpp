@@ -0,0 +1,104 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Marker detection and mapping in one node, replacing the
+// see_marker -> /marker_position -> point_transformer.py chain.
+// Markers are detected in the camera image, transformed into the map frame
+// through the node's own tf2 buffer and folded into a LandmarkEstimator per
+// marker type. All the landmarks seen so far are published as a
+// LandmarkArray whenever one of them moves.
+//
+// With compatibility_topics set, the node also publishes what the old
+// nodes did: each detection on marker_position and the changed markers on
+// visualization_marker_array.
+//
+// With snapshot_file set, the landmarks are saved to that file as they
+// change (see LandmarkStore) and loaded from it at startup.
+
+#ifndef WALL_FOLLOWER__MARKER_MAPPER_HPP_
+#define WALL_FOLLOWER__MARKER_MAPPER_HPP_
+
+#include <geometry_msgs/msg/point_stamped.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/msg/image.hpp>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
+#include <visualization_msgs/msg/marker_array.hpp>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wall_follower/landmark_estimator.hpp"
+#include "wall_follower/landmark_store.hpp"
+#include "wall_follower/latest_slot.hpp"
+#include "wall_follower/marker_detector.hpp"
+#include "wall_follower/msg/landmark_array.hpp"
+
+
+class MarkerMapper : public rclcpp::Node
+{
+public:
+	explicit MarkerMapper(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
+	~MarkerMapper();
+
+private:
+	// ROS topic publishers
+	rclcpp::Publisher<wall_follower::msg::LandmarkArray>::SharedPtr landmarks_pub_;
+	rclcpp::Publisher<geometry_msgs::msg::PointStamped>::SharedPtr point_pub_;
+	rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr marker_pub_;
+
+	// ROS topic subscribers
+	rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr image_sub_;
+
+	// ROS timers
+	rclcpp::TimerBase::SharedPtr publish_timer_;
+
+	// Transforms into the map frame. The buffer and listener are created on
+	// the first camera frame, before it is handed to the worker.
+	std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
+	std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+	std::string map_frame_;
+	std::string camera_frame_;
+
+	// Latest frame, waiting for the worker
+	LatestSlot<sensor_msgs::msg::Image::ConstSharedPtr> frames_;
+	std::thread worker_;
+
+	// Only used by the worker, the detector is created on the first frame
+	std::unique_ptr<MarkerDetector> detector_;
+	std::vector<MarkerDetection> detections_;
+	bool tracking_;
+	int roi_margin_;
+	int full_search_period_;
+	int pyramid_level_;
+
+	// Shared by the worker and the publish timer
+	std::mutex landmarks_mutex_;
+	std::vector<LandmarkEstimator> landmarks_;
+	std::vector<bool> changed_;
+
+	bool compatibility_topics_;
+	bool snapshot_;
+	LandmarkStore store_;
+
+	// Function prototypes
+	void image_callback(const sensor_msgs::msg::Image::ConstSharedPtr msg);
+	void worker_loop();
+	void process_frame(const sensor_msgs::msg::Image::ConstSharedPtr & msg);
+	void publish_callback();
+	void load_snapshot(const std::string & path, double period);
+	void add_markers(int type, const LandmarkEstimator & landmark, visualization_msgs::msg::MarkerArray & markers);
+};
+#endif  // WALL_FOLLOWER__MARKER_MAPPER_HPP_
@@ -0,0 +1,48 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Marker colours and types, matching wall_follower/landmark.py.
+// The index of a marker type is what is sent in point.z on marker_position.
+
+#ifndef WALL_FOLLOWER__MARKER_TYPES_HPP_
+#define WALL_FOLLOWER__MARKER_TYPES_HPP_
+
+#include <cstdint>
+
+
+enum MarkerColour
+{
+	PINK,
+	BLUE,
+	GREEN,
+	YELLOW,
+	NUM_COLOURS
+};
+
+// Inclusive OpenCV HSV bounds (H 0-179, S and V 0-255)
+struct HsvRange
+{
+	uint8_t lower[3];
+	uint8_t upper[3];
+};
+
+#define MAX_MARKERS	6
+
+extern const char * const colour_names[NUM_COLOURS];
+extern const HsvRange colour_ranges[NUM_COLOURS];
+extern const char * const marker_type[MAX_MARKERS];
+
+// Index into marker_type of a marker with colour top above colour bottom,
+// or -1 if there is no such marker
+int marker_index(int top, int bottom);
+
+#endif  // WALL_FOLLOWER__MARKER_TYPES_HPP_
@@ -0,0 +1,34 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Latency compensation for the sector distances.
+// A scan describes the world as it was at its header stamp, but the command
+// chosen from it takes effect later. Given the robot's velocity, the sectors
+// are moved forward to the command time: the nearest point of each sector is
+// carried through the arc the robot drives at constant twist, then read back
+// as a distance at the sector's new bearing.
+
+#ifndef WALL_FOLLOWER__MOTION_COMPENSATION_HPP_
+#define WALL_FOLLOWER__MOTION_COMPENSATION_HPP_
+
+#include "wall_follower/sectors.hpp"
+
+
+#define COMPENSATION_HORIZON	0.3	// seconds, longest extrapolation allowed
+
+// Predict the NUM_SECTORS distances dt seconds after they were measured,
+// for a robot driving at linear (m/s) and angular (rad/s). Sectors at
+// range_max saw nothing and stay open. dt is clamped to [0, horizon].
+void predict_sectors(const double * sectors, double linear, double angular, double dt, double range_max,
+	double horizon, double * out);
+
+#endif  // WALL_FOLLOWER__MOTION_COMPENSATION_HPP_
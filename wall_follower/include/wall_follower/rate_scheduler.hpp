@@ -0,0 +1,55 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Adaptive period for the timer-driven control loop.
+// The loop runs at fast_period when an obstacle ahead is near or the robot
+// is fast, at slow_period in open space at low speed, and at idle_period
+// once the robot has stopped. A new period is only reported when it moves
+// by more than a hysteresis fraction, so the timer is not recreated on
+// every tick.
+
+#ifndef WALL_FOLLOWER__RATE_SCHEDULER_HPP_
+#define WALL_FOLLOWER__RATE_SCHEDULER_HPP_
+
+
+#define CONTROL_PERIOD	0.1	// seconds, the fixed control period
+
+struct RateConfig
+{
+	double fast_period = 0.05;	// seconds, matches the lidar at best
+	double slow_period = 0.2;
+	double idle_period = 1.0;
+	double near_distance = 0.5;	// metres in front at which the loop runs fastest
+	double far_distance = 1.5;	// metres in front beyond which distance doesn't matter
+	double fast_speed = 0.3;	// m/s at which the loop runs fastest
+	double hysteresis = 0.25;	// fraction the period must move by to be reported
+};
+
+class RateScheduler
+{
+public:
+	RateScheduler() { configure(RateConfig()); }
+
+	void configure(const RateConfig & config);
+	const RateConfig & config() const { return config_; }
+	double period() const { return period_; }
+
+	// Feed the state after one control tick. Returns true if period()
+	// changed and the timer should be rescheduled.
+	bool update(double front, double speed, bool stopped);
+
+private:
+	RateConfig config_;
+	double period_ = CONTROL_PERIOD;
+};
+
+#endif  // WALL_FOLLOWER__RATE_SCHEDULER_HPP_
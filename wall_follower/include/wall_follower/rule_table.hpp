@@ -0,0 +1,76 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Table-driven wall following behaviour.
+// Each rule compares one sector distance with a threshold. The first rule
+// that holds gives the velocity command; if none holds the fallback rule is
+// used. The default table is the original left-wall-following ladder.
+
+#ifndef WALL_FOLLOWER__RULE_TABLE_HPP_
+#define WALL_FOLLOWER__RULE_TABLE_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+enum class RuleCondition
+{
+	LESS,		// sector distance < threshold
+	GREATER		// sector distance > threshold
+};
+
+struct Rule
+{
+	std::string name;
+	int sector;
+	RuleCondition condition;
+	double threshold;
+	double linear;
+	double angular;
+};
+
+// Sector names as used in parameters, e.g. "LEFT_FRONT"
+const char * sector_name(int sector);
+// Index of a named sector, or -1 if the name is not known
+int sector_index(const std::string & name);
+
+
+class RuleTable
+{
+public:
+	RuleTable();
+
+	// Replace the rules. fallback is used when no rule holds, only its
+	// name, linear and angular values are used.
+	void set_rules(const std::vector<Rule> & rules, const Rule & fallback);
+
+	// Index of the first rule that holds for the sector distances, or
+	// size() if the fallback applies
+	size_t evaluate(const double * sectors) const;
+
+	// Rule i, where i == size() is the fallback
+	const Rule & rule(size_t i) const { return i < rules_.size() ? rules_[i] : fallback_; }
+	// Human readable form of rule i, built once when the rules are set
+	const std::string & description(size_t i) const { return descriptions_[i]; }
+	size_t size() const { return rules_.size(); }
+
+	static std::vector<Rule> default_rules();
+	static Rule default_fallback();
+
+private:
+	std::vector<Rule> rules_;
+	Rule fallback_;
+	std::vector<std::string> descriptions_;
+};
+
+#endif  // WALL_FOLLOWER__RULE_TABLE_HPP_
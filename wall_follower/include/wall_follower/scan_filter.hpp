@@ -0,0 +1,63 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Range pre-filter, run on each scan before sector reduction and steering.
+// An isolated beam that disagrees with both neighbours by more than a
+// threshold is replaced by their median (spatial spike rejection), then each
+// beam is replaced by the median of its last depth readings. The history is
+// a ring of depth rows of num_ranges floats, one row per scan, so every step
+// is a flat loop over contiguous beams that the compiler can vectorise.
+// Buffers are only resized when the scan geometry or the depth changes.
+
+#ifndef WALL_FOLLOWER__SCAN_FILTER_HPP_
+#define WALL_FOLLOWER__SCAN_FILTER_HPP_
+
+#include <cstddef>
+#include <vector>
+
+#include "wall_follower/sector_reducer.hpp"
+
+
+#define SCAN_FILTER_MAX_DEPTH	9	// scans in the temporal median
+
+struct ScanFilterConfig
+{
+	int depth = 1;			// odd number of scans in the median, 1 disables it
+	double spike_threshold = 0.0;	// metres, 0 disables spike rejection
+};
+
+class ScanFilter
+{
+public:
+	// Clears the history; depth is rounded down to an odd number in
+	// [1, SCAN_FILTER_MAX_DEPTH]
+	void configure(const ScanFilterConfig & config);
+	const ScanFilterConfig & config() const { return config_; }
+	bool enabled() const { return config_.depth > 1 || config_.spike_threshold > 0.0; }
+
+	// Filter one scan. Returns the filtered ranges (num_ranges values owned
+	// by the filter, valid until the next call), or ranges itself when the
+	// filter is disabled. Readings outside [range_min, range_max] come out
+	// as +inf, which the reduction and the planners treat as invalid.
+	const float * apply(const ScanGeometry & geometry, const float * ranges, float range_min, float range_max);
+
+private:
+	ScanFilterConfig config_;
+	size_t num_ranges_ = 0;
+	size_t head_ = 0;		// history row the next scan is written to
+	bool primed_ = false;
+	std::vector<float> history_;	// depth rows of num_ranges
+	std::vector<float> sort_;	// depth rows, sorted in place each scan
+	std::vector<float> out_;
+};
+
+#endif  // WALL_FOLLOWER__SCAN_FILTER_HPP_
@@ -0,0 +1,140 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Sector reduction kernels for LaserScan ranges.
+// A sector is a window of beams around a centre angle. Its beam indices are
+// computed from the scan geometry and cached until the geometry changes, so
+// reducing a scan is a straight pass over contiguous memory with no bounds
+// checks or branches, whatever the beam count of the lidar.
+
+#ifndef WALL_FOLLOWER__SECTOR_REDUCER_HPP_
+#define WALL_FOLLOWER__SECTOR_REDUCER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Half-open range of beam indices [begin, end)
+struct BeamSpan
+{
+	uint32_t begin;
+	uint32_t end;
+};
+
+// The part of a LaserScan that determines which beam is at which angle
+struct ScanGeometry
+{
+	double angle_min = 0.0;
+	double angle_increment = 0.0;
+	size_t num_ranges = 0;
+
+	bool operator==(const ScanGeometry & other) const
+	{
+		return angle_min == other.angle_min && angle_increment == other.angle_increment &&
+			num_ranges == other.num_ranges;
+	}
+	bool operator!=(const ScanGeometry & other) const { return !(*this == other); }
+};
+
+// A sector that wraps past the last beam is split into two spans
+struct Sector
+{
+	BeamSpan span[2];
+	uint32_t num_spans;
+};
+
+// Minimum of the valid ranges in a span. NaN, inf and readings outside
+// [range_min, range_max] are masked to range_max, so an empty or fully
+// invalid span returns range_max.
+float sector_min(const float * ranges, BeamSpan span, float range_min, float range_max);
+
+// Copy the valid ranges of a span to out, returning the number copied.
+// out must have room for span.end - span.begin values.
+size_t sector_compact(const float * ranges, BeamSpan span, float range_min, float range_max, float * out);
+
+
+class SectorReducer
+{
+public:
+	// Set the sector layout: num_sectors sectors centred on centres[]
+	// (radians, in the scan frame) extending half_width either side.
+	// The index tables are built by the next call to update().
+	void set_sectors(const double * centres, size_t num_sectors, double half_width);
+
+	// Make the index tables match the scan geometry. They are only rebuilt
+	// when the geometry differs from the previous call. Returns false if
+	// the geometry cannot be used (e.g. no beams), in which case the
+	// reducer must not be used on that scan.
+	bool update(const ScanGeometry & geometry);
+
+	bool configured() const { return valid_; }
+	const ScanGeometry & geometry() const { return geometry_; }
+	size_t rebuilds() const { return rebuilds_; }
+	size_t size() const { return centres_.size(); }
+	const Sector & sector(size_t i) const { return sectors_[i]; }
+
+	// Minimum valid range in each sector, written to out[0 .. size()-1]
+	void reduce_min(const float * ranges, float range_min, float range_max, double * out) const;
+
+	// q-th quantile (0 <= q <= 1) of the valid ranges in each sector.
+	// q = 0 gives the same result as reduce_min().
+	void reduce_percentile(const float * ranges, float range_min, float range_max, double q,
+		double * out);
+
+private:
+	bool build(const ScanGeometry & geometry);
+
+	std::vector<double> centres_;
+	double half_width_ = 0.0;
+
+	ScanGeometry geometry_;
+	bool stale_ = true;
+	bool valid_ = false;
+	size_t rebuilds_ = 0;
+	std::vector<Sector> sectors_;
+	std::vector<float> scratch_;
+};
+
+
+// The beams across an angular window, in angle order, for planners that
+// walk the scan beam by beam rather than by sector. Like the sector
+// tables, the index list is only rebuilt when the scan geometry changes.
+class BeamFan
+{
+public:
+	// Window from first to last (radians, scan frame, first < last)
+	void set_window(double first, double last);
+
+	// Rebuild for the geometry if needed. Returns false if the geometry
+	// cannot be used.
+	bool update(const ScanGeometry & geometry);
+
+	size_t size() const { return index_.size(); }
+	// Beam at step i, or -1 if the scan has no beam at that angle
+	int32_t index(size_t i) const { return index_[i]; }
+	// Angle of step i
+	double angle(size_t i) const { return first_ + i * step_; }
+	double step() const { return step_; }
+
+private:
+	bool build(const ScanGeometry & geometry);
+
+	double first_ = 0.0, last_ = 0.0;
+	double step_ = 0.0;
+	ScanGeometry geometry_;
+	bool stale_ = true;
+	bool valid_ = false;
+	std::vector<int32_t> index_;
+};
+
+#endif  // WALL_FOLLOWER__SECTOR_REDUCER_HPP_
@@ -0,0 +1,45 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// The named scan sectors and velocity limits used by the wall follower.
+// Kept free of ROS headers so the control logic can be built on its own.
+
+#ifndef WALL_FOLLOWER__SECTORS_HPP_
+#define WALL_FOLLOWER__SECTORS_HPP_
+
+#include <cmath>
+
+
+#define DEG2RAD (M_PI / 180.0)
+#define RAD2DEG (180.0 / M_PI)
+
+#define FRONT		0
+#define FRONT_LEFT	1
+#define LEFT_FRONT	2
+#define LEFT		3
+#define LEFT_BACK	4
+#define BACK_LEFT	5
+#define BACK		6
+#define BACK_RIGHT	7
+#define RIGHT_BACK	8
+#define RIGHT		9
+#define RIGHT_FRONT	10
+#define FRONT_RIGHT	11
+
+#define NUM_SECTORS	12
+#define SECTOR_SPACING	30	// degrees between sector centres, FRONT at 0
+#define BEAM_WIDTH	10	// degrees either side of a sector centre
+
+#define LINEAR_VELOCITY  0.3
+#define ANGULAR_VELOCITY 1.5
+
+#endif  // WALL_FOLLOWER__SECTORS_HPP_
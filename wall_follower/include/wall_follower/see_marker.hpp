@@ -0,0 +1,71 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// C++ version of scripts/see_marker.py. Subscribes to the camera and
+// publishes each marker seen on marker_position, in camera_link, with the
+// marker type index in point.z.
+//
+// Frames are taken from a best-effort, keep-last-1 subscription and handed to
+// a worker thread through a single slot. A frame that arrives while the
+// previous one is still being processed replaces the one waiting, so the
+// detector always works on the newest frame and never falls behind.
+
+#ifndef WALL_FOLLOWER__SEE_MARKER_HPP_
+#define WALL_FOLLOWER__SEE_MARKER_HPP_
+
+#include <geometry_msgs/msg/point_stamped.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/msg/image.hpp>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wall_follower/latest_slot.hpp"
+#include "wall_follower/marker_detector.hpp"
+
+
+class SeeMarker : public rclcpp::Node
+{
+public:
+	explicit SeeMarker(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
+	~SeeMarker();
+
+private:
+	// ROS topic publishers
+	rclcpp::Publisher<geometry_msgs::msg::PointStamped>::SharedPtr point_pub_;
+
+	// ROS topic subscribers
+	rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr image_sub_;
+
+	// Latest frame, waiting for the worker
+	LatestSlot<sensor_msgs::msg::Image::ConstSharedPtr> frames_;
+	std::thread worker_;
+
+	// Variables, only used by the worker. The detector is created on the
+	// first frame, so that a node started before the camera costs nothing.
+	std::unique_ptr<MarkerDetector> detector_;
+	std::vector<MarkerDetection> detections_;
+	std::string camera_frame_;
+	bool display_;
+	bool tracking_;
+	int roi_margin_;
+	int full_search_period_;
+	int pyramid_level_;
+
+	// Function prototypes
+	void image_callback(const sensor_msgs::msg::Image::ConstSharedPtr msg);
+	void worker_loop();
+	void process_frame(const sensor_msgs::msg::Image::ConstSharedPtr & msg);
+};
+#endif  // WALL_FOLLOWER__SEE_MARKER_HPP_
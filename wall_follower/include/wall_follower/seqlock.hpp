@@ -0,0 +1,64 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Single-writer sequence lock for passing small snapshots between callback
+// groups without a mutex. The writer never waits; a reader retries only if
+// it raced with a write, so a slow reader cannot hold up the writer.
+
+#ifndef WALL_FOLLOWER__SEQLOCK_HPP_
+#define WALL_FOLLOWER__SEQLOCK_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+template<typename T>
+class SeqLock
+{
+	static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+	SeqLock() : seq_(0), data_() {}
+
+	// Only one thread may call store()
+	void store(const T & value)
+	{
+		uint32_t seq = seq_.load(std::memory_order_relaxed);
+		seq_.store(seq + 1, std::memory_order_relaxed);		// odd: write in progress
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(&data_, &value, sizeof(T));
+		seq_.store(seq + 2, std::memory_order_release);
+	}
+
+	// Any number of threads may call load()
+	T load() const
+	{
+		T value;
+		uint32_t before, after;
+		do
+		{
+			before = seq_.load(std::memory_order_acquire);
+			std::memcpy(&value, &data_, sizeof(T));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = seq_.load(std::memory_order_relaxed);
+		} while ((before & 1) || before != after);
+		return value;
+	}
+
+private:
+	std::atomic<uint32_t> seq_;
+	T data_;
+};
+
+#endif  // WALL_FOLLOWER__SEQLOCK_HPP_
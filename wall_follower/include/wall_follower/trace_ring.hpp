@@ -0,0 +1,113 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Binary trace of control decisions, the same format as
+// scripts/decode_trace.py. A 64 byte header and a table of the rule names,
+// by rule index, are followed by a ring of fixed 128 byte records, one per
+// control tick, little-endian. The file is memory
+// mapped and a record is a plain copy into the mapping, with no formatting,
+// system call or flush, so tracing costs nanoseconds per tick and whatever
+// was written survives a crash of the process.
+//
+// A record's seq is cleared while it is being written and set last, so a
+// reader skips a record torn by a crash. Reopening a matching file carries on
+// after the newest record rather than clearing it, and each open is a new
+// run. The rule names are part of the match, so the records in a file were
+// all numbered by the same rule table.
+
+#ifndef WALL_FOLLOWER__TRACE_RING_HPP_
+#define WALL_FOLLOWER__TRACE_RING_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "wall_follower/sectors.hpp"
+
+
+#define TRACE_RING_VERSION	2
+#define TRACE_RING_RECORDS	65536	// default capacity, 8 MiB, about 1.8 hours at 10 Hz
+#define TRACE_RULE_NAMES	32	// entries in the rule name table
+#define TRACE_RULE_NAME_SIZE	32	// bytes per name, NUL padded, longer names are cut
+
+// TraceRecord::flags
+#define TRACE_NEAR_START	0x01	// odometry says back at the start or on explored ground
+#define TRACE_REVISITING	0x02	// on explored ground
+#define TRACE_STEERED		0x04	// the scan carried a continuous steering command
+#define TRACE_COMPENSATED	0x08	// sectors were moved to the command time
+#define TRACE_EXPLORING		0x10	// heading for a frontier
+
+struct TraceHeader
+{
+	char magic[4];		// "WFTR"
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t capacity;		// records in the ring
+	uint32_t num_sectors;
+	uint32_t runs;			// number of times the file was opened
+	int64_t created;		// system clock, ns since the epoch, when the file was set up
+	uint32_t num_rules;		// names in the rule name table
+	uint32_t reserved[7];
+};
+
+struct TraceRecord
+{
+	uint64_t seq;			// tick number from 1, 0 while being written
+	uint32_t run;			// TraceHeader::runs when written
+	uint32_t flags;
+	int64_t scan_stamp;		// scan header stamp, ns, node clock
+	int64_t cmd_time;		// when the command was issued, ns, node clock
+	float sectors[NUM_SECTORS];	// distances the decision saw, metres
+	float x, y, yaw;		// odometry pose
+	float odom_linear, odom_angular;	// odometry twist
+	float linear, angular;		// command issued
+	int32_t rule;			// Command::rule
+	uint32_t decide_ns;		// time taken by the decision
+	uint32_t reserved[3];
+};
+
+static_assert(sizeof(TraceHeader) == 64, "TraceHeader layout");
+static_assert(sizeof(TraceRecord) == 128, "TraceRecord layout");
+
+class TraceRing
+{
+public:
+	~TraceRing();
+
+	// Map the file, re-initialising it if its layout or rule names do not
+	// match. rule_names[i] is the name of Command::rule i, the first
+	// TRACE_RULE_NAMES are kept. Returns false and sets error() on failure.
+	bool open(const std::string & path, uint32_t capacity = TRACE_RING_RECORDS,
+		const std::vector<std::string> & rule_names = {});
+	const std::string & error() const { return error_; }
+	bool is_open() const { return map_ != nullptr; }
+
+	// Copy a record into the next slot, setting its seq and run. Only one
+	// thread may write.
+	void write(const TraceRecord & record);
+
+	uint64_t written() const { return seq_; }
+
+	// Flush and unmap the file
+	void close();
+
+private:
+	uint8_t * map_ = nullptr;
+	size_t size_ = 0;
+	uint32_t capacity_ = 0;
+	uint32_t run_ = 0;
+	uint64_t seq_ = 0;
+	std::string error_;
+};
+
+#endif  // WALL_FOLLOWER__TRACE_RING_HPP_
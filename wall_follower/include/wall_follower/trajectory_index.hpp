@@ -0,0 +1,81 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Spatial index of the path driven so far, for "have I been here before"
+// queries at any point of the path, not only the start.
+// Odometry positions are downsampled to one every spacing metres and hashed
+// into a uniform grid, so a query only looks at the few cells around the
+// point, however long the path has grown.
+
+#ifndef WALL_FOLLOWER__TRAJECTORY_INDEX_HPP_
+#define WALL_FOLLOWER__TRAJECTORY_INDEX_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+#define TRAJECTORY_CELL		0.25	// metres, grid cell size
+#define TRAJECTORY_SPACING	0.05	// metres between recorded positions
+#define REVISIT_RADIUS		0.2	// metres from an old position to count as a revisit
+#define REVISIT_GAP		2.0	// metres driven before a position counts as explored
+
+// What the wall follower does when it comes back to explored ground
+enum class RevisitPolicy
+{
+	START,		// stop back at the start only (StartDetector)
+	ANY,		// stop on re-entering any part of the path
+	LOG,		// report re-entries but keep going
+	EXPLORE		// head for the nearest map frontier, stop when there is none
+};
+
+// Policy named "start", "any", "log" or "explore". Returns false for other names.
+bool parse_revisit_policy(const std::string & name, RevisitPolicy & policy);
+
+struct TrajectoryPose
+{
+	double x, y;
+	double distance;	// metres driven when the position was recorded
+};
+
+class TrajectoryIndex
+{
+public:
+	explicit TrajectoryIndex(double cell = TRAJECTORY_CELL, double spacing = TRAJECTORY_SPACING);
+
+	// Feed one odometry position. It is only recorded once the robot is
+	// spacing from the last recorded position. Returns true if recorded.
+	bool add(double x, double y);
+
+	// Index of the nearest recorded position within radius of (x, y) that
+	// was recorded at least gap metres of driving ago, or -1 if none
+	long find_visited(double x, double y, double radius, double gap) const;
+
+	const TrajectoryPose & pose(size_t i) const { return poses_[i]; }
+	size_t size() const { return poses_.size(); }
+	double distance() const { return distance_; }
+	void clear();
+
+private:
+	int64_t cell_of(double v) const;
+	static uint64_t key(int64_t cx, int64_t cy);
+
+	double cell_;
+	double spacing_;
+	double distance_ = 0.0;
+	std::vector<TrajectoryPose> poses_;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> cells_;
+};
+
+#endif  // WALL_FOLLOWER__TRAJECTORY_INDEX_HPP_
@@ -0,0 +1,93 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Continuous left-wall following.
+// A line fitted to the beams on the left gives the distance and angle of the
+// wall. A PD law on the distance error, with the derivative taken from the
+// wall angle rather than by differencing, plus a small integral term, turns
+// them into an angular command. The gains come from a table indexed by
+// forward speed that is computed once, so every tick is constant-time and
+// the response stays the same as the speed goes up.
+
+#ifndef WALL_FOLLOWER__WALL_CONTROLLER_HPP_
+#define WALL_FOLLOWER__WALL_CONTROLLER_HPP_
+
+#include <vector>
+
+#include "wall_follower/sector_reducer.hpp"
+#include "wall_follower/sectors.hpp"
+
+
+#define GAIN_TABLE_SIZE	32	// speed bins from 0 to max_linear
+
+struct WallConfig
+{
+	double first_angle = 30.0 * DEG2RAD;	// left window used for the fit
+	double last_angle = 150.0 * DEG2RAD;
+	double fit_range = 1.2;		// metres, farther beams are not the wall
+	int min_points = 10;		// beams needed for a fit
+	double target = 0.45;		// metres from the wall
+	double lookahead = 0.6;		// metres to converge onto the target line
+	double damping = 0.9;
+	double integral_ratio = 0.1;	// Ki as a fraction of Kp
+	double integral_limit = 0.2;	// metre-seconds
+	double max_linear = 0.5;
+	double max_angular = ANGULAR_VELOCITY;
+	double safety_radius = 0.2;	// robot half width plus margin
+	double stop_distance = 0.35;	// front clearance for turning on the spot
+	double slow_distance = 1.2;	// front clearance for full speed
+	double lost_linear = 0.2;	// arc to the left when no wall is seen
+	double lost_angular = 1.0;
+};
+
+struct WallFit
+{
+	double distance;	// perpendicular distance to the wall, metres
+	double angle;		// heading relative to the wall, positive towards it
+	int points;
+};
+
+struct WallGains
+{
+	double kp, kd, ki;
+};
+
+class WallController
+{
+public:
+	WallController() { configure(WallConfig()); }
+
+	// Set the configuration and rebuild the gain table
+	void configure(const WallConfig & config);
+	const WallConfig & config() const { return config_; }
+
+	// Gains for a forward speed, from the table
+	const WallGains & gains(double speed) const;
+
+	// Total least squares line through the valid left beams. Returns false
+	// if there are fewer than min_points.
+	bool fit(const float * ranges, float range_min, float range_max, WallFit & wall) const;
+
+	// Velocity command for one scan, dt seconds after the previous one.
+	// Returns false if the scan geometry cannot be used.
+	bool control(const ScanGeometry & geometry, const float * ranges, float range_min, float range_max,
+		double dt, double & linear, double & angular);
+
+private:
+	WallConfig config_;
+	BeamFan left_;
+	BeamFan front_;
+	WallGains table_[GAIN_TABLE_SIZE];
+	double integral_ = 0.0;
+};
+
+#endif  // WALL_FOLLOWER__WALL_CONTROLLER_HPP_
@@ -17,62 +17,239 @@
 #ifndef WALL_FOLLOWER_HPP_
 #define WALL_FOLLOWER_HPP_
 
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
 #include <geometry_msgs/msg/twist.hpp>
+#include <nav_msgs/msg/occupancy_grid.hpp>
 #include <nav_msgs/msg/odometry.hpp>
 #include <rclcpp/rclcpp.hpp>
+#include <rclcpp_lifecycle/lifecycle_node.hpp>
+#include <rclcpp_lifecycle/lifecycle_publisher.hpp>
 #include <sensor_msgs/msg/laser_scan.hpp>
-#include <tf2/LinearMath/Matrix3x3.h>
-#include <tf2/LinearMath/Quaternion.h>
+#include <tf2_ros/buffer.h>
+#include <tf2_ros/transform_listener.h>
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
 
-#define DEG2RAD (M_PI / 180.0)
-#define RAD2DEG (180.0 / M_PI)
+#include "wall_follower/control_pipeline.hpp"
+#include "wall_follower/frontier_map.hpp"
+#include "wall_follower/latency_histogram.hpp"
+#include "wall_follower/motion_compensation.hpp"
+#include "wall_follower/rate_scheduler.hpp"
+#include "wall_follower/sectors.hpp"
+#include "wall_follower/seqlock.hpp"
+#include "wall_follower/trace_ring.hpp"
+#include "wall_follower/trajectory_index.hpp"
 
-#define FRONT		0
-#define FRONT_LEFT	1
-#define LEFT_FRONT	2
-#define LEFT		3
-#define LEFT_BACK	4
-#define BACK_LEFT	5
-#define BACK		6
-#define BACK_RIGHT	7
-#define RIGHT_BACK	8
-#define RIGHT		9
-#define RIGHT_FRONT	10
-#define FRONT_RIGHT	11
 
-#define LINEAR_VELOCITY  0.3
-#define ANGULAR_VELOCITY 1.5
+// Stages of the scan to command pipeline that are timed
+enum LatencyStage
+{
+	LATENCY_TRANSPORT,	// scan header stamp to scan_callback
+	LATENCY_REDUCE,		// sector reduction
+	LATENCY_DECIDE,		// rule evaluation
+	LATENCY_PUBLISH,	// update_cmd_vel
+	LATENCY_SCAN_TO_CMD,	// scan header stamp to command published
+	NUM_LATENCY_STAGES
+};
+
 
+using CallbackReturn = rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn;
 
-class WallFollower : public rclcpp::Node
+// Lifecycle node: configuring creates the subscriptions and publishers,
+// activating starts the control loop and sending commands. See
+// startup_callback() for the autostart sequence.
+class WallFollower : public rclcpp_lifecycle::LifecycleNode
 {
 public:
-	WallFollower();
+	explicit WallFollower(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
 	~WallFollower();
 
+	CallbackReturn on_configure(const rclcpp_lifecycle::State & state) override;
+	CallbackReturn on_activate(const rclcpp_lifecycle::State & state) override;
+	CallbackReturn on_deactivate(const rclcpp_lifecycle::State & state) override;
+	CallbackReturn on_cleanup(const rclcpp_lifecycle::State & state) override;
+	CallbackReturn on_shutdown(const rclcpp_lifecycle::State & state) override;
+
 private:
 	// ROS topic publishers
-	rclcpp::Publisher<geometry_msgs::msg::Twist>::SharedPtr cmd_vel_pub_;
+	rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::Twist>::SharedPtr cmd_vel_pub_;
+	rclcpp_lifecycle::LifecyclePublisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr diagnostics_pub_;
 
 	// ROS topic subscribers
 	rclcpp::Subscription<sensor_msgs::msg::LaserScan>::SharedPtr scan_sub_;
 	rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
+	rclcpp::Subscription<nav_msgs::msg::OccupancyGrid>::SharedPtr map_sub_;
+
+	// Callback groups, so that under a multi-threaded executor scans, odometry
+	// and the control loop can run on different cores
+	rclcpp::CallbackGroup::SharedPtr scan_group_;
+	rclcpp::CallbackGroup::SharedPtr odom_group_;
+	rclcpp::CallbackGroup::SharedPtr control_group_;
+	rclcpp::CallbackGroup::SharedPtr map_group_;
+
+	// State handed between the callback groups. Each snapshot has a single
+	// writer and is read without locking by the control loop.
+	struct ScanState
+	{
+		uint64_t seq;			// number of scans reduced so far
+		rcl_time_point_value_t stamp;	// scan header stamp
+		double sectors[NUM_SECTORS];
+		float range_max;
+		bool steered;			// steer holds a continuous steering command
+		Command steer;
+	};
+	struct OdomState
+	{
+		double x, y;
+		double yaw;
+		double linear, angular;		// twist, for motion compensation
+		bool near_start;		// stop: back at the start, or on explored ground
+		bool revisiting;		// on explored ground now
+	};
+	// Raw odometry, as copied by odom_callback
+	struct OdomSample
+	{
+		uint64_t seq;			// number of odometry messages so far
+		double x, y;
+		double qx, qy, qz, qw;
+		double linear, angular;
+	};
+	SeqLock<ScanState> scan_state_;
+	SeqLock<OdomState> odom_state_;
+	SeqLock<OdomSample> odom_sample_;	// "latest" odom_mode only
+
+	// Nearest frontier, in the odometry frame, as of the last map
+	struct ExploreTarget
+	{
+		uint64_t seq;			// number of maps processed so far
+		bool valid;			// false if the map has no frontier to head for
+		bool none_left;			// no frontier cell anywhere in the map
+		uint32_t empty_maps;		// consecutive maps with no valid target
+		double x, y;
+	};
+	SeqLock<ExploreTarget> explore_target_;
+
+	// Owned by scan_callback
+	uint64_t scan_seq_ = 0;
+
+	// Owned by odom_callback
+	uint64_t odom_seq_ = 0;
+
+	// Odometry handling: process every odom_decimation_-th message in
+	// odom_callback, or only the latest sample from the control loop
+	bool odom_latest_;
+	int odom_decimation_;
+
+	// Owned by process_odom(), which runs in odom_callback or, in "latest"
+	// mode, in the control loop
+	StartDetector start_detector_;
+	TrajectoryIndex trajectory_;
+	bool revisiting_ = false;
+	bool revisit_stop_ = false;
+
+	// What to do on coming back to explored ground
+	RevisitPolicy revisit_policy_;
+	double revisit_radius_;
+	double revisit_gap_;
+
+	// Owned by map_callback ("explore" revisit policy)
+	FrontierMap frontier_map_;
+	uint64_t map_seq_ = 0;
+	uint32_t empty_maps_ = 0;
+	std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
+	std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+	std::string odom_frame_;
+	std::string map_topic_;
+
+	// Exploration settings, and its state in the control loop
+	double explore_min_distance_;
+	double explore_reach_;
+	double explore_timeout_;
+	double explore_clearance_;
+	double explore_heading_gain_;
+	int explore_empty_maps_;
+	bool exploring_ = false;
+	bool explore_armed_ = true;	// false until the robot leaves explored ground
+	bool explored_ = false;		// no frontier in the last maps, stopped
+	rcl_time_point_value_t explore_since_ = 0;
+
+	// Owned by the control loop
+	uint64_t last_scan_seq_ = 0;
+	uint64_t last_odom_seq_ = 0;
+
+	// The command state and the control timer, also touched by lifecycle
+	// transitions from the service thread, guarded by control_mutex_
+	std::mutex control_mutex_;
+	geometry_msgs::msg::Twist cmd_vel_msg_;		// last command sent, reused
+	bool cmd_vel_sent_ = false;
+	rcl_time_point_value_t last_cmd_vel_time_ = 0;
+	rcl_duration_value_t cmd_vel_keepalive_;
+
+	// Sector reduction (scan_callback) and behaviour rules (control loop).
+	// The reducer's index tables are cached per scan geometry.
+	ControlPipeline pipeline_;
+
+	// Control mode: "event" runs the decision logic from scan_callback,
+	// "timer" polls for new scans on update_timer_
+	bool event_driven_;
+	double scan_timeout_;
+	std::atomic<rcl_time_point_value_t> last_scan_time_;
+	std::atomic<bool> scan_timed_out_;
+	int last_branch_ = -1;
+
+	// Vary the control period with proximity and speed in timer mode. Event
+	// mode follows the scans, but drops to rate.idle_period while stopped.
+	bool adaptive_rate_;
+	RateScheduler rate_scheduler_;
+	bool idle_ = false;
+	rcl_time_point_value_t last_tick_time_ = 0;
+
+	// Extrapolate the sectors from the scan stamp to the command time
+	bool motion_compensation_;
+	double compensation_horizon_;
+
+	// Latency instrumentation, recorded from any callback group
+	LatencyHistogram latency_[NUM_LATENCY_STAGES];
+	double latency_warn_;
+	double diagnostics_period_;
+
+	// Binary trace of every tick, written by the control loop
+	TraceRing trace_;
+	std::string trace_file_;
+	uint32_t trace_records_;
 
-	// Variables
-	double robot_pose_;
-	double start_x, start_y;
-	bool near_start; 
-	double scan_data_[12];
-	bool new_scan_data_ = false;
+	// Bring-up: the first usable scan and odometry, and whether the node is
+	// active and may send commands
+	bool autostart_;
+	std::atomic<bool> scan_ready_;
+	std::atomic<bool> odom_ready_;
+	std::atomic<bool> active_;
 
 	// ROS timer
+	rclcpp::TimerBase::SharedPtr startup_timer_;
 	rclcpp::TimerBase::SharedPtr update_timer_;
+	rclcpp::TimerBase::SharedPtr watchdog_timer_;
+	rclcpp::TimerBase::SharedPtr diagnostics_timer_;
 
 	// Function prototypes
+	void load_rules();
+	void load_steering();
+	void startup_callback();
 	void update_callback();
+	void explore(const OdomState & odom, const double * sectors, Command & cmd);
+	void schedule_update(double period);
+	void watchdog_callback();
+	void diagnostics_callback();
+	void log_branch(int branch, const char * description);
 	void update_cmd_vel(double linear, double angular);
+	void send_cmd_vel(double linear, double angular);
 	void scan_callback(const sensor_msgs::msg::LaserScan::SharedPtr msg);
 	void odom_callback(const nav_msgs::msg::Odometry::SharedPtr msg);
+	void process_odom(const OdomSample & sample);
+	void map_callback(const nav_msgs::msg::OccupancyGrid::SharedPtr msg);
 };
 #endif  // TURTLEBOT3_GAZEBO__TURTLEBOT3_DRIVE_HPP_
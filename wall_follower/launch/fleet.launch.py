@@ -0,0 +1,108 @@
+import os
+
+import yaml
+
+from ament_index_python.packages import get_package_share_directory
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument, OpaqueFunction
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import ComposableNodeContainer, Node
+from launch_ros.descriptions import ComposableNode
+
+
+def robot_nodes(robot, params_file, namespaced_tf, map_topic):
+    """
+    The wall follower and marker mapper of one robot, as
+    (plugin, executable, name, namespace, parameters, remappings)
+    """
+    name = robot['name']
+    prefix = robot.get('frame_prefix', '')
+    remappings = [('/tf', 'tf'), ('/tf_static', 'tf_static')] if namespaced_tf else []
+
+    wall_follower_params = [params_file, dict({
+        'odom_frame': prefix + 'odom',
+        'map_topic': map_topic,
+    }, **robot.get('wall_follower', {}))]
+    mapper_params = [params_file, dict({
+        'camera_frame': prefix + 'camera_link',
+        'compatibility_topics': True,
+    }, **robot.get('marker_mapper', {}))]
+
+    return [
+        ('WallFollower', 'wall_follower', 'wall_follower', name, wall_follower_params, remappings),
+        ('MarkerMapper', 'marker_mapper', 'marker_mapper', name, mapper_params, remappings),
+    ]
+
+
+def launch_fleet(context):
+    """
+    Start every robot in fleet_file. With shared_container all the nodes of
+    all the robots are loaded into one multi-threaded component container,
+    otherwise each node runs in its own process.
+    """
+    fleet_file = LaunchConfiguration('fleet_file').perform(context)
+    params_file = LaunchConfiguration('params_file').perform(context)
+    shared_container = LaunchConfiguration('shared_container').perform(context).lower() in ('true', '1')
+    namespaced_tf = LaunchConfiguration('namespaced_tf').perform(context).lower() in ('true', '1')
+    map_topic = LaunchConfiguration('map_topic').perform(context)
+
+    with open(fleet_file, 'r') as f:
+        robots = yaml.safe_load(f)['robots']
+
+    nodes = []
+    for robot in robots:
+        nodes += robot_nodes(robot, params_file, namespaced_tf, map_topic)
+
+    if shared_container:
+        return [ComposableNodeContainer(
+            name='fleet_container',
+            namespace='',
+            package='rclcpp_components',
+            executable='component_container_mt',
+            composable_node_descriptions=[
+                ComposableNode(
+                    package='wall_follower',
+                    plugin=plugin,
+                    name=name,
+                    namespace=namespace,
+                    parameters=parameters,
+                    remappings=remappings,
+                    extra_arguments=[{'use_intra_process_comms': True}])
+                for plugin, executable, name, namespace, parameters, remappings in nodes
+            ],
+            output='screen'
+        )]
+    return [
+        Node(
+            package='wall_follower',
+            executable=executable,
+            name=name,
+            namespace=namespace,
+            parameters=parameters,
+            remappings=remappings)
+        for plugin, executable, name, namespace, parameters, remappings in nodes
+    ]
+
+
+def generate_launch_description():
+    share = get_package_share_directory('wall_follower')
+
+    return LaunchDescription([
+        DeclareLaunchArgument(
+            'fleet_file', default_value=os.path.join(share, 'config', 'fleet.yaml'),
+            description='Robots to start, with their namespaces and TF frame prefixes'),
+        DeclareLaunchArgument(
+            'params_file', default_value=os.path.join(share, 'config', 'wall_follower.yaml'),
+            description='Parameters shared by all the robots'),
+        DeclareLaunchArgument(
+            'shared_container', default_value='True',
+            description='Load all the robots into one component container'),
+        DeclareLaunchArgument(
+            'namespaced_tf', default_value='False',
+            description='Each robot publishes TF on <namespace>/tf rather than /tf'),
+        DeclareLaunchArgument(
+            'map_topic', default_value='/map',
+            description='Map the explore revisit policy reads. Absolute, so that all the robots use the '
+                'one shared map; a relative name would resolve to <namespace>/<map_topic> per robot'),
+        OpaqueFunction(function=launch_fleet)
+    ])
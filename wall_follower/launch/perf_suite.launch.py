@@ -0,0 +1,141 @@
+import os
+import tempfile
+
+import yaml
+
+from ament_index_python.packages import get_package_share_directory
+from launch import LaunchDescription
+from launch.actions import (DeclareLaunchArgument, EmitEvent, IncludeLaunchDescription, OpaqueFunction,
+    RegisterEventHandler, SetEnvironmentVariable)
+from launch.conditions import IfCondition
+from launch.event_handlers import OnProcessExit
+from launch.events import Shutdown
+from launch.launch_description_sources import PythonLaunchDescriptionSource
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import Node
+
+
+# World for a scenario that names a single model
+WORLD_TEMPLATE = """<?xml version="1.0"?>
+<sdf version="1.6">
+  <world name="default">
+    <include><uri>model://ground_plane</uri></include>
+    <include><uri>model://sun</uri></include>
+    <include><uri>model://{model}</uri></include>
+  </world>
+</sdf>
+"""
+
+
+def find_scenario(scenarios_file, name):
+    with open(scenarios_file, 'r') as f:
+        scenarios = yaml.safe_load(f)['scenarios']
+    for scenario in scenarios:
+        if scenario['name'] == name:
+            return scenario
+    raise RuntimeError("No scenario '%s' in %s" % (name, scenarios_file))
+
+
+def launch_scenario(context):
+    """
+    One scenario, headless: gzserver with the world, the robot, Cartographer,
+    the wall follower and perception on sim time, and perf_monitor.py, which
+    ends the launch when the lap is done or the scenario times out (unless
+    shutdown_when_done is False, as in test/test_perf_suite.launch.py)
+    """
+    share = get_package_share_directory('wall_follower')
+    models = os.path.join(share, 'model_editor_models')
+    scenario = find_scenario(LaunchConfiguration('scenarios_file').perform(context),
+        LaunchConfiguration('scenario').perform(context))
+    results_file = LaunchConfiguration('results_file').perform(context)
+    fused_perception = LaunchConfiguration('fused_perception').perform(context)
+    x, y, yaw = scenario.get('spawn', [0.0, 0.0, 0.0])
+
+    if 'world' in scenario:
+        world = os.path.join(models, scenario['world'])
+    else:
+        fd, world = tempfile.mkstemp(prefix='wall_follower_%s_' % scenario['name'], suffix='.world')
+        with os.fdopen(fd, 'w') as f:
+            f.write(WORLD_TEMPLATE.format(model=scenario['model']))
+
+    model_path = os.pathsep.join(p for p in [models, os.environ.get('GAZEBO_MODEL_PATH', '')] if p)
+    gazebo_ros = get_package_share_directory('gazebo_ros')
+    turtlebot3_gazebo = get_package_share_directory('turtlebot3_gazebo')
+    turtlebot3_cartographer = get_package_share_directory('turtlebot3_cartographer')
+
+    monitor = Node(
+        package='wall_follower',
+        executable='perf_monitor.py',
+        name='perf_monitor',
+        output='screen',
+        parameters=[{
+            'use_sim_time': True,
+            'scenario': scenario['name'],
+            'world_file': world,
+            'spawn': [float(x), float(y), float(yaw)],
+            'timeout': float(scenario.get('timeout', 300.0)),
+            'limits': yaml.safe_dump(scenario.get('limits', {})),
+            'results_file': results_file,
+        }]
+    )
+
+    return [
+        SetEnvironmentVariable('GAZEBO_MODEL_PATH', model_path),
+        SetEnvironmentVariable('TURTLEBOT3_MODEL', 'waffle_pi'),
+        IncludeLaunchDescription(
+            PythonLaunchDescriptionSource(os.path.join(gazebo_ros, 'launch', 'gzserver.launch.py')),
+            launch_arguments={'world': world}.items()),
+        IncludeLaunchDescription(
+            PythonLaunchDescriptionSource(
+                os.path.join(turtlebot3_gazebo, 'launch', 'robot_state_publisher.launch.py')),
+            launch_arguments={'use_sim_time': 'True'}.items()),
+        Node(
+            package='gazebo_ros',
+            executable='spawn_entity.py',
+            arguments=['-entity', 'waffle_pi',
+                '-file', os.path.join(models, 'turtlebot3_waffle_pi', 'model.sdf'),
+                '-x', str(x), '-y', str(y), '-Y', str(yaw)]),
+        IncludeLaunchDescription(
+            PythonLaunchDescriptionSource(
+                os.path.join(turtlebot3_cartographer, 'launch', 'cartographer.launch.py')),
+            launch_arguments={'use_sim_time': 'True', 'use_rviz': 'False'}.items()),
+        IncludeLaunchDescription(
+            PythonLaunchDescriptionSource(os.path.join(share, 'launch', 'wall_follower.launch.py')),
+            launch_arguments={
+                'params_file': LaunchConfiguration('params_file').perform(context),
+                'fused_perception': fused_perception,
+                'use_sim_time': 'True',
+            }.items()),
+        monitor,
+        RegisterEventHandler(
+            OnProcessExit(
+                target_action=monitor,
+                on_exit=[EmitEvent(event=Shutdown(reason='scenario finished'))]),
+            condition=IfCondition(LaunchConfiguration('shutdown_when_done'))),
+    ]
+
+
+def generate_launch_description():
+    share = get_package_share_directory('wall_follower')
+
+    return LaunchDescription([
+        DeclareLaunchArgument(
+            'scenario', default_value='maze',
+            description='Name of the scenario in scenarios_file'),
+        DeclareLaunchArgument(
+            'scenarios_file', default_value=os.path.join(share, 'config', 'perf_scenarios.yaml'),
+            description='Worlds, spawn poses and metric limits'),
+        DeclareLaunchArgument(
+            'params_file', default_value=os.path.join(share, 'config', 'wall_follower.yaml'),
+            description='Wall follower parameters'),
+        DeclareLaunchArgument(
+            'fused_perception', default_value='False',
+            description='Detect and map markers in the single C++ marker_mapper node'),
+        DeclareLaunchArgument(
+            'results_file', default_value='perf_results.jsonl',
+            description='File the metrics of the run are appended to, one JSON object per line'),
+        DeclareLaunchArgument(
+            'shutdown_when_done', default_value='True',
+            description='End the launch when perf_monitor.py exits'),
+        OpaqueFunction(function=launch_scenario)
+    ])
@@ -1,21 +1,192 @@
+import os
+
+from ament_index_python.packages import get_package_share_directory
 from launch import LaunchDescription
-from launch_ros.actions import Node
+from launch.actions import DeclareLaunchArgument, EmitEvent, LogInfo, OpaqueFunction, RegisterEventHandler
+from launch.event_handlers import OnProcessExit
+from launch.events import matches_action
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import ComposableNodeContainer, LifecycleNode, LoadComposableNodes, Node
+from launch_ros.descriptions import ComposableNode
+from launch_ros.event_handlers import OnStateTransition
+from launch_ros.events.lifecycle import ChangeState
+from lifecycle_msgs.msg import Transition
 
-def generate_launch_description():
-    return LaunchDescription([
-        Node(
+
+def perception_nodes(context):
+    """
+    Marker detection and mapping: the fused C++ marker_mapper node, the C++
+    see_marker node with point_transformer.py, or the original Python pair
+    """
+    python_perception = LaunchConfiguration('python_perception').perform(context).lower() in ('true', '1')
+    fused_perception = LaunchConfiguration('fused_perception').perform(context).lower() in ('true', '1')
+    use_sim_time = LaunchConfiguration('use_sim_time').perform(context).lower() in ('true', '1')
+
+    if fused_perception:
+        # Keep publishing the old topics so RViz configs still work
+        return [Node(
             package='wall_follower',
-            executable='wall_follower',
-            name='wall_follower'
-        ),
+            executable='marker_mapper',
+            name='marker_mapper',
+            parameters=[{'compatibility_topics': True, 'use_sim_time': use_sim_time}]
+        )]
+    return [
         Node(
             package='wall_follower',
-            executable='see_marker.py',
-            name='see_marker'
+            executable='see_marker.py' if python_perception else 'see_marker',
+            name='see_marker',
+            parameters=[{'use_sim_time': use_sim_time}]
         ),
         Node(
             package='wall_follower',
             executable='point_transformer.py',
             name='point_transformer',
+            parameters=[{'use_sim_time': use_sim_time}]
         )
+    ]
+
+
+def standalone_wall_follower(wall_follower_node, autostart, perception):
+    """
+    The wall follower in its own process, sequenced on its lifecycle events.
+    Perception starts the first time it is active. Without autostart the
+    launch configures and activates it.
+    """
+    actions = [
+        wall_follower_node,
+        RegisterEventHandler(OnStateTransition(
+            target_lifecycle_node=wall_follower_node,
+            goal_state='active',
+            entities=[LogInfo(msg='Wall follower is active')]
+        )),
+        RegisterEventHandler(OnStateTransition(
+            target_lifecycle_node=wall_follower_node,
+            goal_state='active',
+            entities=perception,
+            handle_once=True
+        ))
+    ]
+    if not autostart:
+        actions += [
+            RegisterEventHandler(OnStateTransition(
+                target_lifecycle_node=wall_follower_node,
+                start_state='configuring',
+                goal_state='inactive',
+                entities=[EmitEvent(event=ChangeState(
+                    lifecycle_node_matcher=matches_action(wall_follower_node),
+                    transition_id=Transition.TRANSITION_ACTIVATE))],
+                handle_once=True
+            )),
+            EmitEvent(event=ChangeState(
+                lifecycle_node_matcher=matches_action(wall_follower_node),
+                transition_id=Transition.TRANSITION_CONFIGURE))
+        ]
+    return actions
+
+
+def gated_wall_follower(load, autostart, perception):
+    """
+    The wall follower as a component, which launch_ros has no lifecycle
+    events for. lifecycle_gate.py watches it instead (and without autostart
+    configures and activates it), and perception starts when the gate exits.
+    """
+    gate = Node(
+        package='wall_follower',
+        executable='lifecycle_gate.py',
+        name='wall_follower_gate',
+        parameters=[{'node': '/wall_follower', 'drive': not autostart}]
+    )
+
+    def on_gate_exit(event, context):
+        if event.returncode != 0:
+            return [LogInfo(msg='Wall follower never became active, perception not started')]
+        return [LogInfo(msg='Wall follower is active')] + perception
+
+    return [
+        load,
+        gate,
+        RegisterEventHandler(OnProcessExit(target_action=gate, on_exit=on_gate_exit))
+    ]
+
+
+def launch_wall_follower(context):
+    """
+    Start the wall follower as a standalone process, in its own component
+    container, or inside an existing container (e.g. the lidar driver's)
+    so that scans and commands use intra-process comms. The wall follower is
+    a lifecycle node; with autostart it activates itself once the scan and
+    odometry arrive, otherwise the launch configures and activates it.
+    Perception only starts once the wall follower is active.
+    """
+    container = LaunchConfiguration('container').perform(context)
+    use_composition = LaunchConfiguration('use_composition').perform(context).lower() in ('true', '1')
+    params_file = LaunchConfiguration('params_file').perform(context)
+    executor_threads = int(LaunchConfiguration('executor_threads').perform(context))
+    use_sim_time = LaunchConfiguration('use_sim_time').perform(context).lower() in ('true', '1')
+    autostart = LaunchConfiguration('autostart').perform(context).lower() in ('true', '1')
+    overrides = {'executor_threads': executor_threads, 'use_sim_time': use_sim_time, 'autostart': autostart}
+    perception = perception_nodes(context)
+
+    wall_follower = ComposableNode(
+        package='wall_follower',
+        plugin='WallFollower',
+        name='wall_follower',
+        parameters=[params_file, overrides],
+        extra_arguments=[{'use_intra_process_comms': True}]
+    )
+
+    if container:
+        return gated_wall_follower(LoadComposableNodes(
+            target_container=container,
+            composable_node_descriptions=[wall_follower]
+        ), autostart, perception)
+    if use_composition:
+        return gated_wall_follower(ComposableNodeContainer(
+            name='wall_follower_container',
+            namespace='',
+            package='rclcpp_components',
+            executable='component_container_mt' if executor_threads > 1 else 'component_container',
+            composable_node_descriptions=[wall_follower],
+            output='screen'
+        ), autostart, perception)
+    return standalone_wall_follower(LifecycleNode(
+        package='wall_follower',
+        executable='wall_follower',
+        name='wall_follower',
+        namespace='',
+        parameters=[params_file, overrides]
+    ), autostart, perception)
+
+
+def generate_launch_description():
+    default_params = os.path.join(
+        get_package_share_directory('wall_follower'), 'config', 'wall_follower.yaml')
+
+    return LaunchDescription([
+        DeclareLaunchArgument(
+            'params_file', default_value=default_params,
+            description='Wall follower parameters, including the behaviour rule table'),
+        DeclareLaunchArgument(
+            'executor_threads', default_value='1',
+            description='Threads for the wall follower executor, more than 1 uses a multi-threaded executor'),
+        DeclareLaunchArgument(
+            'autostart', default_value='True',
+            description='Activate the wall follower on the first scan and odometry, '
+                'otherwise the launch configures and activates it straight away'),
+        DeclareLaunchArgument(
+            'use_composition', default_value='False',
+            description='Run the wall follower in its own component container'),
+        DeclareLaunchArgument(
+            'container', default_value='',
+            description='Name of an existing component container to load the wall follower into'),
+        DeclareLaunchArgument(
+            'python_perception', default_value='False',
+            description='Use the original Python see_marker.py instead of the C++ node'),
+        DeclareLaunchArgument(
+            'fused_perception', default_value='False',
+            description='Detect and map markers in the single C++ marker_mapper node'),
+        DeclareLaunchArgument(
+            'use_sim_time', default_value='False',
+            description='Use the simulation clock (Gazebo) in every node'),
+        OpaqueFunction(function=launch_wall_follower)
     ])
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+
+"""
+Decoder for the wall follower's binary trace (trace_file parameter), shared
+with the C++ TraceRing (include/wall_follower/trace_ring.hpp).
+
+A 64 byte header, a table of 32 rule names and a ring of fixed 128 byte
+records, one per control tick, all little-endian:
+
+	header:	char magic[4] = "WFTR", uint32 version, record_size, capacity,
+		num_sectors, runs, int64 created (ns since the epoch), uint32 num_rules,
+		uint32 reserved[7]
+	names:	char name[32][32], NUL padded, name[i] for rule i (the fallback
+		after the rules), num_rules of them used
+	record:	uint64 seq (tick from 1, 0 if torn), uint32 run, uint32 flags,
+		int64 scan_stamp, cmd_time (ns, node clock), float32 sectors[12],
+		float32 x, y, yaw, odom_linear, odom_angular, linear, angular,
+		int32 rule, uint32 decide_ns, uint32 reserved[3]
+
+Record seq goes in slot (seq - 1) % capacity. Prints the ticks in order,
+as text or CSV, or a summary of the rules fired and the timing.
+
+Usage: decode_trace.py <trace> [--run N] [--last N] [--csv | --summary]
+"""
+
+import argparse
+import datetime
+import struct
+import sys
+
+MAGIC = b'WFTR'
+VERSION = 2
+HEADER = struct.Struct('<4sIIIIIqI7I')
+RULE_NAMES = 32
+RULE_NAME_SIZE = 32
+RECORDS_OFFSET = HEADER.size + RULE_NAMES*RULE_NAME_SIZE
+RECORD = struct.Struct('<QIIqq12f7fiI3I')
+
+SECTORS = ('FRONT', 'FRONT_LEFT', 'LEFT_FRONT', 'LEFT', 'LEFT_BACK', 'BACK_LEFT',
+	'BACK', 'BACK_RIGHT', 'RIGHT_BACK', 'RIGHT', 'RIGHT_FRONT', 'FRONT_RIGHT')
+FLAGS = ((0x01, 'near_start'), (0x02, 'revisiting'), (0x04, 'steered'), (0x08, 'compensated'),
+	(0x10, 'exploring'))
+SPECIAL_RULES = {-2: 'near_start', -3: 'steer', -4: 'explore'}
+
+
+def read_trace(path):
+	"""
+	Header fields as a dict and the valid records, oldest first, each a dict
+	"""
+	with open(path, 'rb') as f:
+		data = f.read()
+	if len(data) < HEADER.size:
+		raise ValueError('%s: too short for a trace' % path)
+	magic, version, record_size, capacity, num_sectors, runs, created, num_rules = HEADER.unpack_from(data, 0)[:8]
+	if magic != MAGIC or version != VERSION or record_size != RECORD.size or num_sectors != len(SECTORS):
+		raise ValueError('%s: not a version %d trace' % (path, VERSION))
+	names = []
+	for i in range(min(num_rules, RULE_NAMES)):
+		offset = HEADER.size + i*RULE_NAME_SIZE
+		names.append(data[offset:offset + RULE_NAME_SIZE].split(b'\0', 1)[0].decode(errors='replace'))
+	header = {'capacity': capacity, 'runs': runs, 'created': created, 'rule_names': names}
+
+	records = []
+	for i in range(min(capacity, max(0, len(data) - RECORDS_OFFSET) // RECORD.size)):
+		fields = RECORD.unpack_from(data, RECORDS_OFFSET + i*RECORD.size)
+		seq = fields[0]
+		if seq == 0 or (seq - 1) % capacity != i:
+			continue
+		records.append({
+			'seq': seq,
+			'run': fields[1],
+			'flags': fields[2],
+			'scan_stamp': fields[3],
+			'cmd_time': fields[4],
+			'sectors': fields[5:17],
+			'x': fields[17], 'y': fields[18], 'yaw': fields[19],
+			'odom_linear': fields[20], 'odom_angular': fields[21],
+			'linear': fields[22], 'angular': fields[23],
+			'rule': fields[24],
+			'decide_ns': fields[25],
+		})
+	records.sort(key=lambda r: r['seq'])
+	return header, records
+
+
+def rule_name(rule, names):
+	if rule in SPECIAL_RULES:
+		return SPECIAL_RULES[rule]
+	if 0 <= rule < len(names):
+		return names[rule]
+	return 'rule %d' % rule
+
+
+def flag_names(flags):
+	return ','.join(name for bit, name in FLAGS if flags & bit) or '-'
+
+
+def percentile(values, q):
+	if not values:
+		return float('nan')
+	values = sorted(values)
+	return values[min(len(values) - 1, int(round(q * (len(values) - 1))))]
+
+
+def print_text(records, names):
+	for r in records:
+		print('%8d run %d  t %.3f  lat %6.1f ms  (%6.2f, %6.2f, %6.1f deg)  cmd %5.2f %5.2f  %-20s %s' % (
+			r['seq'], r['run'], r['cmd_time']*1e-9, (r['cmd_time'] - r['scan_stamp'])*1e-6,
+			r['x'], r['y'], r['yaw']*57.29577951308232, r['linear'], r['angular'],
+			rule_name(r['rule'], names), flag_names(r['flags'])))
+		print('           ' + ' '.join('%s %.2f' % (s, d) for s, d in zip(SECTORS, r['sectors'])))
+
+
+def print_csv(records, names):
+	columns = ['seq', 'run', 'scan_stamp', 'cmd_time', 'x', 'y', 'yaw', 'odom_linear', 'odom_angular',
+		'linear', 'angular', 'rule', 'decide_ns']
+	print(','.join(columns + ['rule_name', 'flags'] + [s.lower() for s in SECTORS]))
+	for r in records:
+		row = [str(r[c]) for c in columns] + [rule_name(r['rule'], names), flag_names(r['flags']).replace(',', '|')]
+		print(','.join(row + ['%.3f' % d for d in r['sectors']]))
+
+
+def print_summary(header, records, names):
+	created = datetime.datetime.fromtimestamp(header['created']*1e-9)
+	print('Trace created %s, %d runs, %d of %d records valid' % (
+		created.isoformat(' ', 'seconds'), header['runs'], len(records), header['capacity']))
+	if not records:
+		return
+	print('Ticks %d .. %d, %.1f s' % (records[0]['seq'], records[-1]['seq'],
+		(records[-1]['cmd_time'] - records[0]['cmd_time'])*1e-9))
+
+	counts = {}
+	for r in records:
+		counts[r['rule']] = counts.get(r['rule'], 0) + 1
+	print('Rules:')
+	for rule, count in sorted(counts.items(), key=lambda item: -item[1]):
+		print('  %-24s %8d  %5.1f%%' % (rule_name(rule, names), count, 100.0 * count / len(records)))
+
+	# Intervals only within a run, the clock restarts between runs
+	intervals = [(b['cmd_time'] - a['cmd_time'])*1e-6 for a, b in zip(records, records[1:])
+		if a['run'] == b['run'] and b['seq'] == a['seq'] + 1]
+	latency = [(r['cmd_time'] - r['scan_stamp'])*1e-6 for r in records]
+	decide = [r['decide_ns']*1e-3 for r in records]
+	print('Tick interval  p50 %8.2f ms  p99 %8.2f ms  max %8.2f ms' % (
+		percentile(intervals, 0.5), percentile(intervals, 0.99), max(intervals or [float('nan')])))
+	print('Scan to cmd    p50 %8.2f ms  p99 %8.2f ms  max %8.2f ms' % (
+		percentile(latency, 0.5), percentile(latency, 0.99), max(latency)))
+	print('Decide         p50 %8.2f us  p99 %8.2f us  max %8.2f us' % (
+		percentile(decide, 0.5), percentile(decide, 0.99), max(decide)))
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Decode a wall follower trace file')
+	parser.add_argument('trace')
+	parser.add_argument('--run', type=int, help='only this run (1 is the first open of the file)')
+	parser.add_argument('--last', type=int, help='only the last N ticks')
+	parser.add_argument('--csv', action='store_true', help='one CSV row per tick')
+	parser.add_argument('--summary', action='store_true', help='rules fired and timing only')
+	args = parser.parse_args()
+
+	try:
+		header, records = read_trace(args.trace)
+	except (OSError, ValueError) as e:
+		print(e, file=sys.stderr)
+		return 1
+	if args.run is not None:
+		records = [r for r in records if r['run'] == args.run]
+	if args.last:
+		records = records[-args.last:]
+	names = header['rule_names']
+
+	if args.summary:
+		print_summary(header, records, names)
+	elif args.csv:
+		print_csv(records, names)
+	else:
+		print_text(records, names)
+	return 0
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+
+# Waits for a lifecycle node to become active, then exits, so that a launch
+# file can start the nodes that depend on it from OnProcessExit. It is for
+# composable nodes, which launch_ros cannot watch or drive itself. With
+# drive it also configures and activates the node, as a lifecycle manager
+# would for a node that does not start itself.
+
+import sys
+
+import rclpy
+from rclpy.node import Node
+from lifecycle_msgs.msg import State, Transition
+from lifecycle_msgs.srv import ChangeState, GetState
+
+class LifecycleGate(Node):
+
+	def __init__(self):
+		super().__init__('lifecycle_gate')
+		self.target = self.declare_parameter('node', '/wall_follower').value
+		self.drive = self.declare_parameter('drive', False).value
+		self.get_state = self.create_client(GetState, self.target + '/get_state')
+		self.change_state = self.create_client(ChangeState, self.target + '/change_state')
+		self.timer = self.create_timer(0.2, self.timer_callback)
+
+		self.pending = None			# the service call in flight
+		self.requested = set()		# transitions asked for, each only once
+		self.done = False
+
+
+	def timer_callback(self):
+		if self.done or (self.pending is not None and not self.pending.done()):
+			return
+		if not self.get_state.service_is_ready():
+			return
+		self.pending = self.get_state.call_async(GetState.Request())
+		self.pending.add_done_callback(self.state_callback)
+
+
+	def state_callback(self, future):
+		state = future.result().current_state
+		if state.id == State.PRIMARY_STATE_ACTIVE:
+			self.get_logger().info('%s is active' % self.target)
+			self.done = True
+		elif self.drive and state.id == State.PRIMARY_STATE_UNCONFIGURED:
+			self.transition(Transition.TRANSITION_CONFIGURE, 'configure')
+		elif self.drive and state.id == State.PRIMARY_STATE_INACTIVE:
+			self.transition(Transition.TRANSITION_ACTIVATE, 'activate')
+
+
+	def transition(self, transition_id, label):
+		# A transition that failed is not retried, the node stays where it
+		# is for someone to look at
+		if transition_id in self.requested:
+			return
+		if not self.change_state.service_is_ready():
+			return
+		self.requested.add(transition_id)
+		self.get_logger().info('%s: %s' % (self.target, label))
+		request = ChangeState.Request()
+		request.transition.id = transition_id
+		self.pending = self.change_state.call_async(request)
+
+
+def main(args=None):
+	rclpy.init(args=args)
+	node = LifecycleGate()
+	try:
+		while rclpy.ok() and not node.done:
+			rclpy.spin_once(node, timeout_sec=0.5)
+	except KeyboardInterrupt:
+		pass
+	done = node.done
+	node.destroy_node()
+	rclpy.shutdown()
+	sys.exit(0 if done else 1)
+
+if __name__ == '__main__':
+	main()
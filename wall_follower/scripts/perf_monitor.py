@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+
+# Metrics of one perf_suite.launch.py scenario: lap time, CPU use of the
+# wall follower and perception processes, scan to command latency from the
+# wall follower's diagnostics, marker detection rate, and landmark error
+# against the markers in the world file. The result is appended to
+# results_file as one JSON object, and the node exits when the lap is done
+# or the scenario times out, which ends the launch.
+
+import json
+import math
+import os
+import sys
+import time
+import xml.etree.ElementTree as ET
+
+import yaml
+
+import rclpy
+from rclpy.node import Node
+from rclpy.qos import qos_profile_sensor_data
+from diagnostic_msgs.msg import DiagnosticArray
+from geometry_msgs.msg import PointStamped, Twist
+from nav_msgs.msg import Odometry
+from sensor_msgs.msg import Image
+from visualization_msgs.msg import MarkerArray
+
+# Processes whose CPU time is measured, by executable name
+processes = ('wall_follower', 'see_marker', 'point_transformer', 'marker_mapper')
+
+
+def find_processes():
+	"""
+	pid of each running process in processes, from /proc
+	"""
+	found = {}
+	for pid in os.listdir('/proc'):
+		if not pid.isdigit():
+			continue
+		try:
+			with open('/proc/%s/cmdline' % pid, 'rb') as f:
+				argv = f.read().split(b'\0')
+		except OSError:
+			continue
+		# Python nodes run as "python3 <script>"
+		for arg in argv[:2]:
+			name = os.path.basename(arg.decode(errors='replace'))
+			if name.endswith('.py'):
+				name = name[:-3]
+			if name in processes:
+				found[name] = int(pid)
+				break
+	return found
+
+
+def cpu_seconds(pid):
+	try:
+		with open('/proc/%d/stat' % pid, 'r') as f:
+			fields = f.read().rsplit(')', 1)[1].split()
+	except OSError:
+		return None
+	# utime and stime, fields 14 and 15 of stat(5)
+	return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+
+def ground_truth(world_file, spawn):
+	"""
+	Marker positions in the world file, in the map frame, keyed by marker
+	type ("pink_on_blue_marker" is "pink/blue"). Cartographer's map frame
+	starts at the robot's spawn pose.
+	"""
+	try:
+		world = ET.parse(world_file).getroot().find('world')
+	except (OSError, ET.ParseError):
+		return {}
+	if world is None:
+		return {}
+
+	# The saved state holds where the models ended up, if there is one
+	state = world.find('state')
+	models = (state if state is not None else world).findall('model')
+
+	sx, sy, syaw = spawn
+	c, s = math.cos(syaw), math.sin(syaw)
+	markers = {}
+	for model in models:
+		name = model.get('name', '')
+		pose = model.find('pose')
+		if not name.endswith('_marker') or pose is None:
+			continue
+		top, _, bottom = name[:-len('_marker')].partition('_on_')
+		x, y = [float(v) for v in pose.text.split()[:2]]
+		dx, dy = x - sx, y - sy
+		markers[top + '/' + bottom] = (c * dx + s * dy, -s * dx + c * dy)
+	return markers
+
+
+class PerfMonitor(Node):
+
+	def __init__(self):
+		super().__init__('perf_monitor')
+		self.scenario = self.declare_parameter('scenario', '').value
+		self.world_file = self.declare_parameter('world_file', '').value
+		self.spawn = list(self.declare_parameter('spawn', [0.0, 0.0, 0.0]).value)
+		self.timeout = self.declare_parameter('timeout', 300.0).value
+		self.limits = yaml.safe_load(self.declare_parameter('limits', '{}').value) or {}
+		self.results_file = self.declare_parameter('results_file', 'perf_results.jsonl').value
+		self.start_radius = self.declare_parameter('start_radius', 0.3).value
+		self.min_lap = self.declare_parameter('min_lap_distance', 2.0).value
+
+		self.create_subscription(Twist, 'cmd_vel', self.cmd_vel_callback, 10)
+		self.create_subscription(Odometry, 'odom', self.odom_callback, 10)
+		self.create_subscription(DiagnosticArray, 'diagnostics', self.diagnostics_callback, 10)
+		self.create_subscription(Image, 'camera/image_raw', self.image_callback, qos_profile_sensor_data)
+		self.create_subscription(PointStamped, 'marker_position', self.marker_callback, 10)
+		self.create_subscription(MarkerArray, 'visualization_marker_array', self.landmark_callback, 10)
+		self.timer = self.create_timer(1.0, self.timer_callback)
+
+		self.first_stamp = None		# sim time of the first odometry
+		self.lap_start = None		# sim time the robot started driving
+		self.lap_time = None
+		self.start_pose = None
+		self.last_pose = None
+		self.left_start = False
+		self.distance = 0.0
+
+		self.cpu_start = {}			# name -> (pid, cpu seconds, wall seconds)
+		self.wall_start = None
+
+		self.latency_p50 = None
+		self.latency_p99 = None
+
+		self.frames = 0
+		self.detection_stamps = set()
+		self.landmarks = {}
+		self.done = False
+		self.passed = False
+
+
+	def now_seconds(self):
+		return self.get_clock().now().nanoseconds * 1e-9
+
+
+	def cmd_vel_callback(self, msg):
+		if self.lap_start is None and (msg.linear.x != 0.0 or msg.angular.z != 0.0):
+			self.lap_start = self.now_seconds()
+			self.wall_start = time.monotonic()
+			self.start_cpu()
+			self.get_logger().info('Robot moving, lap started')
+
+
+	def start_cpu(self):
+		"""
+		Start measuring the CPU use of the processes not measured yet.
+		Perception starts once the wall follower is active, so it may only
+		show up after the lap has started.
+		"""
+		for name, pid in find_processes().items():
+			if name in self.cpu_start:
+				continue
+			cpu = cpu_seconds(pid)
+			if cpu is not None:
+				self.cpu_start[name] = (pid, cpu, time.monotonic())
+
+
+	def odom_callback(self, msg):
+		x = msg.pose.pose.position.x
+		y = msg.pose.pose.position.y
+		if self.first_stamp is None:
+			self.first_stamp = self.now_seconds()
+		if self.lap_start is None or self.lap_time is not None:
+			return
+
+		if self.start_pose is None:
+			self.start_pose = (x, y)
+		else:
+			self.distance += math.hypot(x - self.last_pose[0], y - self.last_pose[1])
+		self.last_pose = (x, y)
+
+		from_start = math.hypot(x - self.start_pose[0], y - self.start_pose[1])
+		if from_start > self.start_radius:
+			self.left_start = True
+		elif self.left_start and self.distance > self.min_lap:
+			self.lap_time = self.now_seconds() - self.lap_start
+			self.get_logger().info('Lap done in %.1f s, %.1f m' % (self.lap_time, self.distance))
+			self.finish()
+
+
+	def diagnostics_callback(self, msg):
+		for status in msg.status:
+			if not status.name.endswith('latency scan_to_cmd'):
+				continue
+			values = {kv.key: kv.value for kv in status.values}
+			if int(values.get('count', '0')) == 0:
+				continue
+			self.latency_p50 = float(values['p50_ms'])
+			self.latency_p99 = max(self.latency_p99 or 0.0, float(values['p99_ms']))
+
+
+	def image_callback(self, msg):
+		self.frames += 1
+
+
+	def marker_callback(self, msg):
+		self.detection_stamps.add((msg.header.stamp.sec, msg.header.stamp.nanosec))
+
+
+	def landmark_callback(self, msg):
+		for marker in msg.markers:
+			self.landmarks[marker.ns] = (marker.pose.position.x, marker.pose.position.y)
+
+
+	def timer_callback(self):
+		if self.wall_start is not None and len(self.cpu_start) < len(processes):
+			self.start_cpu()
+		if self.first_stamp is not None and self.now_seconds() - self.first_stamp > self.timeout:
+			self.get_logger().warn('Scenario timed out after %.0f s' % self.timeout)
+			self.finish()
+
+
+	def finish(self):
+		if self.done:
+			return
+		self.done = True
+
+		cpu = {}
+		for name, (pid, start, wall_start) in self.cpu_start.items():
+			end = cpu_seconds(pid)
+			wall = time.monotonic() - wall_start
+			if end is not None and wall > 0.0:
+				cpu[name] = 100.0 * (end - start) / wall
+
+		truth = ground_truth(self.world_file, self.spawn)
+		errors = {}
+		for mtype, (x, y) in truth.items():
+			if mtype in self.landmarks:
+				lx, ly = self.landmarks[mtype]
+				errors[mtype] = math.hypot(lx - x, ly - y)
+
+		detection_rate = len(self.detection_stamps) / self.frames if self.frames else None
+		result = {
+			'scenario': self.scenario,
+			'lap_time': self.lap_time,
+			'distance': self.distance,
+			'cpu_percent': cpu,
+			'scan_to_cmd_p50_ms': self.latency_p50,
+			'scan_to_cmd_p99_ms': self.latency_p99,
+			'camera_frames': self.frames,
+			'detection_frames': len(self.detection_stamps),
+			'detection_rate': detection_rate,
+			'markers_expected': len(truth),
+			'markers_found': len(errors),
+			'landmark_errors': errors,
+			'landmark_error': max(errors.values()) if errors else None,
+		}
+
+		# Upper limits, except detection_rate which is a lower limit. A
+		# missing metric fails its limit.
+		measured = {
+			'lap_time': self.lap_time,
+			'scan_to_cmd_p99_ms': self.latency_p99,
+			'wall_follower_cpu': cpu.get('wall_follower'),
+			'detection_rate': detection_rate,
+			'landmark_error': result['landmark_error'],
+		}
+		failures = []
+		for key, limit in self.limits.items():
+			value = measured.get(key)
+			if value is None:
+				failures.append('%s not measured' % key)
+			elif key == 'detection_rate' and value < limit:
+				failures.append('%s %.3f < %.3f' % (key, value, limit))
+			elif key != 'detection_rate' and value > limit:
+				failures.append('%s %.3f > %.3f' % (key, value, limit))
+		if truth and len(errors) < len(truth):
+			failures.append('%d of %d markers mapped' % (len(errors), len(truth)))
+		result['failures'] = failures
+		result['passed'] = not failures
+		self.passed = result['passed']
+
+		with open(self.results_file, 'a') as f:
+			f.write(json.dumps(result) + '\n')
+		for failure in failures:
+			self.get_logger().error('%s: %s' % (self.scenario, failure))
+		self.get_logger().info('%s: %s' % (self.scenario, 'passed' if result['passed'] else 'FAILED'))
+
+
+def main(args=None):
+	rclpy.init(args=args)
+	node = PerfMonitor()
+	try:
+		while rclpy.ok() and not node.done:
+			rclpy.spin_once(node, timeout_sec=0.5)
+	except KeyboardInterrupt:
+		pass
+	passed = node.passed
+	node.destroy_node()
+	rclpy.shutdown()
+	sys.exit(0 if passed else 1)
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,36 @@
+#!/bin/bash
+# Run the performance scenarios one after another and fail if any is out of
+# its limits. Usage: perf_suite.bash [results file] [scenario ...]
+# With no scenarios, every scenario in config/perf_scenarios.yaml is run.
+
+results=${1:-perf_results.jsonl}
+shift
+scenarios_file=$(ros2 pkg prefix wall_follower)/share/wall_follower/config/perf_scenarios.yaml
+scenarios=${@:-$(python3 -c "import sys, yaml; print(' '.join(s['name'] for s in yaml.safe_load(open(sys.argv[1]))['scenarios']))" "$scenarios_file")}
+
+rm -f "$results"
+for scenario in $scenarios; do
+	ros2 launch wall_follower perf_suite.launch.py scenario:=$scenario results_file:=$(realpath "$results")
+done
+
+python3 - "$results" $scenarios <<'PY'
+import json, sys
+results = {}
+for line in open(sys.argv[1]):
+	r = json.loads(line)
+	results[r['scenario']] = r
+failed = 0
+for name in sys.argv[2:]:
+	r = results.get(name)
+	if r is None:
+		print('%-10s no result' % name)
+		failed += 1
+		continue
+	lap = '%.1f s' % r['lap_time'] if r['lap_time'] is not None else '-'
+	p99 = '%.2f ms' % r['scan_to_cmd_p99_ms'] if r['scan_to_cmd_p99_ms'] is not None else '-'
+	cpu = '%.1f %%' % r['cpu_percent']['wall_follower'] if 'wall_follower' in r['cpu_percent'] else '-'
+	print('%-10s %-6s lap %-8s scan->cmd p99 %-9s cpu %-7s %s' % (name, 'pass' if r['passed'] else 'FAIL',
+		lap, p99, cpu, '; '.join(r['failures'])))
+	failed += not r['passed']
+sys.exit(1 if failed else 0)
+PY
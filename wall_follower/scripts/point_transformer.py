@@ -1,7 +1,10 @@
 #!/usr/bin/env python3
 
+from collections import defaultdict
+
 import rclpy
 from rclpy.node import Node
+from rclpy.qos import QoSDurabilityPolicy, QoSProfile
 from geometry_msgs.msg import PointStamped
 import tf2_ros
 import tf2_geometry_msgs
@@ -10,6 +13,7 @@ from visualization_msgs.msg import MarkerArray
 
 import wall_follower.landmark
 from wall_follower.landmark import marker_type, max_markers, Landmark
+from wall_follower.landmark_store import LandmarkStore
 
 class PointTransformer(Node):
 
@@ -17,8 +21,10 @@ class PointTransformer(Node):
 		super().__init__('point_transformer')
 		self.tf_buffer = tf2_ros.Buffer()
 		self.tf_listener = tf2_ros.TransformListener(self.tf_buffer, self)
-		self.point_subscriber = self.create_subscription(PointStamped, '/marker_position', self.point_callback, 10)
-		self.marker_publisher_ = self.create_publisher(MarkerArray, 'visualization_marker_array', 10)
+		self.point_subscriber = self.create_subscription(PointStamped, 'marker_position', self.point_callback, 10)
+		# Transient local, so that late subscribers get the markers already published
+		self.marker_publisher_ = self.create_publisher(MarkerArray, 'visualization_marker_array',
+			QoSProfile(depth=10, durability=QoSDurabilityPolicy.TRANSIENT_LOCAL))
 
 		self.marker_position = []
 		self.marker_array = MarkerArray()			
@@ -27,8 +33,58 @@ class PointTransformer(Node):
 		for i in range(max_markers):
 			self.marker_position.append(Landmark(i, self.marker_array.markers))
 
+		# Batched mode: points are queued and transformed together every
+		# batch_period, with one transform lookup per frame and stamp bucket.
+		# Only the landmarks that changed are published, every publish_period.
+		self.batched = self.declare_parameter('batched', True).value
+		self.stamp_bucket = int(self.declare_parameter('stamp_bucket', 0.05).value * 1e9)
+		batch_period = self.declare_parameter('batch_period', 0.1).value
+		publish_period = self.declare_parameter('publish_period', 0.5).value
+
+		self.pending_points = []
+		self.changed = set()
+
+		if self.batched:
+			self.batch_timer = self.create_timer(batch_period, self.batch_callback)
+			self.publish_timer = self.create_timer(publish_period, self.publish_callback)
+
+		# Landmarks are saved to snapshot_file as they change and loaded
+		# from it at startup, so a restart does not lose the map
+		snapshot_file = self.declare_parameter('snapshot_file', '').value
+		snapshot_period = self.declare_parameter('snapshot_period', 1.0).value
+		self.store = None
+		if snapshot_file:
+			self.store = LandmarkStore(snapshot_file, max_markers)
+			records = self.store.load()
+			for mtype, count, x, y, cov_xx, cov_xy, cov_yy in records:
+				self.marker_position[mtype].restore(count, x, y, cov_xx, cov_xy, cov_yy)
+			self.store.start(snapshot_period)
+			if records:
+				self.get_logger().info('Loaded %d landmarks from %s' % (len(records), snapshot_file))
+				# Batched mode sends them on the first publish tick. Unbatched,
+				# the publisher's transient local history delivers them.
+				if self.batched:
+					self.changed.update(record[0] for record in records)
+				else:
+					self.marker_publisher_.publish(self.marker_array)
+
+
+	def destroy_node(self):
+		if self.store:
+			self.store.close()
+		super().destroy_node()
+
+
+	def landmark_changed(self, which_marker):
+		if self.store:
+			self.store.update(self.marker_position[which_marker])
+
 
 	def point_callback(self, msg):
+		if self.batched:
+			self.pending_points.append(msg)
+			return
+
 		try:
 			# Lookup the transform from the camera_rgb_optical_frame to the map frame
 			transform = self.tf_buffer.lookup_transform('map', msg.header.frame_id, rclpy.time.Time())
@@ -46,14 +102,67 @@ class PointTransformer(Node):
 		# Print the transformed point in the map frame
 #		self.get_logger().info(f'Mapped {m} marker to /map frame: x={map_point.point.x}, y={map_point.point.y}, z={map_point.point.z}')
 
-		self.marker_position[which_marker].update_position(map_point.point)
-		self.marker_publisher_.publish(self.marker_array)
+		# Rejected or negligible updates are not worth a republish
+		if self.marker_position[which_marker].update_position(map_point.point):
+			self.landmark_changed(which_marker)
+			self.marker_publisher_.publish(self.marker_array)
+
+
+	def lookup_bucket(self, frame_id, bucket):
+		# Transform at the middle of the bucket, or the latest one if the
+		# buffer does not reach that far
+		stamp = rclpy.time.Time(nanoseconds=bucket * self.stamp_bucket + self.stamp_bucket // 2)
+		try:
+			return self.tf_buffer.lookup_transform('map', frame_id, stamp)
+		except tf2_ros.ExtrapolationException:
+			return self.tf_buffer.lookup_transform('map', frame_id, rclpy.time.Time())
+
+
+	def batch_callback(self):
+		if not self.pending_points:
+			return
+		points, self.pending_points = self.pending_points, []
+
+		batches = defaultdict(list)
+		for msg in points:
+			stamp = rclpy.time.Time.from_msg(msg.header.stamp).nanoseconds
+			batches[(msg.header.frame_id, stamp // self.stamp_bucket)].append(msg)
+
+		for (frame_id, bucket), msgs in batches.items():
+			try:
+				transform = self.lookup_bucket(frame_id, bucket)
+			except (tf2_ros.LookupException, tf2_ros.ConnectivityException,
+					tf2_ros.ExtrapolationException) as e:
+				self.get_logger().error('Transform lookup failed: %s' % str(e))
+				continue
+
+			for msg in msgs:
+				which_marker = int(msg.point.z)
+				msg.point.z = 0.0
+				map_point = tf2_geometry_msgs.do_transform_point(msg, transform)
+				if self.marker_position[which_marker].update_position(map_point.point):
+					self.landmark_changed(which_marker)
+					self.changed.add(which_marker)
+
+
+	def publish_callback(self):
+		if not self.changed:
+			return
+		changed_markers = MarkerArray()
+		for which_marker in sorted(self.changed):
+			changed_markers.markers.extend(self.marker_position[which_marker].markers_of())
+		self.changed.clear()
+		self.marker_publisher_.publish(changed_markers)
 
 
 def main(args=None):
 	rclpy.init(args=args)
 	node = PointTransformer()
-	rclpy.spin(node)
+	try:
+		rclpy.spin(node)
+	except KeyboardInterrupt:
+		pass
+	node.destroy_node()
 	rclpy.shutdown()
 
 if __name__ == '__main__':
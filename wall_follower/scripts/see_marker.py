@@ -45,7 +45,7 @@ class SeeMarker(Node):
 		# from the video_frames topic. The queue size is 10 messages.
 		self.subscription = self.create_subscription(
 			Image,
-			'/camera/image_raw', 
+			'camera/image_raw', 
 			self.listener_callback, 
 			10)
 		self.subscription # prevent unused variable warning
@@ -53,7 +53,7 @@ class SeeMarker(Node):
 		# Used to convert between ROS and OpenCV images
 		self.br = CvBridge()
 
-		self.point_publisher = self.create_publisher(PointStamped, '/marker_position', 10)
+		self.point_publisher = self.create_publisher(PointStamped, 'marker_position', 10)
 
 
 	def listener_callback(self, data):
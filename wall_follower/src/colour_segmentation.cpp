@@ -0,0 +1,174 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/colour_segmentation.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+
+
+/********************************************************************************
+** ColourClassifier
+********************************************************************************/
+
+ColourClassifier::ColourClassifier(const HsvRange * ranges, int num_colours)
+{
+	const int levels = 1 << LUT_BITS;
+	const int shift = 8 - LUT_BITS;
+	const int size = levels * levels * levels;
+
+	// Convert the centre of every BGR cell to HSV with OpenCV, so the table
+	// agrees with cv::cvtColor + cv::inRange up to the quantisation
+	cv::Mat bgr(1, size, CV_8UC3);
+	for (int i = 0; i < size; i++)
+	{
+		cv::Vec3b & p = bgr.at<cv::Vec3b>(0, i);
+		p[0] = (uint8_t) ((((i >> (2 * LUT_BITS)) & (levels - 1)) << shift) + (1 << shift) / 2);
+		p[1] = (uint8_t) ((((i >> LUT_BITS) & (levels - 1)) << shift) + (1 << shift) / 2);
+		p[2] = (uint8_t) (((i & (levels - 1)) << shift) + (1 << shift) / 2);
+	}
+	cv::Mat hsv;
+	cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+
+	lut_.assign(size, NO_COLOUR);
+	for (int i = 0; i < size; i++)
+	{
+		const cv::Vec3b & p = hsv.at<cv::Vec3b>(0, i);
+		for (int c = 0; c < num_colours; c++)
+		{
+			const HsvRange & r = ranges[c];
+			if (p[0] >= r.lower[0] && p[0] <= r.upper[0] &&
+				p[1] >= r.lower[1] && p[1] <= r.upper[1] &&
+				p[2] >= r.lower[2] && p[2] <= r.upper[2])
+			{
+				lut_[i] = (uint8_t) (c + 1);
+				break;
+			}
+		}
+	}
+}
+
+void ColourClassifier::classify(const cv::Mat & bgr, cv::Mat & labels, int step) const
+{
+	labels.create((bgr.rows + step - 1) / step, (bgr.cols + step - 1) / step, CV_8UC1);
+	for (int y = 0; y < labels.rows; y++)
+	{
+		const uint8_t * p = bgr.ptr<uint8_t>(y * step);
+		uint8_t * l = labels.ptr<uint8_t>(y);
+		for (int x = 0; x < labels.cols; x++, p += 3 * step)
+			l[x] = label(p[0], p[1], p[2]);
+	}
+}
+
+
+/********************************************************************************
+** ComponentLabeller
+********************************************************************************/
+
+int ComponentLabeller::find(int i)
+{
+	while (parent_[i] != i)
+	{
+		parent_[i] = parent_[parent_[i]];
+		i = parent_[i];
+	}
+	return i;
+}
+
+// Roots always point at the smaller id, so parent_[i] <= i
+int ComponentLabeller::unite(int a, int b)
+{
+	a = find(a);
+	b = find(b);
+	if (a < b)
+		std::swap(a, b);
+	parent_[a] = b;
+	return b;
+}
+
+void ComponentLabeller::label(const uint8_t * labels, int rows, int cols, size_t step,
+	std::vector<Component> & components, int offset_x, int offset_y)
+{
+	components.clear();
+	ids_.resize((size_t) rows * cols);
+	parent_.assign(1, 0);		// id 0 is the background
+
+	// First pass: provisional ids, merging with the left and upper
+	// neighbours when they have the same label
+	for (int y = 0; y < rows; y++)
+	{
+		const uint8_t * l = labels + y * step;
+		const uint8_t * l_up = y > 0 ? l - step : l;
+		int * id = ids_.data() + (size_t) y * cols;
+		const int * id_up = y > 0 ? id - cols : id;
+
+		for (int x = 0; x < cols; x++)
+		{
+			uint8_t c = l[x];
+			if (c == NO_COLOUR)
+			{
+				id[x] = 0;
+				continue;
+			}
+			int left = (x > 0 && l[x - 1] == c) ? id[x - 1] : 0;
+			int up = (y > 0 && l_up[x] == c) ? id_up[x] : 0;
+
+			if (left && up)
+				id[x] = left == up ? left : unite(left, up);
+			else if (left || up)
+				id[x] = left | up;
+			else
+			{
+				id[x] = (int) parent_.size();
+				parent_.push_back(id[x]);
+			}
+		}
+	}
+
+	// Flatten so every id points at its root. Since parent_[i] <= i, one
+	// pass in increasing order is enough.
+	for (size_t i = 1; i < parent_.size(); i++)
+		parent_[i] = parent_[parent_[i]];
+
+	// Second pass: statistics per root
+	index_.assign(parent_.size(), -1);
+	for (int y = 0; y < rows; y++)
+	{
+		const uint8_t * l = labels + y * step;
+		const int * id = ids_.data() + (size_t) y * cols;
+		for (int x = 0; x < cols; x++)
+		{
+			if (id[x] == 0)
+				continue;
+			int & k = index_[parent_[id[x]]];
+			if (k < 0)
+			{
+				k = (int) components.size();
+				Component comp;
+				comp.colour = l[x] - 1;
+				comp.area = 0;
+				comp.left = comp.right = x + offset_x;
+				comp.top = comp.bottom = y + offset_y;
+				comp.sum_x = comp.sum_y = 0.0;
+				components.push_back(comp);
+			}
+			Component & comp = components[k];
+			comp.area++;
+			comp.left = std::min(comp.left, x + offset_x);
+			comp.right = std::max(comp.right, x + offset_x);
+			comp.bottom = y + offset_y;
+			comp.sum_x += x + offset_x;
+			comp.sum_y += y + offset_y;
+		}
+	}
+}
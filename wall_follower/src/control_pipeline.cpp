@@ -0,0 +1,129 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/control_pipeline.hpp"
+
+#include <cmath>
+
+
+/********************************************************************************
+** StartDetector
+********************************************************************************/
+
+bool StartDetector::update(double x, double y)
+{
+	if (first_)
+	{
+		start_x_ = x;
+		start_y_ = y;
+		first_ = false;
+	}
+	else if (start_moving_)
+	{
+		if (fabs(x - start_x_) > range_ || fabs(y - start_y_) > range_)
+			start_moving_ = false;
+	}
+	else if (fabs(x - start_x_) < range_ && fabs(y - start_y_) < range_)
+	{
+		near_start_ = true;
+		first_ = true;
+		start_moving_ = true;
+		return true;
+	}
+	return false;
+}
+
+
+/********************************************************************************
+** ControlPipeline
+********************************************************************************/
+
+bool parse_steering_mode(const std::string & name, SteeringMode & mode)
+{
+	if (name == "rules")
+		mode = SteeringMode::RULES;
+	else if (name == "gap")
+		mode = SteeringMode::GAP;
+	else if (name == "wall_pid")
+		mode = SteeringMode::WALL_PID;
+	else
+		return false;
+	return true;
+}
+
+ControlPipeline::ControlPipeline()
+{
+	set_beam_width(BEAM_WIDTH * DEG2RAD);
+}
+
+void ControlPipeline::set_beam_width(double half_width)
+{
+	// Sectors FRONT .. FRONT_RIGHT, anticlockwise from the front of the robot
+	double sector_angle[NUM_SECTORS];
+	for (int i = 0; i < NUM_SECTORS; i++)
+		sector_angle[i] = i * SECTOR_SPACING * DEG2RAD;
+	reducer_.set_sectors(sector_angle, NUM_SECTORS, half_width);
+}
+
+bool ControlPipeline::reduce(const ScanGeometry & geometry, const float * ranges, float range_min,
+	float range_max, double * sectors)
+{
+	if (!reducer_.update(geometry))
+		return false;
+
+	// Minimum (or a low percentile) of the valid ranges in each sector
+	reducer_.reduce_percentile(ranges, range_min, range_max, percentile_, sectors);
+	return true;
+}
+
+bool ControlPipeline::steer(const ScanGeometry & geometry, const float * ranges, float range_min,
+	float range_max, double stamp, Command & cmd)
+{
+	// First scan, or the clock jumped: assume a nominal 5 Hz lidar
+	double dt = stamp - last_stamp_;
+	if (!(dt > 0.0 && dt < 1.0))
+		dt = 0.2;
+	last_stamp_ = stamp;
+
+	cmd.rule = STEER_RULE;
+	switch (steering_mode_)
+	{
+	case SteeringMode::GAP:
+		return gap_planner_.plan(geometry, ranges, range_min, range_max, cmd.linear, cmd.angular);
+	case SteeringMode::WALL_PID:
+		return wall_controller_.control(geometry, ranges, range_min, range_max, dt, cmd.linear, cmd.angular);
+	default:
+		return false;
+	}
+}
+
+Command ControlPipeline::decide(const double * sectors, bool near_start, const Command * steered) const
+{
+	Command cmd;
+	if (near_start)
+	{
+		cmd.linear = 0.0;
+		cmd.angular = 0.0;
+		cmd.rule = NEAR_START_RULE;
+		return cmd;
+	}
+	if (steered && steering_mode_ != SteeringMode::RULES)
+		return *steered;
+
+	// One rule fires per tick
+	size_t fired = rules_.evaluate(sectors);
+	const Rule & rule = rules_.rule(fired);
+	cmd.linear = rule.linear;
+	cmd.angular = rule.angular;
+	cmd.rule = (int) fired;
+	return cmd;
+}
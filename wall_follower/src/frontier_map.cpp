@@ -0,0 +1,239 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/frontier_map.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+static inline bool is_free(int8_t v)
+{
+	return v >= 0 && v < FRONTIER_FREE;
+}
+
+static inline long floor_div(long a, long b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Where the map's cell (0, 0) falls in the current tiling, if the tiling
+// still fits it: same resolution, origin moved by whole cells
+bool FrontierMap::place(const GridInfo & info, long & cell_x, long & cell_y) const
+{
+	if (tiles_.empty() || info.resolution != info_.resolution)
+		return false;
+	double fx = (info.origin_x - anchor_x_) / info.resolution;
+	double fy = (info.origin_y - anchor_y_) / info.resolution;
+	cell_x = std::lround(fx);
+	cell_y = std::lround(fy);
+	return std::fabs(fx - cell_x) < 1e-3 && std::fabs(fy - cell_y) < 1e-3;
+}
+
+// Cover the map with tiles, keeping the tiles it already had. New tiles
+// start off the map, so loading them counts as a change.
+void FrontierMap::layout(const GridInfo & info, long cell_x, long cell_y)
+{
+	const long tile_x = floor_div(cell_x, FRONTIER_TILE);
+	const long tile_y = floor_div(cell_y, FRONTIER_TILE);
+	const size_t tiles_x = floor_div(cell_x + (long) info.width - 1, FRONTIER_TILE) - tile_x + 1;
+	const size_t tiles_y = floor_div(cell_y + (long) info.height - 1, FRONTIER_TILE) - tile_y + 1;
+	cell_x_ = cell_x;
+	cell_y_ = cell_y;
+	if (tile_x == tile_x_ && tile_y == tile_y_ && tiles_x == tiles_x_ && tiles_y == tiles_y_)
+		return;
+
+	Tile outside;
+	outside.result = FrontierTile{0, 0.0, 0.0};
+	std::memset(outside.cells, FRONTIER_OUTSIDE, sizeof(outside.cells));
+	std::vector<Tile> tiles(tiles_x * tiles_y, outside);
+	frontier_cells_ = 0;
+	for (size_t ty = 0; ty < tiles_y; ty++)
+	{
+		long old_y = tile_y + (long) ty - tile_y_;
+		if (old_y < 0 || old_y >= (long) tiles_y_)
+			continue;
+		for (size_t tx = 0; tx < tiles_x; tx++)
+		{
+			long old_x = tile_x + (long) tx - tile_x_;
+			if (old_x < 0 || old_x >= (long) tiles_x_)
+				continue;
+			Tile & tile = tiles[ty * tiles_x + tx];
+			tile = tiles_[old_y * tiles_x_ + old_x];
+			frontier_cells_ += tile.result.cells;
+		}
+	}
+	tiles_.swap(tiles);
+	tile_x_ = tile_x;
+	tile_y_ = tile_y;
+	tiles_x_ = tiles_x;
+	tiles_y_ = tiles_y;
+	dirty_.assign(tiles_.size(), 0);
+}
+
+size_t FrontierMap::update(const GridInfo & info, const int8_t * data)
+{
+	long cell_x = 0, cell_y = 0;
+	if (info.width == 0 || info.height == 0 || !(info.resolution > 0.0))
+	{
+		info_ = info;
+		tiles_.clear();
+		dirty_.clear();
+		tiles_x_ = tiles_y_ = 0;
+		frontier_cells_ = 0;
+		return 0;
+	}
+	if (!place(info, cell_x, cell_y))
+	{
+		// Start a new tiling at this map's origin
+		tiles_.clear();
+		tiles_x_ = tiles_y_ = 0;
+		anchor_x_ = info.origin_x;
+		anchor_y_ = info.origin_y;
+		cell_x = cell_y = 0;
+	}
+	info_ = info;
+	layout(info, cell_x, cell_y);
+
+	// A changed edge cell can make or break a frontier next door
+	for (size_t ty = 0; ty < tiles_y_; ty++)
+		for (size_t tx = 0; tx < tiles_x_; tx++)
+		{
+			if (!load_tile(ty * tiles_x_ + tx, data))
+				continue;
+			for (size_t ny = ty ? ty - 1 : 0; ny <= std::min(ty + 1, tiles_y_ - 1); ny++)
+				for (size_t nx = tx ? tx - 1 : 0; nx <= std::min(tx + 1, tiles_x_ - 1); nx++)
+					dirty_[ny * tiles_x_ + nx] = 1;
+		}
+
+	size_t scanned = 0;
+	for (size_t i = 0; i < tiles_.size(); i++)
+		if (dirty_[i])
+		{
+			scan_tile(i, data);
+			dirty_[i] = 0;
+			scanned++;
+		}
+	return scanned;
+}
+
+// Copy the tile's cells from the map, returning true if they changed
+bool FrontierMap::load_tile(size_t i, const int8_t * data)
+{
+	const long width = info_.width, height = info_.height;
+	// Map cell of the tile's first cell
+	const long x0 = (tile_x_ + (long) (i % tiles_x_)) * FRONTIER_TILE - cell_x_;
+	const long y0 = (tile_y_ + (long) (i / tiles_x_)) * FRONTIER_TILE - cell_y_;
+	const long in_begin = std::max(0L, -x0), in_end = std::min((long) FRONTIER_TILE, width - x0);
+
+	int8_t cells[FRONTIER_TILE * FRONTIER_TILE];
+	for (long ly = 0; ly < FRONTIER_TILE; ly++)
+	{
+		int8_t * row = cells + ly * FRONTIER_TILE;
+		long y = y0 + ly;
+		if (y < 0 || y >= height || in_end <= in_begin)
+		{
+			std::memset(row, FRONTIER_OUTSIDE, FRONTIER_TILE);
+			continue;
+		}
+		std::memset(row, FRONTIER_OUTSIDE, in_begin);
+		std::memcpy(row + in_begin, data + y * width + x0 + in_begin, in_end - in_begin);
+		std::memset(row + in_end, FRONTIER_OUTSIDE, FRONTIER_TILE - in_end);
+	}
+
+	Tile & tile = tiles_[i];
+	if (!std::memcmp(tile.cells, cells, sizeof(cells)))
+		return false;
+	std::memcpy(tile.cells, cells, sizeof(cells));
+	return true;
+}
+
+void FrontierMap::scan_tile(size_t i, const int8_t * data)
+{
+	const size_t width = info_.width, height = info_.height;
+	const long tx0 = (tile_x_ + (long) (i % tiles_x_)) * FRONTIER_TILE - cell_x_;
+	const long ty0 = (tile_y_ + (long) (i / tiles_x_)) * FRONTIER_TILE - cell_y_;
+	const size_t x0 = std::max(0L, tx0), x1 = std::min((long) width, tx0 + FRONTIER_TILE);
+	const size_t y0 = std::max(0L, ty0), y1 = std::min((long) height, ty0 + FRONTIER_TILE);
+	const int8_t * g = data;
+
+	// Frontier cells of the tile, as a bit per cell
+	uint32_t mask[FRONTIER_TILE] = {};
+	uint32_t count = 0;
+	double sum_x = 0.0, sum_y = 0.0;
+	for (size_t y = y0; y < y1; y++)
+	{
+		const int8_t * row = g + y * width;
+		for (size_t x = x0; x < x1; x++)
+		{
+			if (!is_free(row[x]))
+				continue;
+			bool frontier = (x > 0 && row[x - 1] < 0) || (x + 1 < width && row[x + 1] < 0) ||
+				(y > 0 && row[x - width] < 0) || (y + 1 < height && row[x + width] < 0);
+			if (!frontier)
+				continue;
+			mask[y - ty0] |= 1u << (x - tx0);
+			count++;
+			sum_x += x;
+			sum_y += y;
+		}
+	}
+
+	FrontierTile & tile = tiles_[i].result;
+	frontier_cells_ -= tile.cells;
+	frontier_cells_ += count;
+	tile.cells = count;
+	if (count == 0)
+		return;
+
+	// The frontier cell nearest the centroid, so that the target is on the
+	// frontier even when it curves
+	double cx = sum_x / count, cy = sum_y / count;
+	double best = INFINITY;
+	size_t best_x = x0, best_y = y0;
+	for (size_t y = y0; y < y1; y++)
+		for (size_t x = x0; x < x1; x++)
+		{
+			if (!(mask[y - ty0] & (1u << (x - tx0))))
+				continue;
+			double d = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+			if (d < best)
+			{
+				best = d;
+				best_x = x;
+				best_y = y;
+			}
+		}
+	tile.x = info_.origin_x + (best_x + 0.5) * info_.resolution;
+	tile.y = info_.origin_y + (best_y + 0.5) * info_.resolution;
+}
+
+bool FrontierMap::nearest(double x, double y, double min_distance, double & target_x, double & target_y,
+	uint32_t min_cells) const
+{
+	double best = INFINITY;
+	for (const Tile & t : tiles_)
+	{
+		const FrontierTile & tile = t.result;
+		if (tile.cells < min_cells)
+			continue;
+		double d = std::hypot(tile.x - x, tile.y - y);
+		if (d >= min_distance && d < best)
+		{
+			best = d;
+			target_x = tile.x;
+			target_y = tile.y;
+		}
+	}
+	return std::isfinite(best);
+}
@@ -0,0 +1,134 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/gap_planner.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+void GapPlanner::configure(const GapConfig & config)
+{
+	config_ = config;
+	fan_.set_window(-config.half_fov, config.half_fov);
+	angular_ = 0.0;
+}
+
+bool GapPlanner::plan(const ScanGeometry & geometry, const float * ranges, float range_min, float range_max,
+	double & linear, double & angular)
+{
+	if (!fan_.update(geometry))
+		return false;
+
+	const size_t n = fan_.size();
+	const double step = fan_.step();
+	const float lookahead = (float) config_.lookahead;
+	work_.resize(n);
+
+	// Clip to the lookahead. Invalid readings are free space, as in the
+	// sector reduction; angles the lidar does not cover are blocked.
+	size_t nearest = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		int32_t beam = fan_.index(i);
+		float r = 0.0f;
+		if (beam >= 0)
+		{
+			r = ranges[beam];
+			r = (r >= range_min && r <= range_max) ? std::min(r, lookahead) : lookahead;
+		}
+		work_[i] = r;
+		if (r < work_[nearest])
+			nearest = i;
+	}
+
+	// Safety bubble around the nearest obstacle
+	const double r_nearest = work_[nearest];
+	const double bubble = r_nearest > config_.safety_radius ? std::asin(config_.safety_radius / r_nearest) : M_PI_2;
+	const size_t bubble_steps = (size_t) std::ceil(bubble / step);
+	for (size_t i = nearest > bubble_steps ? nearest - bubble_steps : 0;
+		i < std::min(n, nearest + bubble_steps + 1); i++)
+		work_[i] = 0.0f;
+
+	// Gaps are runs of beams beyond the clearance. A gap is passable if its
+	// arc at the clearance distance fits the robot.
+	const float clearance = (float) config_.clearance;
+	const double min_arc = 2.0 * config_.safety_radius;
+	long best_begin = -1, best_end = -1;
+	for (size_t i = 0; i < n; )
+	{
+		if (work_[i] <= clearance)
+		{
+			i++;
+			continue;
+		}
+		size_t begin = i;
+		while (i < n && work_[i] > clearance)
+			i++;
+		size_t width = i - begin;
+		if (width * step * config_.clearance < min_arc)
+			continue;
+		// Beams run right to left, so with prefer_left the last gap wins
+		if (best_begin < 0 || config_.prefer_left || width > (size_t) (best_end - best_begin))
+		{
+			best_begin = (long) begin;
+			best_end = (long) i;
+		}
+	}
+
+	double target_linear = 0.0;
+	double target_angular;
+	if (best_begin < 0)
+	{
+		// Boxed in: turn away from the wall being followed
+		target_angular = config_.prefer_left ? -config_.max_angular : config_.max_angular;
+	}
+	else
+	{
+		// Aim between the middle of the gap and the middle of its deepest
+		// beams (often several at the lookahead)
+		long deepest_first = best_begin, deepest_last = best_begin;
+		for (long i = best_begin; i < best_end; i++)
+		{
+			if (work_[i] > work_[deepest_first])
+				deepest_first = deepest_last = i;
+			else if (work_[i] == work_[deepest_first])
+				deepest_last = i;
+		}
+		double centre = 0.5 * (fan_.angle(best_begin) + fan_.angle(best_end - 1));
+		double deepest = 0.5 * (fan_.angle(deepest_first) + fan_.angle(deepest_last));
+		double heading = 0.5 * (centre + deepest);
+		target_angular = std::max(-config_.max_angular, std::min(config_.max_angular,
+			config_.heading_gain * heading));
+
+		// Free distance ahead in the corridor swept by the robot
+		double front = config_.lookahead;
+		for (size_t i = 0; i < n; i++)
+		{
+			double a = fan_.angle(i);
+			int32_t beam = fan_.index(i);
+			if (beam < 0 || std::fabs(a) >= M_PI_2)
+				continue;
+			float r = ranges[beam];
+			if (r >= range_min && r <= range_max && r * std::fabs(std::sin(a)) <= config_.safety_radius)
+				front = std::min(front, r * std::cos(a));
+		}
+		double speed = (front - config_.stop_distance) / (config_.lookahead - config_.stop_distance);
+		speed = std::max(0.0, std::min(1.0, speed));
+		target_linear = config_.max_linear * speed * (1.0 - 0.5 * std::fabs(target_angular) / config_.max_angular);
+	}
+
+	angular_ = config_.smoothing * angular_ + (1.0 - config_.smoothing) * target_angular;
+	linear = target_linear;
+	angular = angular_;
+	return true;
+}
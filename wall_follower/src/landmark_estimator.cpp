@@ -0,0 +1,86 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/landmark_estimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+LandmarkEstimator::LandmarkEstimator(const LandmarkConfig & config)
+: config_(config)
+{
+}
+
+void LandmarkEstimator::reset()
+{
+	count_ = 0;
+	rejects_ = 0;
+	mean_x_ = mean_y_ = 0.0;
+	var_xx_ = var_xy_ = var_yy_ = 0.0;
+}
+
+void LandmarkEstimator::restore(uint32_t count, double x, double y, double cov_xx, double cov_xy, double cov_yy)
+{
+	reset();
+	count_ = count;
+	mean_x_ = shown_x_ = x;
+	mean_y_ = shown_y_ = y;
+	var_xx_ = cov_xx;
+	var_xy_ = cov_xy;
+	var_yy_ = cov_yy;
+	seen_ = count > 0;
+}
+
+double LandmarkEstimator::mahalanobis2(double x, double y) const
+{
+	const double min_var = config_.min_sigma * config_.min_sigma;
+	double dx = x - mean_x_;
+	double dy = y - mean_y_;
+	double a = var_xx_ + min_var;
+	double b = var_xy_;
+	double d = var_yy_ + min_var;
+	double det = a * d - b * b;
+	return (d * dx * dx - 2.0 * b * dx * dy + a * dy * dy) / det;
+}
+
+bool LandmarkEstimator::update(double x, double y)
+{
+	if (count_ >= config_.min_count && mahalanobis2(x, y) > config_.gate)
+	{
+		if (++rejects_ < config_.max_rejects)
+			return false;
+		reset();
+	}
+
+	rejects_ = 0;
+	count_++;
+	double w = std::max(1.0 / count_, config_.alpha);
+	double dx = x - mean_x_;
+	double dy = y - mean_y_;
+	mean_x_ += w * dx;
+	mean_y_ += w * dy;
+
+	// Welford / West update, weighted the same way as the mean
+	var_xx_ = (1.0 - w) * (var_xx_ + w * dx * dx);
+	var_xy_ = (1.0 - w) * (var_xy_ + w * dx * dy);
+	var_yy_ = (1.0 - w) * (var_yy_ + w * dy * dy);
+
+	if (seen_ && std::fabs(mean_x_ - shown_x_) < config_.min_change &&
+		std::fabs(mean_y_ - shown_y_) < config_.min_change)
+		return false;
+
+	seen_ = true;
+	shown_x_ = mean_x_;
+	shown_y_ = mean_y_;
+	return true;
+}
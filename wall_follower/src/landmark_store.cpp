@@ -0,0 +1,169 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/landmark_store.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+
+static const char store_magic[4] = {'W', 'F', 'L', 'M'};
+
+uint32_t crc32(const void * data, size_t size)
+{
+	const uint8_t * p = static_cast<const uint8_t *>(data);
+	uint32_t crc = 0xffffffffu;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc ^= p[i];
+		for (int k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1u)));
+	}
+	return ~crc;
+}
+
+LandmarkStore::~LandmarkStore()
+{
+	close();
+}
+
+bool LandmarkStore::open(const std::string & path, uint32_t num_records)
+{
+	size_t size = sizeof(LandmarkStoreHeader) + num_records * sizeof(LandmarkRecord);
+
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+	{
+		error_ = path + ": " + std::strerror(errno);
+		return false;
+	}
+	struct stat st;
+	bool fresh = fstat(fd, &st) != 0 || (size_t) st.st_size != size;
+	if (fresh && ftruncate(fd, size) != 0)
+	{
+		error_ = path + ": " + std::strerror(errno);
+		::close(fd);
+		return false;
+	}
+	void * map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+	{
+		error_ = path + ": " + std::strerror(errno);
+		return false;
+	}
+	map_ = static_cast<uint8_t *>(map);
+	size_ = size;
+	num_records_ = num_records;
+
+	LandmarkStoreHeader header;
+	std::memcpy(&header, map_, sizeof(header));
+	if (fresh || std::memcmp(header.magic, store_magic, 4) != 0 || header.version != LANDMARK_STORE_VERSION ||
+		header.num_records != num_records || header.record_size != sizeof(LandmarkRecord))
+	{
+		std::memset(map_, 0, size_);
+		std::memcpy(header.magic, store_magic, 4);
+		header.version = LANDMARK_STORE_VERSION;
+		header.num_records = num_records;
+		header.record_size = sizeof(LandmarkRecord);
+		std::memcpy(map_, &header, sizeof(header));
+		msync(map_, size_, MS_SYNC);
+	}
+	return true;
+}
+
+std::vector<LandmarkRecord> LandmarkStore::load() const
+{
+	std::vector<LandmarkRecord> records;
+	for (uint32_t i = 0; i < num_records_; i++)
+	{
+		LandmarkRecord record;
+		std::memcpy(&record, map_ + sizeof(LandmarkStoreHeader) + i * sizeof(LandmarkRecord), sizeof(record));
+		if (record.crc != crc32(&record, offsetof(LandmarkRecord, crc)))
+			continue;
+		if (record.count > 0 && record.type == i)
+			records.push_back(record);
+	}
+	return records;
+}
+
+void LandmarkStore::update(const LandmarkRecord & record)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	pending_[record.type] = record;
+}
+
+void LandmarkStore::write_pending()
+{
+	std::map<uint32_t, LandmarkRecord> pending;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pending.swap(pending_);
+	}
+	if (pending.empty() || !map_)
+		return;
+
+	for (auto & entry : pending)
+	{
+		LandmarkRecord & record = entry.second;
+		if (record.type >= num_records_)
+			continue;
+		record.reserved = 0;
+		record.crc = crc32(&record, offsetof(LandmarkRecord, crc));
+		std::memcpy(map_ + sizeof(LandmarkStoreHeader) + record.type * sizeof(LandmarkRecord), &record,
+			sizeof(record));
+	}
+	msync(map_, size_, MS_ASYNC);
+}
+
+void LandmarkStore::start(std::chrono::milliseconds period)
+{
+	period_ = period;
+	stopping_ = false;
+	writer_ = std::thread(&LandmarkStore::writer_loop, this);
+}
+
+void LandmarkStore::writer_loop()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (!cv_.wait_for(lock, period_, [this] {return stopping_;}))
+	{
+		lock.unlock();
+		write_pending();
+		lock.lock();
+	}
+}
+
+void LandmarkStore::close()
+{
+	if (writer_.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		cv_.notify_all();
+		writer_.join();
+	}
+	if (map_)
+	{
+		write_pending();
+		msync(map_, size_, MS_SYNC);
+		munmap(map_, size_);
+		map_ = nullptr;
+	}
+}
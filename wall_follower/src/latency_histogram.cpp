@@ -0,0 +1,109 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/latency_histogram.hpp"
+
+#include <algorithm>
+
+
+static inline int highest_bit(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return 63 - __builtin_clzll(v);
+#else
+	int k = 0;
+	while (v >>= 1)
+		k++;
+	return k;
+#endif
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+	for (size_t i = 0; i < NUM_BUCKETS; i++)
+		counts_[i].store(0, std::memory_order_relaxed);
+	max_.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t value)
+{
+	if (value < SUB_BUCKETS)
+		return (size_t) value;
+
+	int k = highest_bit(value);
+	if (k >= MAX_EXPONENT)
+	{
+		k = MAX_EXPONENT;
+		value = std::min(value, ((uint64_t) 2 << MAX_EXPONENT) - 1);
+	}
+
+	// The SUB_BUCKET_BITS bits after the leading one select the sub-bucket
+	size_t mantissa = (size_t) (value >> (k - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+	return SUB_BUCKETS + (size_t) (k - SUB_BUCKET_BITS) * SUB_BUCKETS + mantissa;
+}
+
+uint64_t LatencyHistogram::bucket_upper(size_t i)
+{
+	if (i < SUB_BUCKETS)
+		return i;
+
+	int shift = (int) ((i - SUB_BUCKETS) / SUB_BUCKETS);
+	uint64_t mantissa = (i - SUB_BUCKETS) % SUB_BUCKETS;
+	uint64_t lower = (SUB_BUCKETS + mantissa) << shift;
+	return lower + ((uint64_t) 1 << shift) - 1;
+}
+
+void LatencyHistogram::record(int64_t ns)
+{
+	uint64_t value = ns > 0 ? (uint64_t) ns : 0;
+	counts_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t prev = max_.load(std::memory_order_relaxed);
+	while (value > prev && !max_.compare_exchange_weak(prev, value, std::memory_order_relaxed))
+		;
+}
+
+LatencySummary LatencyHistogram::take()
+{
+	uint64_t counts[NUM_BUCKETS];
+	LatencySummary summary = {0, 0, 0, 0};
+
+	for (size_t i = 0; i < NUM_BUCKETS; i++)
+	{
+		counts[i] = counts_[i].exchange(0, std::memory_order_relaxed);
+		summary.count += counts[i];
+	}
+	summary.max = max_.exchange(0, std::memory_order_relaxed);
+	if (summary.count == 0)
+		return summary;
+
+	// Ranks of the percentiles, counting from 1
+	uint64_t rank50 = (summary.count + 1) / 2;
+	uint64_t rank99 = std::max<uint64_t>(1, (summary.count * 99 + 99) / 100);
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < NUM_BUCKETS; i++)
+	{
+		if (counts[i] == 0)
+			continue;
+		uint64_t prev = seen;
+		seen += counts[i];
+		if (prev < rank50 && seen >= rank50)
+			summary.p50 = std::min(bucket_upper(i), summary.max);
+		if (prev < rank99 && seen >= rank99)
+		{
+			summary.p99 = std::min(bucket_upper(i), summary.max);
+			break;
+		}
+	}
+	return summary;
+}
@@ -0,0 +1,208 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/marker_detector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+Blob MarkerDetector::make_blob(double cx, double cy, int w, int h)
+{
+	const double centre = 320;	// 640/2
+
+	Blob blob;
+	blob.cy = cy;
+	blob.h = h;
+	blob.distance = 35.772 * std::pow(h, -0.859);	// obtained experimentally
+
+	// A partly hidden marker is narrower than it is tall, move the centre
+	// away from the middle of the image to where the full marker would be
+	double aspect_ratio = (double) h / w;
+	if (aspect_ratio < 0.8)
+	{
+		if (cx < centre)
+			cx += h - w;
+		else
+			cx -= h - w;
+	}
+	blob.cx = cx;
+
+	blob.angle = (centre - cx) * FIELD_OF_VIEW_H / 480;
+	if (blob.angle < 0)
+		blob.angle += 360;
+	return blob;
+}
+
+void MarkerDetector::set_tracking(bool enable, int roi_margin, int full_search_period)
+{
+	tracking_ = enable;
+	roi_margin_ = std::max(0, roi_margin);
+	full_search_period_ = std::max(1, full_search_period);
+	track_ = cv::Rect();
+}
+
+void MarkerDetector::set_pyramid_level(int level)
+{
+	scale_ = 1 << std::min(std::max(level, 0), 3);
+}
+
+// Index of the largest component of each colour
+static void find_largest(const std::vector<Component> & components, int * largest)
+{
+	for (int c = 0; c < NUM_COLOURS; c++)
+		largest[c] = -1;
+	for (int i = 0; i < (int) components.size(); i++)
+	{
+		const Component & comp = components[i];
+		int & best = largest[comp.colour];
+		if (best < 0 || comp.area > components[best].area)
+			best = i;
+	}
+}
+
+void MarkerDetector::segment(const cv::Mat & image, const cv::Rect & roi)
+{
+	classifier_.classify(image(roi), labels_, scale_);
+	if (scale_ == 1)
+		labeller_.label(labels_, components_, roi.x, roi.y);
+	else
+		labeller_.label(labels_, components_);		// subsampled roi coordinates
+	find_largest(components_, largest_);
+}
+
+bool MarkerDetector::blob_component(const cv::Mat & image, const cv::Rect & roi, int colour, Component & comp)
+{
+	if (largest_[colour] < 0)
+		return false;
+	comp = components_[largest_[colour]];
+	if (scale_ == 1)
+		return true;
+
+	// Segment the coarse box, grown by one coarse pixel, at full resolution
+	cv::Rect box(roi.x + (comp.left - 1) * scale_, roi.y + (comp.top - 1) * scale_,
+		(comp.width() + 2) * scale_, (comp.height() + 2) * scale_);
+	box &= cv::Rect(0, 0, image.cols, image.rows);
+	classifier_.classify(image(box), refine_labels_);
+	labeller_.label(refine_labels_, refine_components_, box.x, box.y);
+
+	int best = -1;
+	for (int i = 0; i < (int) refine_components_.size(); i++)
+	{
+		const Component & c = refine_components_[i];
+		if (c.colour == colour && (best < 0 || c.area > refine_components_[best].area))
+			best = i;
+	}
+	if (best >= 0)
+	{
+		comp = refine_components_[best];
+		return true;
+	}
+
+	// Only seen at the coarse level, scale it up
+	double cx = roi.x + comp.cx() * scale_;
+	double cy = roi.y + comp.cy() * scale_;
+	comp.left = roi.x + comp.left * scale_;
+	comp.top = roi.y + comp.top * scale_;
+	comp.right = roi.x + comp.right * scale_ + scale_ - 1;
+	comp.bottom = roi.y + comp.bottom * scale_ + scale_ - 1;
+	comp.area *= scale_ * scale_;
+	comp.sum_x = cx * comp.area;
+	comp.sum_y = cy * comp.area;
+	return true;
+}
+
+static cv::Rect component_box(const Component & comp)
+{
+	return cv::Rect(comp.left, comp.top, comp.width(), comp.height());
+}
+
+// True if box touches a side of roi that is inside the frame, i.e. the blob
+// may carry on outside the roi
+static bool clipped(const cv::Rect & box, const cv::Rect & roi, const cv::Size & frame)
+{
+	return (box.x <= roi.x && roi.x > 0) ||
+		(box.y <= roi.y && roi.y > 0) ||
+		(box.x + box.width >= roi.x + roi.width && roi.x + roi.width < frame.width) ||
+		(box.y + box.height >= roi.y + roi.height && roi.y + roi.height < frame.height);
+}
+
+bool MarkerDetector::search(const cv::Mat & image, const cv::Rect & roi,
+	std::vector<MarkerDetection> & detections, cv::Rect & bounds)
+{
+	detections.clear();
+	segment(image, roi);
+	last_roi_ = roi;
+
+	Component pink_comp;
+	if (!blob_component(image, roi, PINK, pink_comp))
+		return false;
+	Blob pink = make_blob(pink_comp.cx(), pink_comp.cy(), pink_comp.width(), pink_comp.height());
+	cv::Rect pink_box = component_box(pink_comp);
+	bool reliable = !clipped(pink_box, roi, image.size());
+	bounds = cv::Rect();
+
+	for (int c = BLUE; c < NUM_COLOURS; c++)
+	{
+		Component comp;
+		if (!blob_component(image, roi, c, comp))
+			continue;
+		Blob blob = make_blob(comp.cx(), comp.cy(), comp.width(), comp.height());
+
+		// Check to see if the blobs are vertically aligned
+		if (std::fabs(pink.cx - blob.cx) > pink.h)
+			continue;
+
+		MarkerDetection detection;
+		if (blob.cy < pink.cy)		// +y is down
+			detection.type = marker_index(c, PINK);
+		else
+			detection.type = marker_index(PINK, c);
+
+		double angle = blob.angle * M_PI / 180.0;
+		detection.x = blob.distance * std::cos(angle);
+		detection.y = blob.distance * std::sin(angle);
+		detections.push_back(detection);
+
+		cv::Rect box = component_box(comp);
+		reliable = reliable && !clipped(box, roi, image.size());
+		bounds |= box;
+	}
+	if (detections.empty())
+		return false;
+	bounds |= pink_box;
+	return reliable;
+}
+
+void MarkerDetector::detect(const cv::Mat & image, std::vector<MarkerDetection> & detections)
+{
+	const cv::Rect frame(0, 0, image.cols, image.rows);
+	cv::Rect bounds;
+
+	if (tracking_ && !track_.empty() && frames_since_full_ < full_search_period_)
+	{
+		cv::Rect roi(track_.x - roi_margin_, track_.y - roi_margin_,
+			track_.width + 2 * roi_margin_, track_.height + 2 * roi_margin_);
+		roi &= frame;
+		frames_since_full_++;
+		if (!roi.empty() && search(image, roi, detections, bounds))
+		{
+			track_ = bounds;
+			return;
+		}
+		// Lost the marker, or it is leaving the roi
+	}
+
+	search(image, frame, detections, bounds);
+	frames_since_full_ = 0;
+	track_ = tracking_ && !detections.empty() ? bounds : cv::Rect();
+}
@@ -0,0 +1,315 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/marker_mapper.hpp"
+
+#include <cv_bridge/cv_bridge.h>
+#include <tf2_geometry_msgs/tf2_geometry_msgs.h>
+
+#include <chrono>
+#include <utility>
+
+#include <rclcpp_components/register_node_macro.hpp>
+
+#include "wall_follower/logging.hpp"
+
+using namespace std::chrono_literals;
+
+
+// Top and bottom RGB of each marker type, as marker_colour in landmark.py
+static const double marker_colour[MAX_MARKERS][2][3] = {
+	{{1.0, 1.0, 0.0}, {1.0, 0.56, 0.75}},
+	{{0.0, 1.0, 0.0}, {1.0, 0.56, 0.75}},
+	{{0.0, 0.0, 1.0}, {1.0, 0.56, 0.75}},
+	{{1.0, 0.56, 0.75}, {1.0, 1.0, 0.0}},
+	{{1.0, 0.56, 0.75}, {0.0, 1.0, 0.0}},
+	{{1.0, 0.56, 0.75}, {0.0, 0.0, 1.0}}
+};
+
+static LandmarkRecord make_record(int type, const LandmarkEstimator & landmark,
+	const builtin_interfaces::msg::Time & stamp)
+{
+	LandmarkRecord record;
+	record.type = (uint32_t) type;
+	record.count = landmark.count();
+	record.x = landmark.x();
+	record.y = landmark.y();
+	record.cov_xx = landmark.cov_xx();
+	record.cov_xy = landmark.cov_xy();
+	record.cov_yy = landmark.cov_yy();
+	record.stamp = stamp.sec + stamp.nanosec * 1e-9;
+	record.reserved = 0;
+	record.crc = 0;
+	return record;
+}
+
+MarkerMapper::MarkerMapper(const rclcpp::NodeOptions & options)
+: Node("marker_mapper", options)
+{
+	/************************************************************
+	** Initialise parameters
+	************************************************************/
+	std::string image_topic = this->declare_parameter<std::string>("image_topic", "camera/image_raw");
+	map_frame_ = this->declare_parameter<std::string>("map_frame", "map");
+	camera_frame_ = this->declare_parameter<std::string>("camera_frame", "camera_link");
+	compatibility_topics_ = this->declare_parameter<bool>("compatibility_topics", false);
+	double publish_period = this->declare_parameter<double>("publish_period", 0.5);
+
+	tracking_ = this->declare_parameter<bool>("tracking", true);
+	roi_margin_ = this->declare_parameter<int>("roi_margin", ROI_MARGIN);
+	full_search_period_ = this->declare_parameter<int>("full_search_period", FULL_SEARCH_PERIOD);
+	pyramid_level_ = this->declare_parameter<int>("pyramid_level", 1);
+
+	LandmarkConfig config;
+	config.alpha = this->declare_parameter<double>("landmark.alpha", config.alpha);
+	config.gate = this->declare_parameter<double>("landmark.gate", config.gate);
+	config.min_sigma = this->declare_parameter<double>("landmark.min_sigma", config.min_sigma);
+	config.min_change = this->declare_parameter<double>("landmark.min_change", config.min_change);
+	landmarks_.assign(MAX_MARKERS, LandmarkEstimator(config));
+	changed_.assign(MAX_MARKERS, false);
+
+	std::string snapshot_file = this->declare_parameter<std::string>("snapshot_file", "");
+	double snapshot_period = this->declare_parameter<double>("snapshot_period", 1.0);
+
+	/************************************************************
+	** Initialise ROS publishers and subscribers
+	************************************************************/
+	// Transient local, so that a subscriber that joins late (or after a
+	// restart restored the map) still gets the latest complete map. rclcpp
+	// refuses transient local with intra-process comms, which a container
+	// may have turned on for the node, so these always go through the RMW.
+	rclcpp::PublisherOptions latched;
+	latched.use_intra_process_comm = rclcpp::IntraProcessSetting::Disable;
+	landmarks_pub_ = this->create_publisher<wall_follower::msg::LandmarkArray>("landmarks",
+		rclcpp::QoS(rclcpp::KeepLast(1)).transient_local(), latched);
+	if (compatibility_topics_)
+	{
+		point_pub_ = this->create_publisher<geometry_msgs::msg::PointStamped>("marker_position", 10);
+		marker_pub_ = this->create_publisher<visualization_msgs::msg::MarkerArray>("visualization_marker_array",
+			rclcpp::QoS(rclcpp::KeepLast(10)).transient_local(), latched);
+	}
+
+	// Stale frames are of no use, only keep the newest
+	image_sub_ = this->create_subscription<sensor_msgs::msg::Image>(
+		image_topic, rclcpp::QoS(rclcpp::KeepLast(1)).best_effort(),
+		std::bind(&MarkerMapper::image_callback, this, std::placeholders::_1));
+
+	/************************************************************
+	** Initialise ROS timers
+	************************************************************/
+	publish_timer_ = this->create_wall_timer(
+		std::chrono::duration<double>(publish_period), std::bind(&MarkerMapper::publish_callback, this));
+
+	// Warm start, the saved map goes out straight away
+	snapshot_ = false;
+	if (!snapshot_file.empty())
+		load_snapshot(snapshot_file, snapshot_period);
+
+	worker_ = std::thread(&MarkerMapper::worker_loop, this);
+
+	RCLCPP_INFO(this->get_logger(), "Marker mapper node has been initialised");
+}
+
+MarkerMapper::~MarkerMapper()
+{
+	frames_.close();
+	worker_.join();
+	store_.close();
+}
+
+void MarkerMapper::load_snapshot(const std::string & path, double period)
+{
+	if (!store_.open(path, MAX_MARKERS))
+	{
+		RCLCPP_ERROR(this->get_logger(), "Cannot open landmark snapshot %s", store_.error().c_str());
+		return;
+	}
+	snapshot_ = true;
+
+	std::vector<LandmarkRecord> records = store_.load();
+	for (const LandmarkRecord & r : records)
+	{
+		landmarks_[r.type].restore(r.count, r.x, r.y, r.cov_xx, r.cov_xy, r.cov_yy);
+		changed_[r.type] = true;
+	}
+	store_.start(std::chrono::milliseconds((int64_t) (period * 1000)));
+
+	// The restored landmarks are left marked changed, so the first publish
+	// tick sends them once the node is up
+	if (!records.empty())
+		RCLCPP_INFO(this->get_logger(), "Loaded %zu landmarks from %s", records.size(), path.c_str());
+}
+
+void MarkerMapper::image_callback(const sensor_msgs::msg::Image::ConstSharedPtr msg)
+{
+	// Nothing needs transforms until there is a frame. The listener's
+	// subscriptions are served by the node's own executor; taking the frame
+	// from frames_ orders the worker's use of the buffer after this.
+	if (!tf_buffer_)
+	{
+		tf_buffer_ = std::make_shared<tf2_ros::Buffer>(this->get_clock());
+		tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_, this, false);
+		RCLCPP_INFO(this->get_logger(), "First camera frame, listening for transforms");
+	}
+	frames_.put(msg);
+}
+
+void MarkerMapper::worker_loop()
+{
+	sensor_msgs::msg::Image::ConstSharedPtr msg;
+	while (frames_.take(msg))
+		process_frame(msg);
+}
+
+void MarkerMapper::process_frame(const sensor_msgs::msg::Image::ConstSharedPtr & msg)
+{
+	cv_bridge::CvImageConstPtr frame;
+	try
+	{
+		// No copy when the camera already publishes bgr8
+		frame = cv_bridge::toCvShare(msg, "bgr8");
+	}
+	catch (const cv_bridge::Exception & e)
+	{
+		RCLCPP_ERROR(this->get_logger(), "cv_bridge exception: %s", e.what());
+		return;
+	}
+
+	if (!detector_)
+	{
+		detector_ = std::make_unique<MarkerDetector>();
+		detector_->set_tracking(tracking_, roi_margin_, full_search_period_);
+		detector_->set_pyramid_level(pyramid_level_);
+	}
+	detector_->detect(frame->image, detections_);
+	if (detections_.empty())
+		return;
+
+	// One lookup per frame, at the time of the frame if the buffer has it
+	geometry_msgs::msg::TransformStamped transform;
+	try
+	{
+		try
+		{
+			transform = tf_buffer_->lookupTransform(map_frame_, camera_frame_, tf2_ros::fromMsg(msg->header.stamp));
+		}
+		catch (const tf2::ExtrapolationException &)
+		{
+			transform = tf_buffer_->lookupTransform(map_frame_, camera_frame_, tf2::TimePointZero);
+		}
+	}
+	catch (const tf2::TransformException & e)
+	{
+		RCLCPP_ERROR_THROTTLE(this->get_logger(), *this->get_clock(), WF_STATE_PERIOD_MS,
+			"Transform lookup failed: %s", e.what());
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(landmarks_mutex_);
+	for (const MarkerDetection & detection : detections_)
+	{
+		if (detection.type < 0)
+			continue;
+
+		geometry_msgs::msg::PointStamped camera_point, map_point;
+		camera_point.header.stamp = msg->header.stamp;
+		camera_point.header.frame_id = camera_frame_;
+		camera_point.point.x = detection.x;
+		camera_point.point.y = detection.y;
+		tf2::doTransform(camera_point, map_point, transform);
+
+		LandmarkEstimator & landmark = landmarks_[detection.type];
+		if (landmark.update(map_point.point.x, map_point.point.y))
+		{
+			changed_[detection.type] = true;
+			if (snapshot_)
+				store_.update(make_record(detection.type, landmark, msg->header.stamp));
+		}
+
+		if (compatibility_topics_)
+		{
+			auto marker_at = std::make_unique<geometry_msgs::msg::PointStamped>(camera_point);
+			marker_at->header.stamp = this->now();
+			marker_at->point.z = (double) detection.type;
+			point_pub_->publish(std::move(marker_at));
+		}
+	}
+}
+
+void MarkerMapper::add_markers(int type, const LandmarkEstimator & landmark,
+	visualization_msgs::msg::MarkerArray & markers)
+{
+	// Same markers as make_half_marker() in landmark.py
+	for (int bottom = 0; bottom < 2; bottom++)
+	{
+		visualization_msgs::msg::Marker marker;
+		marker.header.frame_id = "/" + map_frame_;
+		marker.ns = marker_type[type];
+		marker.id = 2 * type + bottom;
+		marker.type = visualization_msgs::msg::Marker::CYLINDER;
+		marker.action = visualization_msgs::msg::Marker::ADD;
+		marker.scale.x = 0.2;
+		marker.scale.y = 0.2;
+		marker.scale.z = 0.2;
+		marker.color.a = 1.0;
+		marker.color.r = marker_colour[type][bottom][0];
+		marker.color.g = marker_colour[type][bottom][1];
+		marker.color.b = marker_colour[type][bottom][2];
+		marker.pose.orientation.w = 0.0;
+		marker.pose.position.x = landmark.x();
+		marker.pose.position.y = landmark.y();
+		marker.pose.position.z = bottom ? 0.15 : 0.35;
+		markers.markers.push_back(marker);
+	}
+}
+
+void MarkerMapper::publish_callback()
+{
+	auto landmarks = std::make_unique<wall_follower::msg::LandmarkArray>();
+	visualization_msgs::msg::MarkerArray markers;
+	{
+		std::lock_guard<std::mutex> lock(landmarks_mutex_);
+		bool any_changed = false;
+		for (int i = 0; i < MAX_MARKERS; i++)
+			any_changed = any_changed || changed_[i];
+		if (!any_changed)
+			return;
+
+		for (int i = 0; i < MAX_MARKERS; i++)
+		{
+			const LandmarkEstimator & landmark = landmarks_[i];
+			if (!landmark.seen())
+				continue;
+
+			wall_follower::msg::Landmark l;
+			l.type = (uint8_t) i;
+			l.name = marker_type[i];
+			l.position.x = landmark.x();
+			l.position.y = landmark.y();
+			l.covariance = {landmark.cov_xx(), landmark.cov_xy(), landmark.cov_xy(), landmark.cov_yy()};
+			l.count = landmark.count();
+			landmarks->landmarks.push_back(l);
+
+			if (compatibility_topics_ && changed_[i])
+				add_markers(i, landmark, markers);
+			changed_[i] = false;
+		}
+	}
+
+	landmarks->header.stamp = this->now();
+	landmarks->header.frame_id = map_frame_;
+	landmarks_pub_->publish(std::move(landmarks));
+	if (compatibility_topics_)
+		marker_pub_->publish(markers);
+}
+
+RCLCPP_COMPONENTS_REGISTER_NODE(MarkerMapper)
@@ -0,0 +1,48 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/marker_types.hpp"
+
+#include <string>
+
+
+const char * const colour_names[NUM_COLOURS] = {"pink", "blue", "green", "yellow"};
+
+// Same table as colours in landmark.py
+const HsvRange colour_ranges[NUM_COLOURS] = {
+	{{140, 0, 0}, {170, 255, 255}},		// pink
+	{{100, 0, 0}, {130, 255, 255}},		// blue
+	{{40, 0, 0}, {80, 255, 255}},		// green
+	{{25, 0, 0}, {32, 255, 255}}		// yellow
+};
+
+// Same order as marker_type in landmark.py, written top/bottom
+const char * const marker_type[MAX_MARKERS] = {
+	"yellow/pink",
+	"green/pink",
+	"blue/pink",
+	"pink/yellow",
+	"pink/green",
+	"pink/blue"
+};
+
+int marker_index(int top, int bottom)
+{
+	if (top < 0 || top >= NUM_COLOURS || bottom < 0 || bottom >= NUM_COLOURS)
+		return -1;
+
+	std::string name = std::string(colour_names[top]) + "/" + colour_names[bottom];
+	for (int i = 0; i < MAX_MARKERS; i++)
+		if (name == marker_type[i])
+			return i;
+	return -1;
+}
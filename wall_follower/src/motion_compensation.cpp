@@ -0,0 +1,70 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/motion_compensation.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+void predict_sectors(const double * sectors, double linear, double angular, double dt, double range_max,
+	double horizon, double * out)
+{
+	dt = std::max(0.0, std::min(dt, horizon));
+
+	// Pose at the command time in the frame of the scan, integrated
+	// exactly along the arc
+	double dtheta = angular * dt;
+	double dx, dy;
+	if (std::fabs(dtheta) > 1e-6)
+	{
+		dx = linear / angular * std::sin(dtheta);
+		dy = linear / angular * (1.0 - std::cos(dtheta));
+	}
+	else
+	{
+		dx = linear * dt;
+		dy = 0.0;
+	}
+	const double c = std::cos(dtheta), s = std::sin(dtheta);
+	const double spacing = SECTOR_SPACING * DEG2RAD;
+
+	for (int i = 0; i < NUM_SECTORS; i++)
+	{
+		// Turning by dtheta brings what was at bearing theta + dtheta in the
+		// scan to bearing theta now. Interpolate between the two sectors
+		// either side of that bearing.
+		double bearing = i * spacing + dtheta;
+		double f = bearing / spacing;
+		double lower = std::floor(f);
+		double w = f - lower;
+		int a = ((int) lower % NUM_SECTORS + NUM_SECTORS) % NUM_SECTORS;
+		int b = (a + 1) % NUM_SECTORS;
+		double r;
+		if (sectors[a] >= range_max || sectors[b] >= range_max)
+			r = w < 0.5 ? sectors[a] : sectors[b];
+		else
+			r = (1.0 - w) * sectors[a] + w * sectors[b];
+		if (r >= range_max)
+		{
+			out[i] = range_max;
+			continue;
+		}
+
+		// Move the point into the robot frame at the command time
+		double px = r * std::cos(bearing) - dx;
+		double py = r * std::sin(bearing) - dy;
+		double qx = c * px + s * py;
+		double qy = -s * px + c * py;
+		out[i] = std::min(range_max, std::hypot(qx, qy));
+	}
+}
@@ -0,0 +1,59 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/rate_scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+static inline double clamp01(double x)
+{
+	return std::max(0.0, std::min(1.0, x));
+}
+
+void RateScheduler::configure(const RateConfig & config)
+{
+	config_ = config;
+	config_.fast_period = std::max(1e-3, config.fast_period);
+	config_.slow_period = std::max(config_.fast_period, config.slow_period);
+	config_.idle_period = std::max(config_.slow_period, config.idle_period);
+	config_.far_distance = std::max(config.near_distance + 1e-3, config.far_distance);
+	period_ = std::min(std::max(CONTROL_PERIOD, config_.fast_period), config_.slow_period);
+}
+
+bool RateScheduler::update(double front, double speed, bool stopped)
+{
+	double target;
+	if (stopped)
+		target = config_.idle_period;
+	else
+	{
+		// The more urgent of the two decides
+		double proximity = clamp01((config_.far_distance - front) /
+			(config_.far_distance - config_.near_distance));
+		double velocity = config_.fast_speed > 0.0 ? clamp01(std::fabs(speed) / config_.fast_speed) : 1.0;
+		double urgency = std::max(proximity, velocity);
+		// Exactly fast_period when most urgent, which the interpolation
+		// can miss by rounding
+		target = urgency >= 1.0 ? config_.fast_period :
+			config_.slow_period - urgency * (config_.slow_period - config_.fast_period);
+	}
+
+	// Always speed up straight away to the fast period, since that is when
+	// reaction time matters
+	bool faster = target < period_ && target == config_.fast_period;
+	if (!faster && std::fabs(target - period_) <= config_.hysteresis * period_)
+		return false;
+	period_ = target;
+	return true;
+}
@@ -0,0 +1,102 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/rule_table.hpp"
+
+#include <cstdio>
+
+#include "wall_follower/sectors.hpp"
+
+
+static const char * const sector_names[NUM_SECTORS] = {
+	"FRONT", "FRONT_LEFT", "LEFT_FRONT", "LEFT", "LEFT_BACK", "BACK_LEFT",
+	"BACK", "BACK_RIGHT", "RIGHT_BACK", "RIGHT", "RIGHT_FRONT", "FRONT_RIGHT"
+};
+
+const char * sector_name(int sector)
+{
+	if (sector < 0 || sector >= NUM_SECTORS)
+		return "UNKNOWN";
+	return sector_names[sector];
+}
+
+int sector_index(const std::string & name)
+{
+	for (int i = 0; i < NUM_SECTORS; i++)
+		if (name == sector_names[i])
+			return i;
+	return -1;
+}
+
+
+/********************************************************************************
+** RuleTable
+********************************************************************************/
+
+RuleTable::RuleTable()
+{
+	set_rules(default_rules(), default_fallback());
+}
+
+static std::string describe(const Rule & rule, bool fallback)
+{
+	char buf[160];
+	if (fallback)
+		snprintf(buf, sizeof(buf), "Rule '%s': linear %.2f, angular %.2f",
+			rule.name.c_str(), rule.linear, rule.angular);
+	else
+		snprintf(buf, sizeof(buf), "Rule '%s' (%s %c %.2f): linear %.2f, angular %.2f",
+			rule.name.c_str(), sector_name(rule.sector),
+			rule.condition == RuleCondition::LESS ? '<' : '>', rule.threshold,
+			rule.linear, rule.angular);
+	return buf;
+}
+
+void RuleTable::set_rules(const std::vector<Rule> & rules, const Rule & fallback)
+{
+	rules_ = rules;
+	fallback_ = fallback;
+
+	descriptions_.clear();
+	for (const Rule & rule : rules_)
+		descriptions_.push_back(describe(rule, false));
+	descriptions_.push_back(describe(fallback_, true));
+}
+
+size_t RuleTable::evaluate(const double * sectors) const
+{
+	for (size_t i = 0; i < rules_.size(); i++)
+	{
+		const Rule & rule = rules_[i];
+		double d = sectors[rule.sector];
+		bool holds = rule.condition == RuleCondition::LESS ? d < rule.threshold : d > rule.threshold;
+		if (holds)
+			return i;
+	}
+	return rules_.size();
+}
+
+std::vector<Rule> RuleTable::default_rules()
+{
+	return {
+		{"left_front_open",   LEFT_FRONT,  RuleCondition::GREATER, 0.9, 0.2,              ANGULAR_VELOCITY},
+		{"front_blocked",     FRONT,       RuleCondition::LESS,    0.7, 0.0,              -ANGULAR_VELOCITY},
+		{"front_left_close",  FRONT_LEFT,  RuleCondition::LESS,    0.6, LINEAR_VELOCITY,  -ANGULAR_VELOCITY},
+		{"front_right_close", FRONT_RIGHT, RuleCondition::LESS,    0.6, LINEAR_VELOCITY,  ANGULAR_VELOCITY},
+		{"left_front_clear",  LEFT_FRONT,  RuleCondition::GREATER, 0.6, LINEAR_VELOCITY,  ANGULAR_VELOCITY}
+	};
+}
+
+Rule RuleTable::default_fallback()
+{
+	return {"path_clear", FRONT, RuleCondition::LESS, 0.0, LINEAR_VELOCITY, 0.0};
+}
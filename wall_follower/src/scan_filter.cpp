@@ -0,0 +1,119 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/scan_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+// Branch-free median of three, vectorises to min/max
+static inline float median3(float a, float b, float c)
+{
+	return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+void ScanFilter::configure(const ScanFilterConfig & config)
+{
+	config_ = config;
+	int depth = std::max(1, std::min(config.depth, SCAN_FILTER_MAX_DEPTH));
+	config_.depth = depth - (depth % 2 == 0);
+	config_.spike_threshold = std::max(0.0, config.spike_threshold);
+
+	// Resized on the next scan
+	num_ranges_ = 0;
+	primed_ = false;
+}
+
+const float * ScanFilter::apply(const ScanGeometry & geometry, const float * ranges, float range_min,
+	float range_max)
+{
+	if (!enabled())
+		return ranges;
+
+	const size_t n = geometry.num_ranges;
+	const size_t depth = (size_t) config_.depth;
+	if (n != num_ranges_)
+	{
+		num_ranges_ = n;
+		history_.assign(depth * n, 0.0f);
+		sort_.assign(depth * n, 0.0f);
+		out_.assign(n, 0.0f);
+		head_ = 0;
+		primed_ = false;
+	}
+	if (n == 0)
+		return ranges;
+
+	// Mask invalid readings to +inf, which orders above every range in the
+	// min/max networks below, unlike NaN
+	const float inf = std::numeric_limits<float>::infinity();
+	float * row = history_.data() + head_ * n;
+	for (size_t i = 0; i < n; i++)
+	{
+		float x = ranges[i];
+		row[i] = (x >= range_min && x <= range_max) ? x : inf;
+	}
+
+	// Spike rejection. The end beams have one neighbour and are kept.
+	if (config_.spike_threshold > 0.0 && n >= 3)
+	{
+		const float threshold = (float) config_.spike_threshold;
+		float * out = out_.data();
+		out[0] = row[0];
+		out[n - 1] = row[n - 1];
+		for (size_t i = 1; i + 1 < n; i++)
+		{
+			float m = median3(row[i - 1], row[i], row[i + 1]);
+			// inf - inf is NaN, which fails the compare and keeps the beam
+			out[i] = std::fabs(row[i] - m) > threshold ? m : row[i];
+		}
+		std::memcpy(row, out, n * sizeof(float));
+	}
+
+	if (depth == 1)
+		return row;
+
+	// Until the ring has filled, every row holds the first scan
+	if (!primed_)
+	{
+		for (size_t k = 0; k < depth; k++)
+			if (k != head_)
+				std::memcpy(history_.data() + k * n, row, n * sizeof(float));
+		primed_ = true;
+	}
+	head_ = (head_ + 1) % depth;
+
+	// Odd-even transposition sort of the depth rows, beam-wise. Each pass is
+	// a compare-exchange between whole rows; after depth passes the middle
+	// row is the per-beam median.
+	std::memcpy(sort_.data(), history_.data(), depth * n * sizeof(float));
+	for (size_t pass = 0; pass < depth; pass++)
+	{
+		for (size_t k = pass % 2; k + 1 < depth; k += 2)
+		{
+			float * a = sort_.data() + k * n;
+			float * b = a + n;
+			for (size_t i = 0; i < n; i++)
+			{
+				float lo = std::min(a[i], b[i]);
+				float hi = std::max(a[i], b[i]);
+				a[i] = lo;
+				b[i] = hi;
+			}
+		}
+	}
+	std::memcpy(out_.data(), sort_.data() + (depth / 2) * n, n * sizeof(float));
+	return out_.data();
+}
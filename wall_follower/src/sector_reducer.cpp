@@ -0,0 +1,281 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/sector_reducer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+/********************************************************************************
+** Kernels
+********************************************************************************/
+
+// Scalar version of the masked minimum, used for the tail of each span.
+// Written as selects so the compiler emits min/blend rather than branches.
+static inline float masked_min_scalar(const float * r, size_t n, float lo, float hi, float m)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		float x = r[i];
+		x = (x >= lo && x <= hi) ? x : hi;	// NaN fails both compares
+		m = std::min(m, x);
+	}
+	return m;
+}
+
+float sector_min(const float * ranges, BeamSpan span, float range_min, float range_max)
+{
+	const float * r = ranges + span.begin;
+	size_t n = span.end - span.begin;
+	size_t i = 0;
+	float m = range_max;
+
+#if defined(__AVX__)
+	const __m256 lo = _mm256_set1_ps(range_min);
+	const __m256 hi = _mm256_set1_ps(range_max);
+	__m256 acc = hi;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 v = _mm256_loadu_ps(r + i);
+		__m256 ok = _mm256_and_ps(_mm256_cmp_ps(v, lo, _CMP_GE_OQ), _mm256_cmp_ps(v, hi, _CMP_LE_OQ));
+		acc = _mm256_min_ps(acc, _mm256_blendv_ps(hi, v, ok));
+	}
+	__m128 acc4 = _mm_min_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+	acc4 = _mm_min_ps(acc4, _mm_movehl_ps(acc4, acc4));
+	acc4 = _mm_min_ss(acc4, _mm_shuffle_ps(acc4, acc4, 1));
+	m = _mm_cvtss_f32(acc4);
+#elif defined(__SSE2__) || defined(_M_X64)
+	const __m128 lo = _mm_set1_ps(range_min);
+	const __m128 hi = _mm_set1_ps(range_max);
+	__m128 acc = hi;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128 v = _mm_loadu_ps(r + i);
+		__m128 ok = _mm_and_ps(_mm_cmpge_ps(v, lo), _mm_cmple_ps(v, hi));
+		acc = _mm_min_ps(acc, _mm_or_ps(_mm_and_ps(ok, v), _mm_andnot_ps(ok, hi)));
+	}
+	acc = _mm_min_ps(acc, _mm_movehl_ps(acc, acc));
+	acc = _mm_min_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+	m = _mm_cvtss_f32(acc);
+#elif defined(__ARM_NEON)
+	const float32x4_t lo = vdupq_n_f32(range_min);
+	const float32x4_t hi = vdupq_n_f32(range_max);
+	float32x4_t acc = hi;
+	for (; i + 4 <= n; i += 4)
+	{
+		float32x4_t v = vld1q_f32(r + i);
+		uint32x4_t ok = vandq_u32(vcgeq_f32(v, lo), vcleq_f32(v, hi));
+		acc = vminq_f32(acc, vbslq_f32(ok, v, hi));
+	}
+#if defined(__aarch64__)
+	m = vminvq_f32(acc);
+#else
+	float32x2_t acc2 = vmin_f32(vget_low_f32(acc), vget_high_f32(acc));
+	acc2 = vpmin_f32(acc2, acc2);
+	m = vget_lane_f32(acc2, 0);
+#endif
+#endif
+
+	return masked_min_scalar(r + i, n - i, range_min, range_max, m);
+}
+
+size_t sector_compact(const float * ranges, BeamSpan span, float range_min, float range_max, float * out)
+{
+	size_t k = 0;
+	for (uint32_t i = span.begin; i < span.end; i++)
+	{
+		float x = ranges[i];
+		out[k] = x;
+		k += (x >= range_min && x <= range_max);
+	}
+	return k;
+}
+
+
+/********************************************************************************
+** SectorReducer
+********************************************************************************/
+
+void SectorReducer::set_sectors(const double * centres, size_t num_sectors, double half_width)
+{
+	centres_.assign(centres, centres + num_sectors);
+	half_width_ = half_width;
+
+	// Force a rebuild on the next scan
+	stale_ = true;
+}
+
+bool SectorReducer::update(const ScanGeometry & geometry)
+{
+	if (!stale_ && geometry == geometry_)
+		return valid_;
+
+	geometry_ = geometry;
+	valid_ = build(geometry);
+	stale_ = false;
+	rebuilds_++;
+	return valid_;
+}
+
+bool SectorReducer::build(const ScanGeometry & geometry)
+{
+	const size_t num_ranges = geometry.num_ranges;
+	const double angle_min = geometry.angle_min;
+	const double angle_increment = geometry.angle_increment;
+	const size_t num_sectors = centres_.size();
+	const double half_width = half_width_;
+
+	sectors_.clear();
+	if (num_ranges == 0 || !(angle_increment > 0.0) || !std::isfinite(angle_min) || num_sectors == 0)
+		return false;
+
+	// Number of beams in a full revolution. Indices past the end of the scan
+	// wrap around to the start, which matters for the FRONT sector.
+	const double two_pi = 2.0 * M_PI;
+	const size_t beams_per_rev = std::max(num_ranges, (size_t) std::lround(two_pi / angle_increment));
+	const size_t width = std::min(beams_per_rev,
+		std::max((size_t) 1, (size_t) std::lround(2.0 * half_width / angle_increment)));
+
+	size_t largest = 0;
+	sectors_.resize(num_sectors);
+	for (size_t s = 0; s < num_sectors; s++)
+	{
+		double offset = std::fmod(centres_[s] - half_width - angle_min, two_pi);
+		if (offset < 0.0)
+			offset += two_pi;
+		size_t first = (size_t) std::ceil(offset / angle_increment - 1e-6) % beams_per_rev;
+
+		Sector & sector = sectors_[s];
+		sector.num_spans = 0;
+
+		// Split [first, first + width) at the wrap point and clip to the
+		// beams actually present in the scan
+		size_t begin[2] = {first, 0};
+		size_t end[2] = {std::min(first + width, beams_per_rev), 0};
+		if (first + width > beams_per_rev)
+			end[1] = first + width - beams_per_rev;
+
+		size_t total = 0;
+		for (int k = 0; k < 2; k++)
+		{
+			size_t b = std::min(begin[k], num_ranges);
+			size_t e = std::min(end[k], num_ranges);
+			if (e > b)
+			{
+				sector.span[sector.num_spans].begin = (uint32_t) b;
+				sector.span[sector.num_spans].end = (uint32_t) e;
+				sector.num_spans++;
+				total += e - b;
+			}
+		}
+		largest = std::max(largest, total);
+	}
+
+	scratch_.resize(largest);
+	return true;
+}
+
+void SectorReducer::reduce_min(const float * ranges, float range_min, float range_max, double * out) const
+{
+	for (size_t s = 0; s < sectors_.size(); s++)
+	{
+		const Sector & sector = sectors_[s];
+		float m = range_max;
+		for (uint32_t k = 0; k < sector.num_spans; k++)
+			m = std::min(m, sector_min(ranges, sector.span[k], range_min, range_max));
+		out[s] = m;
+	}
+}
+
+void SectorReducer::reduce_percentile(const float * ranges, float range_min, float range_max, double q,
+	double * out)
+{
+	if (q <= 0.0)
+	{
+		reduce_min(ranges, range_min, range_max, out);
+		return;
+	}
+	q = std::min(q, 1.0);
+
+	for (size_t s = 0; s < sectors_.size(); s++)
+	{
+		const Sector & sector = sectors_[s];
+		size_t n = 0;
+		for (uint32_t k = 0; k < sector.num_spans; k++)
+			n += sector_compact(ranges, sector.span[k], range_min, range_max, scratch_.data() + n);
+
+		if (n == 0)
+		{
+			out[s] = range_max;
+			continue;
+		}
+		auto nth = scratch_.begin() + (size_t) std::lround(q * (n - 1));
+		std::nth_element(scratch_.begin(), nth, scratch_.begin() + n);
+		out[s] = *nth;
+	}
+}
+
+
+/********************************************************************************
+** BeamFan
+********************************************************************************/
+
+void BeamFan::set_window(double first, double last)
+{
+	first_ = first;
+	last_ = last;
+	stale_ = true;
+}
+
+bool BeamFan::update(const ScanGeometry & geometry)
+{
+	if (!stale_ && geometry == geometry_)
+		return valid_;
+
+	geometry_ = geometry;
+	valid_ = build(geometry);
+	stale_ = false;
+	return valid_;
+}
+
+bool BeamFan::build(const ScanGeometry & geometry)
+{
+	index_.clear();
+	const double inc = geometry.angle_increment;
+	if (geometry.num_ranges == 0 || !(inc > 0.0) || !std::isfinite(geometry.angle_min) || !(last_ > first_))
+		return false;
+
+	const double two_pi = 2.0 * M_PI;
+	const long beams_per_rev = std::max((long) geometry.num_ranges, std::lround(two_pi / inc));
+	const size_t steps = (size_t) std::lround((last_ - first_) / inc) + 1;
+
+	step_ = inc;
+	index_.resize(steps);
+	for (size_t i = 0; i < steps; i++)
+	{
+		double offset = std::fmod(first_ + i * inc - geometry.angle_min, two_pi);
+		if (offset < 0.0)
+			offset += two_pi;
+		long beam = std::lround(offset / inc) % beams_per_rev;
+		index_[i] = beam < (long) geometry.num_ranges ? (int32_t) beam : -1;
+	}
+	return true;
+}
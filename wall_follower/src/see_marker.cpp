@@ -0,0 +1,131 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/see_marker.hpp"
+
+#include <cv_bridge/cv_bridge.h>
+#include <opencv2/highgui.hpp>
+
+#include <memory>
+#include <string>
+
+#include <rclcpp_components/register_node_macro.hpp>
+
+#include "wall_follower/logging.hpp"
+
+
+SeeMarker::SeeMarker(const rclcpp::NodeOptions & options)
+: Node("see_marker", options)
+{
+	/************************************************************
+	** Initialise parameters
+	************************************************************/
+	// Headless by default, the OpenCV window is only for debugging
+	display_ = this->declare_parameter<bool>("display", false);
+	// Topics are relative so that each robot of a fleet can run its own
+	// instance in its namespace
+	std::string image_topic = this->declare_parameter<std::string>("image_topic", "camera/image_raw");
+	camera_frame_ = this->declare_parameter<std::string>("camera_frame", "camera_link");
+
+	// Segment only around the last marker found, with a full-frame search
+	// every full_search_period frames
+	tracking_ = this->declare_parameter<bool>("tracking", true);
+	roi_margin_ = this->declare_parameter<int>("roi_margin", ROI_MARGIN);
+	full_search_period_ = this->declare_parameter<int>("full_search_period", FULL_SEARCH_PERIOD);
+
+	// Search for blobs at 1/2^pyramid_level resolution, the blob heights
+	// are still measured at full resolution
+	pyramid_level_ = this->declare_parameter<int>("pyramid_level", 1);
+
+	/************************************************************
+	** Initialise ROS publishers and subscribers
+	************************************************************/
+	point_pub_ = this->create_publisher<geometry_msgs::msg::PointStamped>("marker_position", 10);
+
+	// Stale frames are of no use, only keep the newest
+	image_sub_ = this->create_subscription<sensor_msgs::msg::Image>(
+		image_topic, rclcpp::QoS(rclcpp::KeepLast(1)).best_effort(),
+		std::bind(&SeeMarker::image_callback, this, std::placeholders::_1));
+
+	worker_ = std::thread(&SeeMarker::worker_loop, this);
+
+	RCLCPP_INFO(this->get_logger(), "See marker node has been initialised");
+}
+
+SeeMarker::~SeeMarker()
+{
+	frames_.close();
+	worker_.join();
+
+	if (display_)
+		cv::destroyAllWindows();
+}
+
+void SeeMarker::image_callback(const sensor_msgs::msg::Image::ConstSharedPtr msg)
+{
+	frames_.put(msg);
+}
+
+void SeeMarker::worker_loop()
+{
+	sensor_msgs::msg::Image::ConstSharedPtr msg;
+	while (frames_.take(msg))
+	{
+		process_frame(msg);
+		RCLCPP_DEBUG_THROTTLE(this->get_logger(), *this->get_clock(), WF_STATE_PERIOD_MS,
+			"%lu frames dropped while busy", (unsigned long) frames_.dropped());
+	}
+}
+
+void SeeMarker::process_frame(const sensor_msgs::msg::Image::ConstSharedPtr & msg)
+{
+	cv_bridge::CvImageConstPtr frame;
+	try
+	{
+		// No copy when the camera already publishes bgr8
+		frame = cv_bridge::toCvShare(msg, "bgr8");
+	}
+	catch (const cv_bridge::Exception & e)
+	{
+		RCLCPP_ERROR(this->get_logger(), "cv_bridge exception: %s", e.what());
+		return;
+	}
+
+	if (!detector_)
+	{
+		detector_ = std::make_unique<MarkerDetector>();
+		detector_->set_tracking(tracking_, roi_margin_, full_search_period_);
+		detector_->set_pyramid_level(pyramid_level_);
+		RCLCPP_INFO(this->get_logger(), "First camera frame, %ux%u", msg->width, msg->height);
+	}
+	detector_->detect(frame->image, detections_);
+
+	for (const MarkerDetection & detection : detections_)
+	{
+		auto marker_at = std::make_unique<geometry_msgs::msg::PointStamped>();
+		marker_at->header.stamp = this->now();
+		marker_at->header.frame_id = camera_frame_;
+		marker_at->point.x = detection.x;
+		marker_at->point.y = detection.y;
+		marker_at->point.z = (double) detection.type;
+		point_pub_->publish(std::move(marker_at));
+	}
+
+	// Display camera image
+	if (display_)
+	{
+		cv::imshow("camera", frame->image);
+		cv::waitKey(1);
+	}
+}
+
+RCLCPP_COMPONENTS_REGISTER_NODE(SeeMarker)
@@ -0,0 +1,135 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/trace_ring.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+
+static const char trace_magic[4] = {'W', 'F', 'T', 'R'};
+
+TraceRing::~TraceRing()
+{
+	close();
+}
+
+// Offset of the first record, after the header and the rule names
+static const size_t trace_records_offset = sizeof(TraceHeader) + TRACE_RULE_NAMES * TRACE_RULE_NAME_SIZE;
+
+bool TraceRing::open(const std::string & path, uint32_t capacity, const std::vector<std::string> & rule_names)
+{
+	close();
+	if (capacity == 0)
+		capacity = TRACE_RING_RECORDS;
+	size_t size = trace_records_offset + (size_t) capacity * sizeof(TraceRecord);
+
+	char names[TRACE_RULE_NAMES][TRACE_RULE_NAME_SIZE] = {};
+	const uint32_t num_rules = (uint32_t) std::min(rule_names.size(), (size_t) TRACE_RULE_NAMES);
+	for (uint32_t i = 0; i < num_rules; i++)
+		std::strncpy(names[i], rule_names[i].c_str(), TRACE_RULE_NAME_SIZE - 1);
+
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+	{
+		error_ = path + ": " + std::strerror(errno);
+		return false;
+	}
+	struct stat st;
+	bool fresh = fstat(fd, &st) != 0 || (size_t) st.st_size != size;
+	if (fresh && ftruncate(fd, size) != 0)
+	{
+		error_ = path + ": " + std::strerror(errno);
+		::close(fd);
+		return false;
+	}
+	void * map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+	{
+		error_ = path + ": " + std::strerror(errno);
+		return false;
+	}
+	map_ = static_cast<uint8_t *>(map);
+	size_ = size;
+	capacity_ = capacity;
+
+	TraceHeader header;
+	std::memcpy(&header, map_, sizeof(header));
+	if (fresh || std::memcmp(header.magic, trace_magic, 4) != 0 || header.version != TRACE_RING_VERSION ||
+		header.record_size != sizeof(TraceRecord) || header.capacity != capacity ||
+		header.num_sectors != NUM_SECTORS || header.num_rules != num_rules ||
+		std::memcmp(map_ + sizeof(TraceHeader), names, sizeof(names)) != 0)
+	{
+		std::memset(map_, 0, size_);
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, trace_magic, 4);
+		header.version = TRACE_RING_VERSION;
+		header.record_size = sizeof(TraceRecord);
+		header.capacity = capacity;
+		header.num_sectors = NUM_SECTORS;
+		header.num_rules = num_rules;
+		std::memcpy(map_ + sizeof(TraceHeader), names, sizeof(names));
+		header.created = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	// Carry on after the newest record of the previous runs
+	seq_ = 0;
+	for (uint32_t i = 0; i < capacity_; i++)
+	{
+		uint64_t seq;
+		std::memcpy(&seq, map_ + trace_records_offset + (size_t) i * sizeof(TraceRecord), sizeof(seq));
+		if (seq > seq_ && (seq - 1) % capacity_ == i)
+			seq_ = seq;
+	}
+	run_ = ++header.runs;
+	std::memcpy(map_, &header, sizeof(header));
+	msync(map_, sizeof(header), MS_SYNC);
+	return true;
+}
+
+void TraceRing::write(const TraceRecord & record)
+{
+	if (!map_)
+		return;
+	uint64_t seq = ++seq_;
+	uint8_t * slot = map_ + trace_records_offset + (size_t) ((seq - 1) % capacity_) * sizeof(TraceRecord);
+
+	// Invalidate, copy the body, then publish the seq
+	const uint64_t none = 0;
+	std::memcpy(slot, &none, sizeof(none));
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(slot + offsetof(TraceRecord, run), &run_, sizeof(run_));
+	std::memcpy(slot + offsetof(TraceRecord, flags), reinterpret_cast<const uint8_t *>(&record) +
+		offsetof(TraceRecord, flags), sizeof(TraceRecord) - offsetof(TraceRecord, flags));
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(slot, &seq, sizeof(seq));
+}
+
+void TraceRing::close()
+{
+	if (map_)
+	{
+		msync(map_, size_, MS_SYNC);
+		munmap(map_, size_);
+		map_ = nullptr;
+	}
+}
@@ -0,0 +1,102 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/trajectory_index.hpp"
+
+#include <cmath>
+
+
+bool parse_revisit_policy(const std::string & name, RevisitPolicy & policy)
+{
+	if (name == "start")
+		policy = RevisitPolicy::START;
+	else if (name == "any")
+		policy = RevisitPolicy::ANY;
+	else if (name == "log")
+		policy = RevisitPolicy::LOG;
+	else if (name == "explore")
+		policy = RevisitPolicy::EXPLORE;
+	else
+		return false;
+	return true;
+}
+
+TrajectoryIndex::TrajectoryIndex(double cell, double spacing)
+: cell_(cell), spacing_(spacing)
+{
+}
+
+void TrajectoryIndex::clear()
+{
+	distance_ = 0.0;
+	poses_.clear();
+	cells_.clear();
+}
+
+int64_t TrajectoryIndex::cell_of(double v) const
+{
+	return (int64_t) std::floor(v / cell_);
+}
+
+uint64_t TrajectoryIndex::key(int64_t cx, int64_t cy)
+{
+	return ((uint64_t) (uint32_t) cx << 32) | (uint32_t) cy;
+}
+
+bool TrajectoryIndex::add(double x, double y)
+{
+	if (!poses_.empty())
+	{
+		const TrajectoryPose & last = poses_.back();
+		double step = std::hypot(x - last.x, y - last.y);
+		if (step < spacing_)
+			return false;
+		distance_ += step;
+	}
+
+	TrajectoryPose pose = {x, y, distance_};
+	cells_[key(cell_of(x), cell_of(y))].push_back((uint32_t) poses_.size());
+	poses_.push_back(pose);
+	return true;
+}
+
+long TrajectoryIndex::find_visited(double x, double y, double radius, double gap) const
+{
+	const double max_distance = distance_ - gap;
+	if (max_distance < 0.0)
+		return -1;
+
+	long nearest = -1;
+	double nearest_d2 = radius * radius;
+	for (int64_t cx = cell_of(x - radius); cx <= cell_of(x + radius); cx++)
+	{
+		for (int64_t cy = cell_of(y - radius); cy <= cell_of(y + radius); cy++)
+		{
+			auto cell = cells_.find(key(cx, cy));
+			if (cell == cells_.end())
+				continue;
+			for (uint32_t i : cell->second)
+			{
+				const TrajectoryPose & pose = poses_[i];
+				if (pose.distance > max_distance)
+					continue;
+				double d2 = (pose.x - x) * (pose.x - x) + (pose.y - y) * (pose.y - y);
+				if (d2 <= nearest_d2)
+				{
+					nearest_d2 = d2;
+					nearest = (long) i;
+				}
+			}
+		}
+	}
+	return nearest;
+}
@@ -0,0 +1,150 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wall_follower/wall_controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+static double clamp(double v, double lo, double hi)
+{
+	return std::max(lo, std::min(hi, v));
+}
+
+void WallController::configure(const WallConfig & config)
+{
+	config_ = config;
+	left_.set_window(config.first_angle, config.last_angle);
+	front_.set_window(-M_PI_2, M_PI_2);
+	integral_ = 0.0;
+
+	// With e the distance error and psi the heading towards the wall,
+	// e' = -v sin(psi) and psi' = w. Taking w = kp e - kd psi gives
+	// e'' + 2 zeta wn e' + wn^2 e = 0 for kp = wn^2 / v and kd = 2 zeta wn.
+	// wn = v / lookahead keeps the convergence distance the same at every
+	// speed. The slowest bin uses the speed at its upper edge so that kp
+	// stays finite.
+	const double dv = config.max_linear / GAIN_TABLE_SIZE;
+	for (int i = 0; i < GAIN_TABLE_SIZE; i++)
+	{
+		double v = (i + 1) * dv;
+		double wn = v / config.lookahead;
+		WallGains & g = table_[i];
+		g.kp = wn * wn / v;
+		g.kd = 2.0 * config.damping * wn;
+		g.ki = config.integral_ratio * g.kp;
+	}
+}
+
+const WallGains & WallController::gains(double speed) const
+{
+	int i = (int) (speed / config_.max_linear * GAIN_TABLE_SIZE);
+	return table_[std::max(0, std::min(GAIN_TABLE_SIZE - 1, i))];
+}
+
+bool WallController::fit(const float * ranges, float range_min, float range_max, WallFit & wall) const
+{
+	const float fit_range = (float) std::min((double) range_max, config_.fit_range);
+	double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0, syy = 0.0;
+	int n = 0;
+	for (size_t i = 0; i < left_.size(); i++)
+	{
+		int32_t beam = left_.index(i);
+		if (beam < 0)
+			continue;
+		float r = ranges[beam];
+		if (!(r >= range_min && r <= fit_range))
+			continue;
+		double a = left_.angle(i);
+		double x = r * std::cos(a);
+		double y = r * std::sin(a);
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+		syy += y * y;
+		n++;
+	}
+	wall.points = n;
+	if (n < config_.min_points)
+		return false;
+
+	double mx = sx / n, my = sy / n;
+	double cxx = sxx / n - mx * mx;
+	double cxy = sxy / n - mx * my;
+	double cyy = syy / n - my * my;
+
+	// Direction of the line, taken pointing forwards
+	double phi = 0.5 * std::atan2(2.0 * cxy, cxx - cyy);
+	if (std::cos(phi) < 0.0)
+		phi += M_PI;
+	phi = std::atan2(std::sin(phi), std::cos(phi));
+
+	// Distance from the robot to the line through the centroid
+	wall.distance = std::fabs(mx * std::sin(phi) - my * std::cos(phi));
+	// The wall turning clockwise in the robot frame means the robot is
+	// heading towards it
+	wall.angle = -phi;
+	return true;
+}
+
+bool WallController::control(const ScanGeometry & geometry, const float * ranges, float range_min,
+	float range_max, double dt, double & linear, double & angular)
+{
+	if (!left_.update(geometry) || !front_.update(geometry))
+		return false;
+
+	// Free distance ahead in the corridor swept by the robot
+	double front = config_.slow_distance;
+	for (size_t i = 0; i < front_.size(); i++)
+	{
+		int32_t beam = front_.index(i);
+		if (beam < 0)
+			continue;
+		double a = front_.angle(i);
+		float r = ranges[beam];
+		if (r >= range_min && r <= range_max && r * std::fabs(std::sin(a)) <= config_.safety_radius)
+			front = std::min(front, r * std::cos(a));
+	}
+	if (front < config_.stop_distance)
+	{
+		// Blocked: turn away from the wall on the spot, as the rule ladder does
+		integral_ = 0.0;
+		linear = 0.0;
+		angular = -config_.max_angular;
+		return true;
+	}
+
+	WallFit wall;
+	if (!fit(ranges, range_min, range_max, wall))
+	{
+		// No wall: arc left to find it again
+		integral_ = 0.0;
+		linear = config_.lost_linear;
+		angular = config_.lost_angular;
+		return true;
+	}
+
+	double v = config_.max_linear * clamp((front - config_.stop_distance) /
+		(config_.slow_distance - config_.stop_distance), 0.0, 1.0);
+	const WallGains & g = gains(v);
+	double e = wall.distance - config_.target;
+
+	integral_ = clamp(integral_ + e * clamp(dt, 0.0, 1.0), -config_.integral_limit, config_.integral_limit);
+	double w = g.kp * e + g.ki * integral_ - g.kd * wall.angle;
+
+	angular = clamp(w, -config_.max_angular, config_.max_angular);
+	// Slow down while turning hard
+	linear = v * (1.0 - 0.5 * std::fabs(angular) / config_.max_angular);
+	return true;
+}
@@ -18,23 +18,198 @@
 // Use this code as the basis for a wall follower
 
 #include "wall_follower/wall_follower.hpp"
+#include "wall_follower/logging.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <lifecycle_msgs/msg/state.hpp>
+#include <rclcpp_components/register_node_macro.hpp>
 
 
 using namespace std::chrono_literals;
 
-WallFollower::WallFollower()
-: Node("wall_follower_node")
+static inline int64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+// Intra-process comms are always enabled so that, when loaded into the same
+// container as the lidar driver and base controller, scans and velocity
+// commands are passed by pointer instead of being serialised
+WallFollower::WallFollower(const rclcpp::NodeOptions & options)
+: LifecycleNode("wall_follower_node", rclcpp::NodeOptions(options).use_intra_process_comms(true))
 {
 	/************************************************************
 	** Initialise variables
 	************************************************************/
-	for (int i = 0; i < 12; i++)
-		scan_data_[i] = 0.0;
+	ScanState scan = {};
+	scan_state_.store(scan);
+	OdomState odom = {};
+	odom_state_.store(odom);
+	OdomSample sample = {};
+	odom_sample_.store(sample);
+	ExploreTarget target = {};
+	explore_target_.store(target);
+	scan_timed_out_ = false;
+	scan_ready_ = false;
+	odom_ready_ = false;
+	active_ = false;
+
+	/************************************************************
+	** Initialise parameters
+	************************************************************/
+	std::string control_mode = this->declare_parameter<std::string>("control_mode", "event");
+	scan_timeout_ = this->declare_parameter<double>("scan_timeout", 0.5);
+	double sector_percentile = this->declare_parameter<double>("sector_percentile", 0.0);
+	double beam_width = this->declare_parameter<double>("beam_width", BEAM_WIDTH);
+	double keepalive = this->declare_parameter<double>("cmd_vel_keepalive", 0.5);
+	cmd_vel_keepalive_ = (rcl_duration_value_t) (keepalive * 1e9);
+	diagnostics_period_ = this->declare_parameter<double>("diagnostics_period", 5.0);
+	latency_warn_ = this->declare_parameter<double>("latency_warn", 0.1);
+	std::string revisit_policy = this->declare_parameter<std::string>("revisit_policy", "start");
+	revisit_radius_ = this->declare_parameter<double>("revisit_radius", REVISIT_RADIUS);
+	revisit_gap_ = this->declare_parameter<double>("revisit_gap", REVISIT_GAP);
+	motion_compensation_ = this->declare_parameter<bool>("motion_compensation", false);
+	compensation_horizon_ = this->declare_parameter<double>("compensation_horizon", COMPENSATION_HORIZON);
+	autostart_ = this->declare_parameter<bool>("autostart", true);
+	trace_file_ = this->declare_parameter<std::string>("trace_file", "");
+	trace_records_ = (uint32_t) std::max(1, (int) this->declare_parameter<int>("trace_records", TRACE_RING_RECORDS));
+	map_topic_ = this->declare_parameter<std::string>("map_topic", "map");
+	odom_frame_ = this->declare_parameter<std::string>("odom_frame", "odom");
+	explore_min_distance_ = this->declare_parameter<double>("explore.min_distance", 0.5);
+	explore_reach_ = this->declare_parameter<double>("explore.reach", 0.3);
+	explore_timeout_ = this->declare_parameter<double>("explore.timeout", 30.0);
+	explore_clearance_ = this->declare_parameter<double>("explore.clearance", 0.6);
+	explore_heading_gain_ = this->declare_parameter<double>("explore.heading_gain", 1.5);
+	explore_empty_maps_ = std::max(1, (int) this->declare_parameter<int>("explore.empty_maps", 5));
+	std::string odom_mode = this->declare_parameter<std::string>("odom_mode", "decimate");
+	odom_decimation_ = std::max(1, (int) this->declare_parameter<int>("odom_decimation", 1));
+	// Read by main() to choose the executor
+	this->declare_parameter<int>("executor_threads", 1);
+
+	pipeline_.set_beam_width(beam_width * DEG2RAD);
+	pipeline_.set_percentile(sector_percentile);
+
+	ScanFilterConfig scan_filter;
+	scan_filter.depth = this->declare_parameter<int>("scan_filter.depth", scan_filter.depth);
+	scan_filter.spike_threshold = this->declare_parameter<double>("scan_filter.spike_threshold",
+		scan_filter.spike_threshold);
+	pipeline_.scan_filter().configure(scan_filter);
+	adaptive_rate_ = this->declare_parameter<bool>("adaptive_rate", false);
+	RateConfig rate;
+	rate.fast_period = this->declare_parameter<double>("rate.fast_period", rate.fast_period);
+	rate.slow_period = this->declare_parameter<double>("rate.slow_period", rate.slow_period);
+	rate.idle_period = this->declare_parameter<double>("rate.idle_period", rate.idle_period);
+	rate.near_distance = this->declare_parameter<double>("rate.near_distance", rate.near_distance);
+	rate.far_distance = this->declare_parameter<double>("rate.far_distance", rate.far_distance);
+	rate.fast_speed = this->declare_parameter<double>("rate.fast_speed", rate.fast_speed);
+	rate.hysteresis = this->declare_parameter<double>("rate.hysteresis", rate.hysteresis);
+	rate_scheduler_.configure(rate);
+
+	if (pipeline_.scan_filter().enabled())
+		RCLCPP_INFO(this->get_logger(), "Scan filter: median of %d scans, spike threshold %.2f m",
+			pipeline_.scan_filter().config().depth, pipeline_.scan_filter().config().spike_threshold);
+
+	load_rules();
+	load_steering();
+
+	if (control_mode == "event")
+		event_driven_ = true;
+	else if (control_mode == "timer")
+		event_driven_ = false;
+	else
+	{
+		RCLCPP_WARN(this->get_logger(), "Unknown control_mode '%s', using 'event'", control_mode.c_str());
+		event_driven_ = true;
+	}
+	if (odom_mode == "decimate")
+		odom_latest_ = false;
+	else if (odom_mode == "latest")
+		odom_latest_ = true;
+	else
+	{
+		RCLCPP_WARN(this->get_logger(), "Unknown odom_mode '%s', using 'decimate'", odom_mode.c_str());
+		odom_latest_ = false;
+	}
+	if (!parse_revisit_policy(revisit_policy, revisit_policy_))
+	{
+		RCLCPP_WARN(this->get_logger(), "Unknown revisit_policy '%s', using 'start'", revisit_policy.c_str());
+		revisit_policy_ = RevisitPolicy::START;
+	}
+	last_scan_time_ = 0;
+
+	/************************************************************
+	** Bring-up
+	************************************************************/
+	// With autostart the node configures itself once spinning, then
+	// activates on the first usable scan and odometry, so it can be started
+	// before the simulator or the robot drivers. Otherwise a lifecycle
+	// manager drives the transitions.
+	if (autostart_)
+		startup_timer_ = this->create_wall_timer(50ms, std::bind(&WallFollower::startup_callback, this));
+
+	RCLCPP_INFO(this->get_logger(), "Wall follower node has been initialised (%s-driven control)",
+		event_driven_ ? "event" : "timer");
+}
+
+WallFollower::~WallFollower()
+{
+	RCLCPP_INFO(this->get_logger(), "Wall follower node has been terminated");
+}
+
+/********************************************************************************
+** Lifecycle
+********************************************************************************/
 
-	robot_pose_ = 0.0;
-	near_start = false;
+void WallFollower::startup_callback()
+{
+	uint8_t state = this->get_current_state().id();
+	if (state == lifecycle_msgs::msg::State::PRIMARY_STATE_UNCONFIGURED)
+		this->configure();
+	else if (state == lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE)
+	{
+		if (!scan_ready_ || !odom_ready_)
+		{
+			RCLCPP_INFO_THROTTLE(this->get_logger(), *this->get_clock(), WF_STATE_PERIOD_MS,
+				"Waiting for %s", !scan_ready_ ? (!odom_ready_ ? "scan and odometry" : "scan") : "odometry");
+			return;
+		}
+		RCLCPP_INFO(this->get_logger(), "First scan and odometry received");
+		this->activate();
+		startup_timer_->cancel();
+	}
+	else
+		startup_timer_->cancel();
+}
+
+// Subscriptions and publishers. Scans and odometry are processed from here
+// on, so that the sector tables and odometry state are warm by activation,
+// but no command is sent until then.
+CallbackReturn WallFollower::on_configure(const rclcpp_lifecycle::State &)
+{
+	/************************************************************
+	** Initialise callback groups
+	************************************************************/
+	// In event-driven mode the control loop runs inside scan_callback, so the
+	// watchdog shares its group and control state stays single-threaded
+	scan_group_ = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+	odom_group_ = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+	if (event_driven_)
+		control_group_ = scan_group_;
+	else
+		control_group_ = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+	if (revisit_policy_ == RevisitPolicy::EXPLORE)
+		map_group_ = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
 
 	/************************************************************
 	** Initialise ROS publishers and subscribers
@@ -43,194 +218,773 @@ WallFollower::WallFollower()
 
 	// Initialise publishers
 	cmd_vel_pub_ = this->create_publisher<geometry_msgs::msg::Twist>("cmd_vel", qos);
+	diagnostics_pub_ = this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("diagnostics", qos);
 
 	// Initialise subscribers
+	rclcpp::SubscriptionOptions scan_options;
+	scan_options.callback_group = scan_group_;
 	scan_sub_ = this->create_subscription<sensor_msgs::msg::LaserScan>(
 		"scan", \
 		rclcpp::SensorDataQoS(), \
 		std::bind(
 			&WallFollower::scan_callback, \
 			this, \
-			std::placeholders::_1));
+			std::placeholders::_1), \
+		scan_options);
+
+	rclcpp::SubscriptionOptions odom_options;
+	odom_options.callback_group = odom_group_;
 	odom_sub_ = this->create_subscription<nav_msgs::msg::Odometry>(
-		"odom", qos, std::bind(&WallFollower::odom_callback, this, std::placeholders::_1));
+		"odom", qos, std::bind(&WallFollower::odom_callback, this, std::placeholders::_1), odom_options);
+
+	// Exploration follows the occupancy grid from Cartographer (or any SLAM
+	// node), aligned to odometry through tf
+	if (revisit_policy_ == RevisitPolicy::EXPLORE)
+	{
+		tf_buffer_ = std::make_shared<tf2_ros::Buffer>(this->get_clock());
+		tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_, this, false);
+
+		rclcpp::SubscriptionOptions map_options;
+		map_options.callback_group = map_group_;
+		map_sub_ = this->create_subscription<nav_msgs::msg::OccupancyGrid>(
+			map_topic_, rclcpp::QoS(rclcpp::KeepLast(1)).reliable(),
+			std::bind(&WallFollower::map_callback, this, std::placeholders::_1), map_options);
+	}
+
+	// Decode with scripts/decode_trace.py
+	if (!trace_file_.empty())
+	{
+		std::vector<std::string> rule_names;
+		for (size_t i = 0; i <= pipeline_.rules().size(); i++)
+			rule_names.push_back(pipeline_.rules().rule(i).name);
+		if (trace_.open(trace_file_, trace_records_, rule_names))
+			RCLCPP_INFO(this->get_logger(), "Tracing to %s, %u records, from tick %lu", trace_file_.c_str(),
+				trace_records_, (unsigned long) trace_.written() + 1);
+		else
+			RCLCPP_ERROR(this->get_logger(), "Cannot open trace %s", trace_.error().c_str());
+	}
+
+	return CallbackReturn::SUCCESS;
+}
+
+CallbackReturn WallFollower::on_activate(const rclcpp_lifecycle::State &)
+{
+	cmd_vel_pub_->on_activate();
+	diagnostics_pub_->on_activate();
+	active_ = true;
 
 	/************************************************************
 	** Initialise ROS timers
 	************************************************************/
-	update_timer_ = this->create_wall_timer(100ms, std::bind(&WallFollower::update_callback, this));
+	last_scan_time_ = this->now().nanoseconds();
+	if (!event_driven_)
+		schedule_update(adaptive_rate_ ? rate_scheduler_.period() : CONTROL_PERIOD);
+	watchdog_timer_ = this->create_wall_timer(100ms, std::bind(&WallFollower::watchdog_callback, this),
+		control_group_);
+	if (diagnostics_period_ > 0.0)
+		diagnostics_timer_ = this->create_wall_timer(
+			std::chrono::duration<double>(diagnostics_period_),
+			std::bind(&WallFollower::diagnostics_callback, this));
+
+	RCLCPP_INFO(this->get_logger(), "Wall follower active");
+	return CallbackReturn::SUCCESS;
+}
 
-	RCLCPP_INFO(this->get_logger(), "Wall follower node has been initialised");
+// Stop the robot and the control loop, keep processing sensor data
+CallbackReturn WallFollower::on_deactivate(const rclcpp_lifecycle::State &)
+{
+	// Under the lock, a control tick still running either sends its command
+	// before the stop or finds the node inactive and sends nothing
+	{
+		std::lock_guard<std::mutex> lock(control_mutex_);
+		active_ = false;
+		cmd_vel_sent_ = false;
+		send_cmd_vel(0.0, 0.0);
+		if (update_timer_)
+			update_timer_->cancel();
+		update_timer_.reset();
+	}
+	for (rclcpp::TimerBase::SharedPtr * timer : {&watchdog_timer_, &diagnostics_timer_})
+	{
+		if (*timer)
+			(*timer)->cancel();
+		timer->reset();
+	}
+
+	cmd_vel_pub_->on_deactivate();
+	diagnostics_pub_->on_deactivate();
+	RCLCPP_INFO(this->get_logger(), "Wall follower inactive, robot stopped");
+	return CallbackReturn::SUCCESS;
 }
 
-WallFollower::~WallFollower()
+CallbackReturn WallFollower::on_cleanup(const rclcpp_lifecycle::State &)
 {
-	RCLCPP_INFO(this->get_logger(), "Wall follower node has been terminated");
+	scan_sub_.reset();
+	odom_sub_.reset();
+	map_sub_.reset();
+	tf_listener_.reset();
+	tf_buffer_.reset();
+	cmd_vel_pub_.reset();
+	diagnostics_pub_.reset();
+	trace_.close();
+	scan_ready_ = false;
+	odom_ready_ = false;
+	return CallbackReturn::SUCCESS;
+}
+
+CallbackReturn WallFollower::on_shutdown(const rclcpp_lifecycle::State & state)
+{
+	if (active_)
+		on_deactivate(state);
+	return on_cleanup(state);
 }
 
 /********************************************************************************
 ** Callback functions for ROS subscribers
 ********************************************************************************/
 
-#define START_RANGE	0.2
+// Yaw of a quaternion, the z of its ZYX Euler angles, without going through
+// a rotation matrix
+static inline double quaternion_yaw(double x, double y, double z, double w)
+{
+	return std::atan2(2.0 * (w * z + x * y), 1.0 - 2.0 * (y * y + z * z));
+}
 
+// Cheap at any odometry rate: copy the fields used and hand them on, either
+// to process_odom() every odom_decimation messages, or in "latest" mode to
+// the control loop, which processes only the newest sample once per tick
 void WallFollower::odom_callback(const nav_msgs::msg::Odometry::SharedPtr msg)
 {
-	static bool first = true;
-	static bool start_moving = true;
+	OdomSample sample;
+	sample.x = msg->pose.pose.position.x;
+	sample.y = msg->pose.pose.position.y;
+	sample.qx = msg->pose.pose.orientation.x;
+	sample.qy = msg->pose.pose.orientation.y;
+	sample.qz = msg->pose.pose.orientation.z;
+	sample.qw = msg->pose.pose.orientation.w;
+	sample.linear = msg->twist.twist.linear.x;
+	sample.angular = msg->twist.twist.angular.z;
+	sample.seq = ++odom_seq_;
+	odom_ready_ = true;
+
+	if (odom_latest_)
+		odom_sample_.store(sample);
+	else if (sample.seq % odom_decimation_ == 0)
+		process_odom(sample);
+}
 
-	tf2::Quaternion q(
-		msg->pose.pose.orientation.x,
-		msg->pose.pose.orientation.y,
-		msg->pose.pose.orientation.z,
-		msg->pose.pose.orientation.w);
-	tf2::Matrix3x3 m(q);
-	double roll, pitch, yaw;
-	m.getRPY(roll, pitch, yaw);
+void WallFollower::process_odom(const OdomSample & sample)
+{
+	double yaw = quaternion_yaw(sample.qx, sample.qy, sample.qz, sample.qw);
 
-	robot_pose_ = yaw;
+	double current_x = sample.x;
+	double current_y = sample.y;
+	if (start_detector_.update(current_x, current_y))
+		RCLCPP_INFO(this->get_logger(), "Near start!!");
 
-	double current_x =  msg->pose.pose.position.x;
-	double current_y =  msg->pose.pose.position.y;
-	if (first)
+	// Re-entering any part of the path driven so far
+	if (revisit_policy_ != RevisitPolicy::START)
 	{
-		start_x = current_x;
-		start_y = current_y;
-		first = false;
+		trajectory_.add(current_x, current_y);
+		long visited = trajectory_.find_visited(current_x, current_y, revisit_radius_, revisit_gap_);
+		bool revisiting = visited >= 0;
+		if (revisiting && !revisiting_)
+		{
+			const TrajectoryPose & pose = trajectory_.pose(visited);
+			RCLCPP_INFO(this->get_logger(), "Re-entered explored path at (x: %f, y: %f), first visited %.1f m ago",
+				current_x, current_y, trajectory_.distance() - pose.distance);
+			if (revisit_policy_ == RevisitPolicy::ANY)
+				revisit_stop_ = true;
+		}
+		revisiting_ = revisiting;
 	}
-	else if (start_moving)
+
+	OdomState odom;
+	odom.x = current_x;
+	odom.y = current_y;
+	odom.yaw = yaw;
+	odom.linear = sample.linear;
+	odom.angular = sample.angular;
+	if (revisit_policy_ == RevisitPolicy::ANY)
+		odom.near_start = revisit_stop_;
+	else if (revisit_policy_ == RevisitPolicy::EXPLORE)
+		odom.near_start = false;	// the control loop decides, from the map
+	else
+		odom.near_start = start_detector_.near_start();
+	odom.revisiting = revisiting_;
+	odom_state_.store(odom);
+
+	WF_TRACE(this->get_logger(), "Position (x: %f, y: %f), Orientation (yaw: %f)", current_x, current_y, yaw);
+}
+
+// Refresh the frontiers from the tiles of the map that changed, and pick the
+// one nearest the robot. The target is handed to the control loop in the
+// odometry frame, so it needs no transform per tick.
+void WallFollower::map_callback(const nav_msgs::msg::OccupancyGrid::SharedPtr msg)
+{
+	GridInfo info;
+	info.width = msg->info.width;
+	info.height = msg->info.height;
+	info.resolution = msg->info.resolution;
+	info.origin_x = msg->info.origin.position.x;
+	info.origin_y = msg->info.origin.position.y;
+	if (msg->data.size() != (size_t) info.width * info.height)
+		return;
+	size_t scanned = frontier_map_.update(info, msg->data.data());
+	(void) scanned;		// only traced
+
+	// odom <- map. Before the first transform, assume the frames coincide.
+	double tx = 0.0, ty = 0.0, tyaw = 0.0;
+	try
 	{
-		if (fabs(current_x - start_x) > START_RANGE || fabs(current_y - start_y) > START_RANGE)
-			start_moving = false;
+		geometry_msgs::msg::TransformStamped t = tf_buffer_->lookupTransform(odom_frame_, msg->header.frame_id,
+			tf2::TimePointZero);
+		tx = t.transform.translation.x;
+		ty = t.transform.translation.y;
+		tyaw = quaternion_yaw(t.transform.rotation.x, t.transform.rotation.y, t.transform.rotation.z,
+			t.transform.rotation.w);
 	}
-	else if (fabs(current_x - start_x) < START_RANGE && fabs(current_y - start_y) < START_RANGE)
+	catch (const tf2::TransformException & e)
 	{
-		fprintf(stderr, "Near start!!\n");
-		near_start = true;
-		first = true;
-		start_moving = true;
+		RCLCPP_WARN_THROTTLE(this->get_logger(), *this->get_clock(), WF_STATE_PERIOD_MS,
+			"No transform from %s to %s, using the map as is: %s", msg->header.frame_id.c_str(),
+			odom_frame_.c_str(), e.what());
 	}
-	RCLCPP_INFO(this->get_logger(), "Position (x: %f, y: %f), Orientation (yaw: %f)", 
-            msg->pose.pose.position.x, 
-            msg->pose.pose.position.y, 
-            robot_pose_);
+	const double c = std::cos(tyaw), s = std::sin(tyaw);
+
+	// Robot in the map frame
+	OdomState odom = odom_state_.load();
+	double dx = odom.x - tx, dy = odom.y - ty;
+	double rx = c * dx + s * dy;
+	double ry = -s * dx + c * dy;
+
+	ExploreTarget target;
+	double fx, fy;
+	target.valid = frontier_map_.nearest(rx, ry, explore_min_distance_, fx, fy);
+	target.x = target.valid ? tx + c * fx - s * fy : 0.0;
+	target.y = target.valid ? ty + s * fx + c * fy : 0.0;
+	target.none_left = frontier_map_.frontier_cells() == 0;
+	empty_maps_ = target.valid ? 0 : empty_maps_ + 1;
+	target.empty_maps = empty_maps_;
+	target.seq = ++map_seq_;
+	explore_target_.store(target);
+
+	WF_TRACE(this->get_logger(), "Map %ux%u: %zu tiles scanned, %zu frontier cells", info.width, info.height,
+		scanned, frontier_map_.frontier_cells());
 }
 
-#define BEAM_WIDTH 10
-
 void WallFollower::scan_callback(const sensor_msgs::msg::LaserScan::SharedPtr msg)
 {
-	new_scan_data_ = true;
-	uint16_t scan_angle[12] = {0, 30, 60, 90, 120, 150, 180, 210, 240, 270, 300, 330};
-
-	double closest = msg->range_max;
-	for (int angle = 360-BEAM_WIDTH; angle < 360; angle++)
-		if (msg->ranges.at(angle) < closest)
-			closest = msg->ranges.at(angle);
-	for (int angle = 0; angle < BEAM_WIDTH; angle++)
-		if (msg->ranges.at(angle) < closest)
-			closest = msg->ranges.at(angle);
-	scan_data_[0] = closest;
-
-	for (int i = 1; i < 12; i++)
+	auto start = std::chrono::steady_clock::now();
+	rcl_time_point_value_t now = this->now().nanoseconds();
+	rcl_time_point_value_t stamp = rclcpp::Time(msg->header.stamp).nanoseconds();
+	latency_[LATENCY_TRANSPORT].record(now - stamp);
+
+	last_scan_time_ = now;
+	if (scan_timed_out_.exchange(false))
+		RCLCPP_INFO(this->get_logger(), "Scans resumed");
+
+	// Index tables are only rebuilt when the lidar geometry changes, e.g.
+	// an LDS-02 reporting a different number of beams
+	ScanGeometry geometry;
+	geometry.angle_min = msg->angle_min;
+	geometry.angle_increment = msg->angle_increment;
+	geometry.num_ranges = msg->ranges.size();
+
+	// Spike rejection and temporal median, if enabled
+	const float * ranges = pipeline_.filter(geometry, msg->ranges.data(), msg->range_min, msg->range_max);
+
+	ScanState scan;
+	size_t rebuilds = pipeline_.reducer().rebuilds();
+	bool usable = pipeline_.reduce(geometry, ranges, msg->range_min, msg->range_max, scan.sectors);
+	if (pipeline_.reducer().rebuilds() != rebuilds)
 	{
-		closest = msg->range_max;
-		for (int angle = scan_angle[i]-BEAM_WIDTH; angle < scan_angle[i]+BEAM_WIDTH; angle++)
-			if (msg->ranges.at(angle) < closest)
-				closest = msg->ranges.at(angle);
-		scan_data_[i] = closest;
+		if (usable)
+			RCLCPP_INFO(this->get_logger(), "Scan geometry: %zu ranges from %.3f rad, %.4f rad apart",
+				geometry.num_ranges, geometry.angle_min, geometry.angle_increment);
+		else
+			RCLCPP_WARN(this->get_logger(), "Unusable scan geometry (%zu ranges, increment %f)",
+				geometry.num_ranges, geometry.angle_increment);
+	}
+	if (!usable)
+		return;
+	scan_ready_ = true;
+
+	// Steering modes other than the rule table plan from the full scan here,
+	// while the ranges are at hand
+	scan.steered = pipeline_.steer(geometry, ranges, msg->range_min, msg->range_max, stamp * 1e-9, scan.steer);
+
+	scan.range_max = msg->range_max;
+	scan.seq = ++scan_seq_;
+	scan.stamp = stamp;
+	latency_[LATENCY_REDUCE].record(elapsed_ns(start));
+	scan_state_.store(scan);
+
+	WF_TRACE(this->get_logger(), "Closest distance in front: %f", scan.sectors[FRONT]);
+
+	// In event-driven mode every scan produces a command straight away.
+	// With adaptive_rate, a stopped robot is only re-evaluated every
+	// rate.idle_period, the scans in between are just reduced.
+	if (event_driven_ && active_)
+	{
+		if (adaptive_rate_ && idle_ &&
+			now - last_tick_time_ < (rcl_time_point_value_t) (rate_scheduler_.config().idle_period * 1e9))
+			return;
+		update_callback();
 	}
-
-	RCLCPP_INFO(this->get_logger(), "Closest distance in front: %f", scan_data_[0]);
 }
 
 void WallFollower::update_cmd_vel(double linear, double angular)
 {
-	geometry_msgs::msg::Twist cmd_vel;
-	cmd_vel.linear.x = linear;
-	cmd_vel.angular.z = angular;
+	std::lock_guard<std::mutex> lock(control_mutex_);
+	if (active_)
+		send_cmd_vel(linear, angular);
+}
 
-	cmd_vel_pub_->publish(cmd_vel);
+// Called with control_mutex_ held
+void WallFollower::send_cmd_vel(double linear, double angular)
+{
+	// An unchanged command is only re-sent once the keep-alive period has
+	// passed, so the base sees a message when something changes
+	rcl_time_point_value_t now = this->now().nanoseconds();
+	if (cmd_vel_sent_ && linear == cmd_vel_msg_.linear.x && angular == cmd_vel_msg_.angular.z &&
+		now - last_cmd_vel_time_ < cmd_vel_keepalive_)
+		return;
+	cmd_vel_sent_ = true;
+	last_cmd_vel_time_ = now;
+
+	cmd_vel_msg_.linear.x = linear;
+	cmd_vel_msg_.angular.z = angular;
+
+	if (cmd_vel_pub_->can_loan_messages())
+	{
+		// The middleware owns the buffer (e.g. shared memory), no copy is
+		// made. LifecyclePublisher does not forward the loaned publish, so the
+		// base class one is called; commands are only sent while active.
+		auto loaned = cmd_vel_pub_->borrow_loaned_message();
+		loaned.get() = cmd_vel_msg_;
+		static_cast<rclcpp::Publisher<geometry_msgs::msg::Twist> &>(*cmd_vel_pub_).publish(std::move(loaned));
+	}
+	else if (cmd_vel_pub_->get_intra_process_subscription_count() > 0)
+	{
+		// Publishing a unique_ptr hands ownership to intra-process
+		// subscribers without a copy
+		auto cmd_vel = std::make_unique<geometry_msgs::msg::Twist>(cmd_vel_msg_);
+		cmd_vel_pub_->publish(std::move(cmd_vel));
+	}
+	else
+		cmd_vel_pub_->publish(cmd_vel_msg_);
 }
 
 /********************************************************************************
 ** Update functions
 ********************************************************************************/
 
-bool pl_near;
+// Choose the steering mode and configure its planner:
+//   steering_mode: "rules" (the rule table), "gap" (follow-the-gap) or
+//     "wall_pid" (wall line fit and PD control)
+//   gap.*: GapConfig, wall_pid.*: WallConfig, angles in degrees
+void WallFollower::load_steering()
+{
+	std::string mode = this->declare_parameter<std::string>("steering_mode", "rules");
+
+	GapConfig gap;
+	gap.half_fov = this->declare_parameter<double>("gap.half_fov", gap.half_fov * RAD2DEG) * DEG2RAD;
+	gap.lookahead = this->declare_parameter<double>("gap.lookahead", gap.lookahead);
+	gap.safety_radius = this->declare_parameter<double>("gap.safety_radius", gap.safety_radius);
+	gap.clearance = this->declare_parameter<double>("gap.clearance", gap.clearance);
+	gap.stop_distance = this->declare_parameter<double>("gap.stop_distance", gap.stop_distance);
+	gap.max_linear = this->declare_parameter<double>("gap.max_linear", gap.max_linear);
+	gap.max_angular = this->declare_parameter<double>("gap.max_angular", gap.max_angular);
+	gap.heading_gain = this->declare_parameter<double>("gap.heading_gain", gap.heading_gain);
+	gap.smoothing = this->declare_parameter<double>("gap.smoothing", gap.smoothing);
+	gap.prefer_left = this->declare_parameter<bool>("gap.prefer_left", gap.prefer_left);
+	// The speed ramps from stop_distance up to lookahead
+	if (!(gap.lookahead > gap.stop_distance))
+	{
+		GapConfig defaults;
+		RCLCPP_WARN(this->get_logger(), "gap.lookahead (%.2f) must be greater than gap.stop_distance (%.2f), "
+			"using %.2f and %.2f", gap.lookahead, gap.stop_distance, defaults.lookahead, defaults.stop_distance);
+		gap.lookahead = defaults.lookahead;
+		gap.stop_distance = defaults.stop_distance;
+	}
+	if (!(gap.max_angular > 0.0))
+	{
+		RCLCPP_WARN(this->get_logger(), "gap.max_angular must be positive, using %.2f", GapConfig().max_angular);
+		gap.max_angular = GapConfig().max_angular;
+	}
+	pipeline_.gap_planner().configure(gap);
+
+	WallConfig wall;
+	wall.first_angle = this->declare_parameter<double>("wall_pid.first_angle", wall.first_angle * RAD2DEG) * DEG2RAD;
+	wall.last_angle = this->declare_parameter<double>("wall_pid.last_angle", wall.last_angle * RAD2DEG) * DEG2RAD;
+	wall.fit_range = this->declare_parameter<double>("wall_pid.fit_range", wall.fit_range);
+	wall.min_points = this->declare_parameter<int>("wall_pid.min_points", wall.min_points);
+	wall.target = this->declare_parameter<double>("wall_pid.target", wall.target);
+	wall.lookahead = this->declare_parameter<double>("wall_pid.lookahead", wall.lookahead);
+	wall.damping = this->declare_parameter<double>("wall_pid.damping", wall.damping);
+	wall.integral_ratio = this->declare_parameter<double>("wall_pid.integral_ratio", wall.integral_ratio);
+	wall.integral_limit = this->declare_parameter<double>("wall_pid.integral_limit", wall.integral_limit);
+	wall.max_linear = this->declare_parameter<double>("wall_pid.max_linear", wall.max_linear);
+	wall.max_angular = this->declare_parameter<double>("wall_pid.max_angular", wall.max_angular);
+	wall.safety_radius = this->declare_parameter<double>("wall_pid.safety_radius", wall.safety_radius);
+	wall.stop_distance = this->declare_parameter<double>("wall_pid.stop_distance", wall.stop_distance);
+	wall.slow_distance = this->declare_parameter<double>("wall_pid.slow_distance", wall.slow_distance);
+	wall.lost_linear = this->declare_parameter<double>("wall_pid.lost_linear", wall.lost_linear);
+	wall.lost_angular = this->declare_parameter<double>("wall_pid.lost_angular", wall.lost_angular);
+	// The speed ramps from stop_distance up to slow_distance, and the gain
+	// table divides by max_linear and lookahead
+	if (!(wall.slow_distance > wall.stop_distance))
+	{
+		WallConfig defaults;
+		RCLCPP_WARN(this->get_logger(), "wall_pid.slow_distance (%.2f) must be greater than "
+			"wall_pid.stop_distance (%.2f), using %.2f and %.2f", wall.slow_distance, wall.stop_distance,
+			defaults.slow_distance, defaults.stop_distance);
+		wall.slow_distance = defaults.slow_distance;
+		wall.stop_distance = defaults.stop_distance;
+	}
+	if (!(wall.max_linear > 0.0) || !(wall.lookahead > 0.0))
+	{
+		WallConfig defaults;
+		RCLCPP_WARN(this->get_logger(), "wall_pid.max_linear and wall_pid.lookahead must be positive, "
+			"using %.2f and %.2f", defaults.max_linear, defaults.lookahead);
+		wall.max_linear = defaults.max_linear;
+		wall.lookahead = defaults.lookahead;
+	}
+	pipeline_.wall_controller().configure(wall);
 
+	SteeringMode steering_mode;
+	if (!parse_steering_mode(mode, steering_mode))
+	{
+		RCLCPP_WARN(this->get_logger(), "Unknown steering_mode '%s', using 'rules'", mode.c_str());
+		steering_mode = SteeringMode::RULES;
+	}
+	pipeline_.set_steering_mode(steering_mode);
+	RCLCPP_INFO(this->get_logger(), "Steering mode: %s",
+		steering_mode == SteeringMode::RULES ? "rules" : mode.c_str());
+}
+
+// Build the rule table from parameters. The rule order is given by the
+// "rule_names" list and each rule's test and command by rules.<name>.*,
+// defaulting to the original wall following ladder, e.g.
+//   rule_names: [front_blocked, left_front_clear]
+//   rules.front_blocked.sector: FRONT
+//   rules.front_blocked.condition: "<"
+//   rules.front_blocked.threshold: 0.7
+//   rules.front_blocked.linear: 0.0
+//   rules.front_blocked.angular: -1.5
+// The command used when no rule holds is rules.path_clear.linear/angular.
+void WallFollower::load_rules()
+{
+	Rule fallback = RuleTable::default_fallback();
+	std::string fallback_prefix = "rules." + fallback.name + ".";
+	fallback.linear = this->declare_parameter<double>(fallback_prefix + "linear", fallback.linear);
+	fallback.angular = this->declare_parameter<double>(fallback_prefix + "angular", fallback.angular);
+
+	std::vector<Rule> defaults = RuleTable::default_rules();
+	std::vector<std::string> default_names;
+	for (const Rule & rule : defaults)
+		default_names.push_back(rule.name);
+
+	std::vector<std::string> names =
+		this->declare_parameter<std::vector<std::string>>("rule_names", default_names);
+
+	std::vector<Rule> rules;
+	std::set<std::string> loaded;
+	for (const std::string & name : names)
+	{
+		Rule rule = {name, FRONT, RuleCondition::LESS, 0.0, 0.0, 0.0};
+		for (const Rule & d : defaults)
+			if (d.name == name)
+				rule = d;
+
+		// rules.<fallback>.* already holds the fallback's velocities
+		if (name == fallback.name)
+		{
+			RCLCPP_ERROR(this->get_logger(), "Rule name '%s' is reserved for the fallback, rule ignored",
+				name.c_str());
+			continue;
+		}
+		if (!loaded.insert(name).second)
+		{
+			RCLCPP_ERROR(this->get_logger(), "Rule '%s' is listed twice, ignored", name.c_str());
+			continue;
+		}
+		std::string prefix = "rules." + name + ".";
+		std::string sector = this->declare_parameter<std::string>(prefix + "sector", sector_name(rule.sector));
+		std::string condition = this->declare_parameter<std::string>(prefix + "condition",
+			rule.condition == RuleCondition::LESS ? "<" : ">");
+		rule.threshold = this->declare_parameter<double>(prefix + "threshold", rule.threshold);
+		rule.linear = this->declare_parameter<double>(prefix + "linear", rule.linear);
+		rule.angular = this->declare_parameter<double>(prefix + "angular", rule.angular);
+
+		rule.sector = sector_index(sector);
+		if (rule.sector < 0)
+		{
+			RCLCPP_ERROR(this->get_logger(), "Rule '%s': unknown sector '%s', rule ignored",
+				name.c_str(), sector.c_str());
+			continue;
+		}
+		if (condition == "<")
+			rule.condition = RuleCondition::LESS;
+		else if (condition == ">")
+			rule.condition = RuleCondition::GREATER;
+		else
+		{
+			RCLCPP_ERROR(this->get_logger(), "Rule '%s': condition must be '<' or '>', rule ignored",
+				name.c_str());
+			continue;
+		}
+		rules.push_back(rule);
+	}
+
+	pipeline_.rules().set_rules(rules, fallback);
+	for (size_t i = 0; i <= pipeline_.rules().size(); i++)
+		RCLCPP_INFO(this->get_logger(), "%s", pipeline_.rules().description(i).c_str());
+}
+
+
+// Publish a safe stop if the laser stops publishing
+void WallFollower::watchdog_callback()
+{
+	if (scan_timed_out_)
+		return;
+
+	double since_scan = (this->now().nanoseconds() - last_scan_time_) * 1e-9;
+	if (since_scan > scan_timeout_ && !scan_timed_out_.exchange(true))
+	{
+		RCLCPP_WARN(this->get_logger(), "No scan for %.2f s, stopping the robot", scan_timeout_);
+		update_cmd_vel(0.0, 0.0);
+	}
+}
+
+// Log the chosen behaviour only when it differs from the last tick
+void WallFollower::log_branch(int branch, const char * description)
+{
+	if (branch != last_branch_)
+	{
+		RCLCPP_INFO(this->get_logger(), "%s", description);
+		last_branch_ = branch;
+	}
+	else
+		WF_TRACE(this->get_logger(), "%s", description);
+}
 
 void WallFollower::update_callback()
 {
-	if (!new_scan_data_) return;
-	
-	if (near_start) {
-        RCLCPP_INFO(this->get_logger(), "Near start detected, stopping the robot.");
-        update_cmd_vel(0.0, 0.0);
-    }
-    else if (scan_data_[LEFT_FRONT] > 0.9) {
-        RCLCPP_INFO(this->get_logger(), "Left front clear, turning left. Linear: 0.2, Angular: 1.5");
-        update_cmd_vel(0.2, 1.5);
-    }
-    else if (scan_data_[FRONT] < 0.7) {
-        RCLCPP_INFO(this->get_logger(), "Obstacle ahead, turning right. Linear: 0.0, Angular: -1.5");
-        update_cmd_vel(0.0, -1.5);
-    }
-    else if (scan_data_[FRONT_LEFT] < 0.6) {
-        RCLCPP_INFO(this->get_logger(), "Front left obstacle, turning right. Linear: 0.3, Angular: -1.5");
-        update_cmd_vel(0.3, -1.5);
-    }
-    else if (scan_data_[FRONT_RIGHT] < 0.6) {
-        RCLCPP_INFO(this->get_logger(), "Front right obstacle, turning left. Linear: 0.3, Angular: 1.5");
-        update_cmd_vel(0.3, 1.5);
-    }
-    else if (scan_data_[LEFT_FRONT] > 0.6) {
-        RCLCPP_INFO(this->get_logger(), "Left front clear, moving forward with slight left turn. Linear: 0.3, Angular: 1.5");
-        update_cmd_vel(0.3, 1.5);
-    }
-    else {
-        RCLCPP_INFO(this->get_logger(), "Path clear, moving forward. Linear: 0.3, Angular: 0.0");
-        update_cmd_vel(0.3, 0.0);
-    }if (near_start) {
-        RCLCPP_INFO(this->get_logger(), "Near start detected, stopping the robot.");
-        update_cmd_vel(0.0, 0.0);
-    }
-    else if (scan_data_[LEFT_FRONT] > 0.9) {
-        RCLCPP_INFO(this->get_logger(), "Left front clear, turning left. Linear: 0.2, Angular: 1.5");
-        update_cmd_vel(0.2, 1.5);
-    }
-    else if (scan_data_[FRONT] < 0.7) {
-        RCLCPP_INFO(this->get_logger(), "Obstacle ahead, turning right. Linear: 0.0, Angular: -1.5");
-        update_cmd_vel(0.0, -1.5);
-    }
-    else if (scan_data_[FRONT_LEFT] < 0.6) {
-        RCLCPP_INFO(this->get_logger(), "Front left obstacle, turning right. Linear: 0.3, Angular: -1.5");
-        update_cmd_vel(0.3, -1.5);
-    }
-    else if (scan_data_[FRONT_RIGHT] < 0.6) {
-        RCLCPP_INFO(this->get_logger(), "Front right obstacle, turning left. Linear: 0.3, Angular: 1.5");
-        update_cmd_vel(0.3, 1.5);
-    }
-    else if (scan_data_[LEFT_FRONT] > 0.6) {
-        RCLCPP_INFO(this->get_logger(), "Left front clear, moving forward with slight left turn. Linear: 0.3, Angular: 1.5");
-        update_cmd_vel(0.3, 1.5);
-    }
-    else {
-        RCLCPP_INFO(this->get_logger(), "Path clear, moving forward. Linear: 0.3, Angular: 0.0");
-        update_cmd_vel(0.3, 0.0);
-    }
-}
-
-
-
-/*******************************************************************************
-** Main
-*******************************************************************************/
-int main(int argc, char ** argv)
-{
-	rclcpp::init(argc, argv);
-	rclcpp::spin(std::make_shared<WallFollower>());
-	rclcpp::shutdown();
-
-	return 0;
+	// Only act once on each scan, never on stale data
+	ScanState scan = scan_state_.load();
+	if (scan.seq == last_scan_seq_ || scan_timed_out_) return;
+	last_scan_seq_ = scan.seq;
+
+	// In "latest" mode odometry is processed here, once per tick
+	if (odom_latest_)
+	{
+		OdomSample sample = odom_sample_.load();
+		if (sample.seq != last_odom_seq_)
+		{
+			last_odom_seq_ = sample.seq;
+			process_odom(sample);
+		}
+	}
+	OdomState odom = odom_state_.load();
+
+	// One rule fires per tick, so exactly one command is published
+	auto start = std::chrono::steady_clock::now();
+	const double * sectors = scan.sectors;
+	double predicted[NUM_SECTORS];
+	if (motion_compensation_)
+	{
+		double age = (this->now().nanoseconds() - scan.stamp) * 1e-9;
+		predict_sectors(scan.sectors, odom.linear, odom.angular, age, scan.range_max, compensation_horizon_,
+			predicted);
+		sectors = predicted;
+	}
+	Command cmd = pipeline_.decide(sectors, odom.near_start, scan.steered ? &scan.steer : nullptr);
+	if (revisit_policy_ == RevisitPolicy::EXPLORE)
+		explore(odom, sectors, cmd);
+	int64_t decide_ns = elapsed_ns(start);
+	latency_[LATENCY_DECIDE].record(decide_ns);
+
+	if (cmd.rule == NEAR_START_RULE && revisit_policy_ == RevisitPolicy::ANY)
+		log_branch(cmd.rule, "Back on explored ground, stopping the robot.");
+	else if (cmd.rule == NEAR_START_RULE && revisit_policy_ == RevisitPolicy::EXPLORE)
+		log_branch(cmd.rule, "No frontier left to explore, stopping the robot.");
+	else if (cmd.rule == EXPLORE_RULE)
+		log_branch(cmd.rule, "Heading for the nearest frontier.");
+	else if (cmd.rule == NEAR_START_RULE)
+		log_branch(cmd.rule, "Near start detected, stopping the robot.");
+	else if (cmd.rule == STEER_RULE)
+	{
+		log_branch(cmd.rule, "Steering from the full scan.");
+		WF_TRACE(this->get_logger(), "Steering command: linear %f, angular %f", cmd.linear, cmd.angular);
+	}
+	else
+		log_branch(cmd.rule, pipeline_.rules().description(cmd.rule).c_str());
+
+	start = std::chrono::steady_clock::now();
+	update_cmd_vel(cmd.linear, cmd.angular);
+	latency_[LATENCY_PUBLISH].record(elapsed_ns(start));
+	rcl_time_point_value_t now = this->now().nanoseconds();
+	latency_[LATENCY_SCAN_TO_CMD].record(now - scan.stamp);
+	last_tick_time_ = now;
+
+	if (trace_.is_open())
+	{
+		TraceRecord record = {};
+		record.flags = (odom.near_start ? TRACE_NEAR_START : 0) | (odom.revisiting ? TRACE_REVISITING : 0) |
+			(scan.steered ? TRACE_STEERED : 0) | (motion_compensation_ ? TRACE_COMPENSATED : 0) |
+			(exploring_ ? TRACE_EXPLORING : 0);
+		record.scan_stamp = scan.stamp;
+		record.cmd_time = now;
+		for (int i = 0; i < NUM_SECTORS; i++)
+			record.sectors[i] = (float) sectors[i];
+		record.x = (float) odom.x;
+		record.y = (float) odom.y;
+		record.yaw = (float) odom.yaw;
+		record.odom_linear = (float) odom.linear;
+		record.odom_angular = (float) odom.angular;
+		record.linear = (float) cmd.linear;
+		record.angular = (float) cmd.angular;
+		record.rule = cmd.rule;
+		record.decide_ns = (uint32_t) std::min<int64_t>(decide_ns, UINT32_MAX);
+		trace_.write(record);
+	}
+
+	// Timer mode: tick faster near obstacles and at speed, back off when
+	// stopped. Event mode follows the scans and only backs off when stopped
+	// (see scan_callback).
+	if (adaptive_rate_)
+	{
+		bool stopped = cmd.rule == NEAR_START_RULE || (cmd.linear == 0.0 && cmd.angular == 0.0);
+		idle_ = stopped;
+		double speed = std::max(std::fabs(cmd.linear), std::fabs(odom.linear));
+		if (rate_scheduler_.update(sectors[FRONT], speed, stopped) && !event_driven_)
+		{
+			WF_TRACE(this->get_logger(), "Control period %.3f s", rate_scheduler_.period());
+			schedule_update(rate_scheduler_.period());
+		}
+	}
+}
+
+// (Re)create the control timer. The executor holds its own reference to a
+// timer while running it, so this is safe from inside update_callback.
+void WallFollower::schedule_update(double period)
+{
+	std::lock_guard<std::mutex> lock(control_mutex_);
+	if (!active_)
+		return;
+	if (update_timer_)
+		update_timer_->cancel();
+	update_timer_ = this->create_wall_timer(std::chrono::duration<double>(period),
+		std::bind(&WallFollower::update_callback, this), control_group_);
 }
+
+// "explore" revisit policy. On coming back to explored ground, leave the
+// wall and head for the nearest frontier, letting the rules take over while
+// something is close in front. Wall following resumes once the frontier is
+// reached, gone from the map, or not reached in time. With a map and no
+// frontier left, the map is complete and the robot stops.
+void WallFollower::explore(const OdomState & odom, const double * sectors, Command & cmd)
+{
+	ExploreTarget target = explore_target_.load();
+	rcl_time_point_value_t now = this->now().nanoseconds();
+
+	// A frontier can be missing from one map, e.g. while it is all nearer
+	// than explore.min_distance, so only stop once no frontier cell is left
+	// or explore.empty_maps maps in a row had no target. A later map with
+	// a target sends the robot off again.
+	if (explored_ && target.valid)
+	{
+		explored_ = false;
+		explore_armed_ = true;
+		RCLCPP_INFO(this->get_logger(), "New frontier in the map, exploring again");
+	}
+	if (explored_ || (odom.revisiting && target.seq > 0 && !target.valid &&
+		(target.none_left || target.empty_maps >= (uint32_t) explore_empty_maps_)))
+	{
+		explored_ = true;
+		cmd.linear = 0.0;
+		cmd.angular = 0.0;
+		cmd.rule = NEAR_START_RULE;
+		return;
+	}
+
+	if (!odom.revisiting)
+		explore_armed_ = true;
+	if (!exploring_)
+	{
+		if (!odom.revisiting || !explore_armed_ || !target.valid)
+			return;
+		exploring_ = true;
+		explore_armed_ = false;
+		explore_since_ = now;
+		RCLCPP_INFO(this->get_logger(), "On explored ground, heading for the frontier at (x: %f, y: %f)",
+			target.x, target.y);
+	}
+
+	double dx = target.x - odom.x, dy = target.y - odom.y;
+	if (!target.valid || std::hypot(dx, dy) < explore_reach_)
+	{
+		exploring_ = false;
+		RCLCPP_INFO(this->get_logger(), "Frontier reached or mapped, following the wall");
+		return;
+	}
+	if ((now - explore_since_) * 1e-9 > explore_timeout_)
+	{
+		exploring_ = false;
+		RCLCPP_WARN(this->get_logger(), "Frontier not reached in %.0f s, following the wall", explore_timeout_);
+		return;
+	}
+	if (sectors[FRONT] < explore_clearance_)
+		return;
+
+	double bearing = std::remainder(std::atan2(dy, dx) - odom.yaw, 2.0 * M_PI);
+	cmd.angular = std::max(-ANGULAR_VELOCITY, std::min(ANGULAR_VELOCITY, explore_heading_gain_ * bearing));
+	cmd.linear = LINEAR_VELOCITY * std::max(0.0, std::cos(bearing));
+	cmd.rule = EXPLORE_RULE;
+}
+
+// Publish p50/p99/max of each pipeline stage over the last period. The
+// end-to-end stage is reported as a warning when its p99 is over budget.
+void WallFollower::diagnostics_callback()
+{
+	static const char * const stage_names[NUM_LATENCY_STAGES] = {
+		"transport", "reduce", "decide", "publish", "scan_to_cmd"
+	};
+
+	auto diagnostics = std::make_unique<diagnostic_msgs::msg::DiagnosticArray>();
+	diagnostics->header.stamp = this->now();
+
+	for (int i = 0; i < NUM_LATENCY_STAGES; i++)
+	{
+		LatencySummary summary = latency_[i].take();
+
+		diagnostic_msgs::msg::DiagnosticStatus status;
+		status.name = std::string(this->get_name()) + ": latency " + stage_names[i];
+		status.hardware_id = this->get_fully_qualified_name();
+		status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+		if (i == LATENCY_SCAN_TO_CMD && summary.p99 * 1e-9 > latency_warn_)
+			status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+
+		char message[128];
+		snprintf(message, sizeof(message), "p50 %.3f ms, p99 %.3f ms, max %.3f ms (%lu samples)",
+			summary.p50 * 1e-6, summary.p99 * 1e-6, summary.max * 1e-6, (unsigned long) summary.count);
+		status.message = message;
+
+		const char * keys[4] = {"count", "p50_ms", "p99_ms", "max_ms"};
+		double values[4] = {(double) summary.count, summary.p50 * 1e-6, summary.p99 * 1e-6, summary.max * 1e-6};
+		for (int k = 0; k < 4; k++)
+		{
+			diagnostic_msgs::msg::KeyValue kv;
+			kv.key = keys[k];
+			kv.value = k == 0 ? std::to_string(summary.count) : std::to_string(values[k]);
+			status.values.push_back(kv);
+		}
+		diagnostics->status.push_back(status);
+	}
+
+	diagnostics_pub_->publish(std::move(diagnostics));
+}
+
+RCLCPP_COMPONENTS_REGISTER_NODE(WallFollower)
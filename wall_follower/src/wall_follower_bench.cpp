@@ -0,0 +1,301 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Offline benchmark for the scan -> command pipeline.
+// Replays the scan and odometry topics of a rosbag2 recording through
+// ControlPipeline as fast as possible, without spinning a node, and reports
+// throughput, per-stage latency and a checksum of the command trace. The
+// checksum only changes when the behaviour does, so it can be compared
+// between runs of different builds.
+//
+// Usage: wall_follower_bench <bag> [--repeat N] [--percentile Q]
+//                              [--beam-width DEG] [--steering MODE]
+//                              [--median-depth N] [--spike-threshold M]
+//                              [--scan-topic T] [--odom-topic T]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nav_msgs/msg/odometry.hpp>
+#include <rclcpp/serialization.hpp>
+#include <rclcpp/serialized_message.hpp>
+#include <rosbag2_cpp/converter_options.hpp>
+#include <rosbag2_cpp/readers/sequential_reader.hpp>
+#include <rosbag2_cpp/storage_options.hpp>
+#include <sensor_msgs/msg/laser_scan.hpp>
+
+#include "wall_follower/control_pipeline.hpp"
+#include "wall_follower/latency_histogram.hpp"
+
+
+// One recorded message, decoded up front so that replay does no I/O
+struct Event
+{
+	bool is_scan;
+	size_t index;	// into scans or odoms
+};
+
+struct Recording
+{
+	std::vector<sensor_msgs::msg::LaserScan> scans;
+	std::vector<nav_msgs::msg::Odometry> odoms;
+	std::vector<Event> events;		// in recorded order
+};
+
+static bool load_bag(const std::string & uri, const std::string & scan_topic, const std::string & odom_topic,
+	Recording & recording)
+{
+	rosbag2_cpp::StorageOptions storage_options;
+	storage_options.uri = uri;
+	storage_options.storage_id = "sqlite3";
+
+	rosbag2_cpp::ConverterOptions converter_options;
+	converter_options.input_serialization_format = "cdr";
+	converter_options.output_serialization_format = "cdr";
+
+	rosbag2_cpp::readers::SequentialReader reader;
+	try
+	{
+		reader.open(storage_options, converter_options);
+	}
+	catch (const std::exception & e)
+	{
+		fprintf(stderr, "Cannot open bag '%s': %s\n", uri.c_str(), e.what());
+		return false;
+	}
+
+	rclcpp::Serialization<sensor_msgs::msg::LaserScan> scan_serialization;
+	rclcpp::Serialization<nav_msgs::msg::Odometry> odom_serialization;
+
+	while (reader.has_next())
+	{
+		auto bag_message = reader.read_next();
+		rclcpp::SerializedMessage serialized(*bag_message->serialized_data);
+
+		Event event;
+		if (bag_message->topic_name == scan_topic)
+		{
+			recording.scans.emplace_back();
+			scan_serialization.deserialize_message(&serialized, &recording.scans.back());
+			event.is_scan = true;
+			event.index = recording.scans.size() - 1;
+		}
+		else if (bag_message->topic_name == odom_topic)
+		{
+			recording.odoms.emplace_back();
+			odom_serialization.deserialize_message(&serialized, &recording.odoms.back());
+			event.is_scan = false;
+			event.index = recording.odoms.size() - 1;
+		}
+		else
+			continue;
+		recording.events.push_back(event);
+	}
+	return true;
+}
+
+// FNV-1a, folded over each command so that any change in the rule fired or
+// the velocities sent changes the result
+static void hash_bytes(uint64_t & hash, const void * data, size_t size)
+{
+	const unsigned char * p = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= p[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+static int64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+struct RunResult
+{
+	uint64_t commands;
+	uint64_t checksum;
+	int64_t total_ns;
+};
+
+static RunResult replay(const Recording & recording, double percentile, double beam_width,
+	SteeringMode steering_mode, const ScanFilterConfig & scan_filter, LatencyHistogram & reduce_latency,
+	LatencyHistogram & decide_latency)
+{
+	ControlPipeline pipeline;
+	pipeline.set_beam_width(beam_width * DEG2RAD);
+	pipeline.set_percentile(percentile);
+	pipeline.set_steering_mode(steering_mode);
+	pipeline.scan_filter().configure(scan_filter);
+	StartDetector start_detector;
+
+	RunResult result = {0, 14695981039346656037ull, 0};
+	double sectors[NUM_SECTORS];
+
+	auto run_start = std::chrono::steady_clock::now();
+	for (const Event & event : recording.events)
+	{
+		if (!event.is_scan)
+		{
+			const nav_msgs::msg::Odometry & odom = recording.odoms[event.index];
+			start_detector.update(odom.pose.pose.position.x, odom.pose.pose.position.y);
+			continue;
+		}
+
+		const sensor_msgs::msg::LaserScan & scan = recording.scans[event.index];
+		ScanGeometry geometry;
+		geometry.angle_min = scan.angle_min;
+		geometry.angle_increment = scan.angle_increment;
+		geometry.num_ranges = scan.ranges.size();
+
+		auto start = std::chrono::steady_clock::now();
+		const float * ranges = pipeline.filter(geometry, scan.ranges.data(), scan.range_min, scan.range_max);
+		bool usable = pipeline.reduce(geometry, ranges, scan.range_min, scan.range_max, sectors);
+		Command steer;
+		bool steered = usable &&
+			pipeline.steer(geometry, ranges, scan.range_min, scan.range_max,
+				scan.header.stamp.sec + scan.header.stamp.nanosec * 1e-9, steer);
+		reduce_latency.record(elapsed_ns(start));
+		if (!usable)
+			continue;
+
+		start = std::chrono::steady_clock::now();
+		Command cmd = pipeline.decide(sectors, start_detector.near_start(), steered ? &steer : nullptr);
+		decide_latency.record(elapsed_ns(start));
+
+		hash_bytes(result.checksum, &cmd.rule, sizeof(cmd.rule));
+		hash_bytes(result.checksum, &cmd.linear, sizeof(cmd.linear));
+		hash_bytes(result.checksum, &cmd.angular, sizeof(cmd.angular));
+		result.commands++;
+	}
+	result.total_ns = elapsed_ns(run_start);
+	return result;
+}
+
+static void print_latency(const char * stage, LatencySummary s)
+{
+	printf("  %-8s p50 %8.3f us  p99 %8.3f us  max %8.3f us  (%lu samples)\n",
+		stage, s.p50 * 1e-3, s.p99 * 1e-3, s.max * 1e-3, (unsigned long) s.count);
+}
+
+static void usage(const char * prog)
+{
+	fprintf(stderr,
+		"Usage: %s <bag> [--repeat N] [--percentile Q] [--beam-width DEG]\n"
+		"          [--steering rules|gap|wall_pid] [--median-depth N] [--spike-threshold M]\n"
+		"          [--scan-topic TOPIC] [--odom-topic TOPIC]\n", prog);
+}
+
+
+/*******************************************************************************
+** Main
+*******************************************************************************/
+int main(int argc, char ** argv)
+{
+	std::string uri;
+	std::string scan_topic = "/scan";
+	std::string odom_topic = "/odom";
+	int repeat = 10;
+	double percentile = 0.0;
+	double beam_width = BEAM_WIDTH;
+	SteeringMode steering_mode = SteeringMode::RULES;
+	ScanFilterConfig scan_filter;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool has_value = i + 1 < argc;
+		if (!strcmp(argv[i], "--repeat") && has_value)
+			repeat = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--percentile") && has_value)
+			percentile = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--beam-width") && has_value)
+			beam_width = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--steering") && has_value)
+		{
+			if (!parse_steering_mode(argv[++i], steering_mode))
+			{
+				usage(argv[0]);
+				return 2;
+			}
+		}
+		else if (!strcmp(argv[i], "--median-depth") && has_value)
+			scan_filter.depth = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--spike-threshold") && has_value)
+			scan_filter.spike_threshold = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--scan-topic") && has_value)
+			scan_topic = argv[++i];
+		else if (!strcmp(argv[i], "--odom-topic") && has_value)
+			odom_topic = argv[++i];
+		else if (argv[i][0] != '-' && uri.empty())
+			uri = argv[i];
+		else
+		{
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (uri.empty() || repeat < 1)
+	{
+		usage(argv[0]);
+		return 2;
+	}
+
+	Recording recording;
+	if (!load_bag(uri, scan_topic, odom_topic, recording))
+		return 1;
+	printf("Loaded %zu scans and %zu odometry messages from %s\n",
+		recording.scans.size(), recording.odoms.size(), uri.c_str());
+	if (recording.scans.empty())
+	{
+		fprintf(stderr, "No scans on %s\n", scan_topic.c_str());
+		return 1;
+	}
+
+	LatencyHistogram reduce_latency;
+	LatencyHistogram decide_latency;
+	uint64_t checksum = 0;
+	int64_t best_ns = 0;
+	int status = 0;
+
+	for (int run = 0; run < repeat; run++)
+	{
+		RunResult result = replay(recording, percentile, beam_width, steering_mode, scan_filter, reduce_latency,
+			decide_latency);
+		if (run == 0)
+			checksum = result.checksum;
+		else if (result.checksum != checksum)
+		{
+			fprintf(stderr, "Run %d: command trace checksum %016llx differs from %016llx\n",
+				run, (unsigned long long) result.checksum, (unsigned long long) checksum);
+			status = 1;
+		}
+		if (run == 0 || result.total_ns < best_ns)
+			best_ns = result.total_ns;
+	}
+
+	double scans_per_run = (double) recording.scans.size();
+	printf("Runs:        %d\n", repeat);
+	printf("Throughput:  %.0f scans/s (best run %.3f ms)\n",
+		scans_per_run / (best_ns * 1e-9), best_ns * 1e-6);
+	printf("Latency:\n");
+	print_latency("reduce", reduce_latency.take());
+	print_latency("decide", decide_latency.take());
+	printf("Checksum:    %016llx\n", (unsigned long long) checksum);
+
+	return status;
+}
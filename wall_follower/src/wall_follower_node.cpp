@@ -0,0 +1,45 @@
+// Copyright 2019 ROBOTIS CO., LTD.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Standalone executable for the WallFollower component
+
+#include "wall_follower/wall_follower.hpp"
+
+#include <memory>
+
+
+/*******************************************************************************
+** Main
+*******************************************************************************/
+int main(int argc, char ** argv)
+{
+	rclcpp::init(argc, argv);
+	auto node = std::make_shared<WallFollower>();
+
+	// With more than one thread the scan, odometry and control callback
+	// groups run concurrently
+	int64_t threads = node->get_parameter("executor_threads").as_int();
+	if (threads > 1)
+	{
+		rclcpp::executors::MultiThreadedExecutor executor(rclcpp::ExecutorOptions(), threads);
+		executor.add_node(node->get_node_base_interface());
+		executor.spin();
+	}
+	else
+		rclcpp::spin(node->get_node_base_interface());
+
+	rclcpp::shutdown();
+
+	return 0;
+}
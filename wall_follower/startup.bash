@@ -1,6 +1,13 @@
+# Start each stage once the one before it is publishing, rather than after
+# a fixed delay. The wall follower itself waits for its first scan and
+# odometry before driving (autostart).
+wait_for_topic() {
+	until ros2 topic info "$1" 2>/dev/null | grep -q 'Publisher count: [1-9]'; do
+		sleep 0.5
+	done
+}
+
 ros2 launch turtlebot3_gazebo turtlebot3_maze.launch.py &
-sleep 10
+wait_for_topic /scan
 ros2 launch turtlebot3_cartographer cartographer.launch.py use_sim_time:=True &
-sleep 10
-ros2 launch wall_follower wall_follower.launch.py
-
+ros2 launch wall_follower wall_follower.launch.py use_sim_time:=True
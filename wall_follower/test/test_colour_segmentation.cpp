@@ -0,0 +1,205 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "wall_follower/colour_segmentation.hpp"
+#include "wall_follower/marker_types.hpp"
+
+
+// BGR values well inside each colour's hue range
+static const cv::Vec3b pink(200, 0, 200);
+static const cv::Vec3b blue(255, 0, 0);
+static const cv::Vec3b green(0, 200, 0);
+static const cv::Vec3b yellow(0, 255, 255);
+static const cv::Vec3b grey(128, 128, 128);
+
+static void fill(cv::Mat & image, int left, int top, int right, int bottom, const cv::Vec3b & colour)
+{
+	for (int y = top; y <= bottom; y++)
+		for (int x = left; x <= right; x++)
+			image.at<cv::Vec3b>(y, x) = colour;
+}
+
+static uint8_t label_of(const ColourClassifier & classifier, const cv::Vec3b & p)
+{
+	return classifier.label(p[0], p[1], p[2]);
+}
+
+TEST(ColourClassifier, LabelsMarkerColours)
+{
+	ColourClassifier classifier;
+	EXPECT_EQ(label_of(classifier, pink), PINK + 1);
+	EXPECT_EQ(label_of(classifier, blue), BLUE + 1);
+	EXPECT_EQ(label_of(classifier, green), GREEN + 1);
+	EXPECT_EQ(label_of(classifier, yellow), YELLOW + 1);
+	EXPECT_EQ(label_of(classifier, grey), NO_COLOUR);
+	EXPECT_EQ(label_of(classifier, cv::Vec3b(0, 0, 0)), NO_COLOUR);
+}
+
+TEST(ColourClassifier, UsesTheGivenRanges)
+{
+	// Only green, as colour 0
+	const HsvRange ranges[1] = {{{40, 0, 0}, {80, 255, 255}}};
+	ColourClassifier classifier(ranges, 1);
+	EXPECT_EQ(label_of(classifier, green), 1);
+	EXPECT_EQ(label_of(classifier, blue), NO_COLOUR);
+	EXPECT_EQ(label_of(classifier, pink), NO_COLOUR);
+}
+
+TEST(ColourClassifier, ClassifiesImages)
+{
+	ColourClassifier classifier;
+	cv::Mat image(6, 9, CV_8UC3, cv::Scalar(128, 128, 128));
+	fill(image, 0, 0, 2, 2, pink);
+	fill(image, 4, 1, 8, 3, blue);
+	fill(image, 1, 4, 6, 5, yellow);
+
+	cv::Mat labels;
+	classifier.classify(image, labels);
+	ASSERT_EQ(labels.rows, 6);
+	ASSERT_EQ(labels.cols, 9);
+	for (int y = 0; y < image.rows; y++)
+		for (int x = 0; x < image.cols; x++)
+			EXPECT_EQ(labels.at<uint8_t>(y, x), label_of(classifier, image.at<cv::Vec3b>(y, x)))
+				<< "pixel " << x << ", " << y;
+
+	// Every second pixel of every second row
+	cv::Mat coarse;
+	classifier.classify(image, coarse, 2);
+	ASSERT_EQ(coarse.rows, 3);
+	ASSERT_EQ(coarse.cols, 5);
+	for (int y = 0; y < coarse.rows; y++)
+		for (int x = 0; x < coarse.cols; x++)
+			EXPECT_EQ(coarse.at<uint8_t>(y, x), labels.at<uint8_t>(2 * y, 2 * x)) << "pixel " << x << ", " << y;
+}
+
+
+/********************************************************************************
+** ComponentLabeller
+********************************************************************************/
+
+static std::vector<Component> label_rows(const std::vector<const char *> & rows, int offset_x = 0,
+	int offset_y = 0)
+{
+	// Digits are labels, anything else is NO_COLOUR
+	const int cols = (int) std::strlen(rows[0]);
+	std::vector<uint8_t> labels;
+	for (const char * row : rows)
+		for (int x = 0; x < cols; x++)
+			labels.push_back(row[x] >= '1' && row[x] <= '9' ? (uint8_t) (row[x] - '0') : NO_COLOUR);
+
+	ComponentLabeller labeller;
+	std::vector<Component> components;
+	labeller.label(labels.data(), (int) rows.size(), cols, cols, components, offset_x, offset_y);
+	std::sort(components.begin(), components.end(), [](const Component & a, const Component & b)
+	{
+		return a.top != b.top ? a.top < b.top : a.left < b.left;
+	});
+	return components;
+}
+
+TEST(ComponentLabeller, SeparatesLabelsAndRegions)
+{
+	std::vector<Component> components = label_rows({
+		"11..22",
+		"11..22",
+		"..1.22",
+		"...111",
+	});
+	ASSERT_EQ(components.size(), 4u);
+
+	// Diagonal neighbours are not connected
+	EXPECT_EQ(components[0].colour, 0);
+	EXPECT_EQ(components[0].area, 4);
+	EXPECT_EQ(components[0].width(), 2);
+	EXPECT_EQ(components[0].height(), 2);
+	EXPECT_DOUBLE_EQ(components[0].cx(), 0.5);
+	EXPECT_DOUBLE_EQ(components[0].cy(), 0.5);
+
+	// Touching regions of different labels stay apart
+	EXPECT_EQ(components[1].colour, 1);
+	EXPECT_EQ(components[1].area, 6);
+	EXPECT_EQ(components[1].left, 4);
+	EXPECT_EQ(components[1].bottom, 2);
+
+	EXPECT_EQ(components[2].colour, 0);
+	EXPECT_EQ(components[2].area, 1);
+	EXPECT_EQ(components[2].left, 2);
+	EXPECT_EQ(components[2].top, 2);
+
+	EXPECT_EQ(components[3].colour, 0);
+	EXPECT_EQ(components[3].area, 3);
+	EXPECT_EQ(components[3].left, 3);
+	EXPECT_EQ(components[3].right, 5);
+}
+
+TEST(ComponentLabeller, MergesRegionsThatJoinLater)
+{
+	// Two arms that only meet on the last row, and a spiral
+	std::vector<Component> components = label_rows({
+		"1.1.3333",
+		"1.1.3..3",
+		"1.1.3.33",
+		"111.3...",
+	});
+	ASSERT_EQ(components.size(), 2u);
+	EXPECT_EQ(components[0].colour, 0);
+	EXPECT_EQ(components[0].area, 9);
+	EXPECT_EQ(components[0].left, 0);
+	EXPECT_EQ(components[0].right, 2);
+	EXPECT_EQ(components[0].bottom, 3);
+	EXPECT_EQ(components[1].colour, 2);
+	EXPECT_EQ(components[1].area, 10);
+	EXPECT_EQ(components[1].right, 7);
+}
+
+TEST(ComponentLabeller, AddsOffsets)
+{
+	std::vector<Component> components = label_rows({
+		"....",
+		".44.",
+	}, 100, 50);
+	ASSERT_EQ(components.size(), 1u);
+	EXPECT_EQ(components[0].left, 101);
+	EXPECT_EQ(components[0].right, 102);
+	EXPECT_EQ(components[0].top, 51);
+	EXPECT_EQ(components[0].bottom, 51);
+	EXPECT_DOUBLE_EQ(components[0].cx(), 101.5);
+	EXPECT_DOUBLE_EQ(components[0].cy(), 51.0);
+}
+
+TEST(ComponentLabeller, LabelsMatImages)
+{
+	ColourClassifier classifier;
+	cv::Mat image(20, 30, CV_8UC3, cv::Scalar(128, 128, 128));
+	fill(image, 5, 2, 14, 8, yellow);
+	fill(image, 5, 9, 14, 17, pink);
+
+	cv::Mat labels;
+	classifier.classify(image, labels);
+	ComponentLabeller labeller;
+	std::vector<Component> components;
+	labeller.label(labels, components);
+	ASSERT_EQ(components.size(), 2u);
+	EXPECT_EQ(components[0].colour, YELLOW);
+	EXPECT_EQ(components[0].area, 10 * 7);
+	EXPECT_EQ(components[1].colour, PINK);
+	EXPECT_EQ(components[1].area, 10 * 9);
+	EXPECT_EQ(components[1].top, 9);
+}
@@ -0,0 +1,232 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "wall_follower/frontier_map.hpp"
+
+
+#define RESOLUTION	0.05
+
+// Free cells next to an unknown one, the slow way
+static size_t count_frontier(const std::vector<int8_t> & grid, int w, int h)
+{
+	size_t n = 0;
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			int8_t v = grid[y * w + x];
+			if (!(v >= 0 && v < FRONTIER_FREE))
+				continue;
+			n += (x > 0 && grid[y * w + x - 1] < 0) || (x + 1 < w && grid[y * w + x + 1] < 0) ||
+				(y > 0 && grid[(y - 1) * w + x] < 0) || (y + 1 < h && grid[(y + 1) * w + x] < 0);
+		}
+	}
+	return n;
+}
+
+static GridInfo grid_info(int w, int h, double origin_x = 0.0, double origin_y = 0.0)
+{
+	GridInfo info;
+	info.width = w;
+	info.height = h;
+	info.resolution = RESOLUTION;
+	info.origin_x = origin_x;
+	info.origin_y = origin_y;
+	return info;
+}
+
+// A world of unknown cells that the map is a window onto, revealed in discs
+class World
+{
+public:
+	World(int w, int h) : w_(w), h_(h), cells_(w * h, -1) {}
+
+	void reveal(int cx, int cy, int r, std::mt19937 & rng)
+	{
+		for (int y = std::max(0, cy - r); y <= std::min(h_ - 1, cy + r); y++)
+			for (int x = std::max(0, cx - r); x <= std::min(w_ - 1, cx + r); x++)
+				if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r)
+					cells_[y * w_ + x] = rng() % 10 == 0 ? 100 : 0;
+	}
+
+	std::vector<int8_t> window(int x0, int y0, int w, int h) const
+	{
+		std::vector<int8_t> map(w * h);
+		for (int y = 0; y < h; y++)
+			for (int x = 0; x < w; x++)
+				map[y * w + x] = cells_[(y0 + y) * w_ + x0 + x];
+		return map;
+	}
+
+private:
+	int w_, h_;
+	std::vector<int8_t> cells_;
+};
+
+TEST(FrontierMap, CountsFrontierCells)
+{
+	// A free room with a door onto unknown space, and an unknown pocket
+	const int w = 100, h = 80;
+	std::vector<int8_t> grid(w * h, -1);
+	for (int y = 10; y < 70; y++)
+		for (int x = 10; x < 90; x++)
+			grid[y * w + x] = (x == 10 || x == 89 || y == 10 || y == 69) ? 100 : 0;
+	for (int y = 30; y < 40; y++)
+		grid[y * w + 89] = 0;
+	for (int y = 50; y < 55; y++)
+		for (int x = 40; x < 45; x++)
+			grid[y * w + x] = -1;
+
+	FrontierMap map;
+	EXPECT_TRUE(map.empty());
+	size_t scanned = map.update(grid_info(w, h), grid.data());
+	EXPECT_EQ(scanned, map.size());
+	EXPECT_EQ(map.size(), 4u * 3u);
+	EXPECT_EQ(map.frontier_cells(), count_frontier(grid, w, h));
+	EXPECT_EQ(map.frontier_cells(), 10u + 20u);
+
+	size_t total = 0;
+	for (size_t i = 0; i < map.size(); i++)
+		total += map.tile(i).cells;
+	EXPECT_EQ(total, map.frontier_cells());
+}
+
+TEST(FrontierMap, NearestTarget)
+{
+	const int w = 128, h = 64;
+	std::vector<int8_t> grid(w * h, 0);
+	// An unknown strip at each end
+	for (int y = 0; y < h; y++)
+	{
+		grid[y * w + 0] = -1;
+		grid[y * w + w - 1] = -1;
+	}
+	FrontierMap map;
+	map.update(grid_info(w, h), grid.data());
+
+	double tx, ty;
+	ASSERT_TRUE(map.nearest(1.0, 1.6, 0.0, tx, ty));
+	EXPECT_LT(tx, 1.6);
+	ASSERT_TRUE(map.nearest(5.0, 1.6, 0.0, tx, ty));
+	EXPECT_GT(tx, 4.8);
+
+	// Too close to count, then nothing with enough cells
+	ASSERT_TRUE(map.nearest(0.05, 0.8, 2.0, tx, ty));
+	EXPECT_GT(tx, 4.8);
+	EXPECT_FALSE(map.nearest(1.0, 1.6, 0.0, tx, ty, FRONTIER_TILE + 1));
+	EXPECT_FALSE(map.nearest(1.0, 1.6, 100.0, tx, ty));
+}
+
+TEST(FrontierMap, NoFrontierInUnknownOrKnownMaps)
+{
+	FrontierMap map;
+	std::vector<int8_t> unknown(64 * 64, -1), known(64 * 64, 0);
+	double tx, ty;
+	map.update(grid_info(64, 64), unknown.data());
+	EXPECT_EQ(map.frontier_cells(), 0u);
+	EXPECT_FALSE(map.nearest(0.0, 0.0, 0.0, tx, ty));
+	map.update(grid_info(64, 64), known.data());
+	EXPECT_EQ(map.frontier_cells(), 0u);
+	EXPECT_FALSE(map.nearest(0.0, 0.0, 0.0, tx, ty));
+}
+
+TEST(FrontierMap, RescansOnlyChangedTiles)
+{
+	std::mt19937 rng(1);
+	World world(160, 160);
+	world.reveal(80, 80, 40, rng);
+	FrontierMap map;
+	std::vector<int8_t> grid = world.window(0, 0, 160, 160);
+	map.update(grid_info(160, 160), grid.data());
+
+	EXPECT_EQ(map.update(grid_info(160, 160), grid.data()), 0u);
+
+	// A changed cell re-examines its tile and the neighbours, 9 of the 25
+	// tiles, or 4 in the corner of the map
+	grid[40 * 160 + 40] = grid[40 * 160 + 40] ? 0 : 100;
+	EXPECT_EQ(map.update(grid_info(160, 160), grid.data()), 9u);
+	grid[5 * 160 + 5] = 0;
+	EXPECT_EQ(map.update(grid_info(160, 160), grid.data()), 4u);
+	EXPECT_EQ(map.frontier_cells(), count_frontier(grid, 160, 160));
+}
+
+TEST(FrontierMap, KeepsTilesAsTheMapGrows)
+{
+	std::mt19937 rng(3);
+	World world(600, 500);
+	int x0 = 250, y0 = 200, w = 80, h = 70;
+	const double world_x = -12.5, world_y = -10.0;
+
+	FrontierMap map;
+	for (int step = 0; step < 60; step++)
+	{
+		world.reveal(x0 + rng() % w, y0 + rng() % h, 3 + rng() % 12, rng);
+		if (rng() % 3 == 0)
+		{
+			int grow = rng() % 20;
+			x0 -= grow;
+			w += grow + rng() % 15;
+		}
+		if (rng() % 3 == 0)
+		{
+			int grow = rng() % 20;
+			y0 -= grow;
+			h += grow + rng() % 15;
+		}
+		std::vector<int8_t> grid = world.window(x0, y0, w, h);
+		GridInfo info = grid_info(w, h, world_x + x0 * RESOLUTION, world_y + y0 * RESOLUTION);
+		map.update(info, grid.data());
+		ASSERT_EQ(map.frontier_cells(), count_frontier(grid, w, h)) << "step " << step;
+
+		// A map that only ever saw this grid, on the same tiling
+		FrontierMap fresh;
+		std::vector<int8_t> blank(80 * 70, -1);
+		fresh.update(grid_info(80, 70, world_x + 250 * RESOLUTION, world_y + 200 * RESOLUTION), blank.data());
+		fresh.update(info, grid.data());
+		ASSERT_EQ(fresh.size(), map.size()) << "step " << step;
+		for (size_t i = 0; i < map.size(); i++)
+		{
+			ASSERT_EQ(map.tile(i).cells, fresh.tile(i).cells) << "step " << step << ", tile " << i;
+			if (map.tile(i).cells)
+			{
+				EXPECT_NEAR(map.tile(i).x, fresh.tile(i).x, 1e-9);
+				EXPECT_NEAR(map.tile(i).y, fresh.tile(i).y, 1e-9);
+			}
+		}
+	}
+}
+
+TEST(FrontierMap, StartsAgainOnFractionalShift)
+{
+	std::mt19937 rng(2);
+	World world(100, 100);
+	world.reveal(50, 50, 30, rng);
+	std::vector<int8_t> grid = world.window(0, 0, 100, 100);
+	FrontierMap map;
+	map.update(grid_info(100, 100), grid.data());
+
+	GridInfo shifted = grid_info(100, 100, 0.01, 0.0);
+	EXPECT_EQ(map.update(shifted, grid.data()), map.size());
+	EXPECT_EQ(map.frontier_cells(), count_frontier(grid, 100, 100));
+
+	GridInfo finer = shifted;
+	finer.resolution = 0.025;
+	EXPECT_EQ(map.update(finer, grid.data()), map.size());
+	EXPECT_EQ(map.frontier_cells(), count_frontier(grid, 100, 100));
+}
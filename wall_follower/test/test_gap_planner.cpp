@@ -0,0 +1,143 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "wall_follower/gap_planner.hpp"
+
+#include "test_helpers.hpp"
+
+
+// Set the beams from first to last degrees (inclusive, -180 .. 180)
+static void set_beams(std::vector<float> & ranges, int first, int last, float r)
+{
+	for (int a = first; a <= last; a++)
+		ranges[(a + 360) % 360] = r;
+}
+
+static GapPlanner make_planner(bool prefer_left, double safety_radius = 0.2)
+{
+	GapConfig config;
+	config.prefer_left = prefer_left;
+	config.safety_radius = safety_radius;
+	config.smoothing = 0.0;
+	GapPlanner planner;
+	planner.configure(config);
+	return planner;
+}
+
+TEST(GapPlanner, OpenSpaceFullSpeedAhead)
+{
+	GapPlanner planner = make_planner(true);
+	std::vector<float> ranges(360, std::numeric_limits<float>::infinity());
+	double linear, angular;
+	ASSERT_TRUE(planner.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, linear, angular));
+	EXPECT_GT(linear, 0.9 * planner.config().max_linear);
+	EXPECT_LE(linear, planner.config().max_linear);
+	EXPECT_LT(std::fabs(angular), 0.1);
+}
+
+TEST(GapPlanner, BoxedInTurnsAwayFromTheWall)
+{
+	std::vector<float> ranges(360, 0.2f);
+	double linear, angular;
+
+	GapPlanner left = make_planner(true);
+	ASSERT_TRUE(left.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, linear, angular));
+	EXPECT_EQ(linear, 0.0);
+	EXPECT_DOUBLE_EQ(angular, -left.config().max_angular);
+
+	GapPlanner right = make_planner(false);
+	ASSERT_TRUE(right.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, linear, angular));
+	EXPECT_EQ(linear, 0.0);
+	EXPECT_DOUBLE_EQ(angular, right.config().max_angular);
+}
+
+TEST(GapPlanner, SteersIntoTheGap)
+{
+	GapPlanner planner = make_planner(true);
+	std::vector<float> ranges(360, 0.4f);
+	set_beams(ranges, 30, 100, 3.0f);
+	double linear, angular;
+	ASSERT_TRUE(planner.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, linear, angular));
+	EXPECT_GT(angular, 0.0);
+}
+
+TEST(GapPlanner, NarrowGapIsNotPassable)
+{
+	GapPlanner planner = make_planner(true);
+	std::vector<float> ranges(360, 0.4f);
+	// 20 degrees at the 0.45 m clearance is 0.16 m, less than the robot
+	set_beams(ranges, 40, 60, 3.0f);
+	double linear, angular;
+	ASSERT_TRUE(planner.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, linear, angular));
+	EXPECT_EQ(linear, 0.0);
+	EXPECT_DOUBLE_EQ(angular, -planner.config().max_angular);
+}
+
+TEST(GapPlanner, PreferLeftOrWidest)
+{
+	// A narrow gap on the left and a wide one on the right
+	std::vector<float> ranges(360, 0.4f);
+	set_beams(ranges, 30, 70, 3.0f);
+	set_beams(ranges, -70, 0, 3.0f);
+	double linear, angular;
+
+	GapPlanner left = make_planner(true, 0.1);
+	ASSERT_TRUE(left.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, linear, angular));
+	EXPECT_GT(angular, 0.0);
+
+	GapPlanner widest = make_planner(false, 0.1);
+	ASSERT_TRUE(widest.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, linear, angular));
+	EXPECT_LT(angular, 0.0);
+}
+
+TEST(GapPlanner, SlowsWithLessRoomAhead)
+{
+	GapPlanner planner = make_planner(true);
+	std::vector<float> ranges(360, std::numeric_limits<float>::infinity());
+	double far_linear, near_linear, angular;
+
+	set_beams(ranges, -5, 5, 1.5f);
+	ASSERT_TRUE(planner.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, far_linear, angular));
+	set_beams(ranges, -5, 5, 0.6f);
+	ASSERT_TRUE(planner.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, near_linear, angular));
+	EXPECT_GT(far_linear, near_linear);
+	EXPECT_GE(near_linear, 0.0);
+}
+
+TEST(GapPlanner, SmoothsTheTurnRate)
+{
+	GapConfig config;
+	config.smoothing = 0.5;
+	GapPlanner planner;
+	planner.configure(config);
+	std::vector<float> ranges(360, 0.2f);
+	double linear, first, second;
+	ASSERT_TRUE(planner.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, linear, first));
+	ASSERT_TRUE(planner.plan(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, linear, second));
+	EXPECT_DOUBLE_EQ(first, -0.5 * config.max_angular);
+	EXPECT_DOUBLE_EQ(second, -0.75 * config.max_angular);
+}
+
+TEST(GapPlanner, RejectsUnusableGeometry)
+{
+	GapPlanner planner;
+	ScanGeometry geometry = lidar();
+	geometry.num_ranges = 0;
+	double linear, angular;
+	EXPECT_FALSE(planner.plan(geometry, nullptr, RANGE_MIN, RANGE_MAX, linear, angular));
+}
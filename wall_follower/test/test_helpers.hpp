@@ -0,0 +1,80 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Fixtures shared by the unit tests: scans from the TurtleBot3 lidar and
+// files for the memory-mapped stores to work on.
+
+#ifndef WALL_FOLLOWER__TEST_HELPERS_HPP_
+#define WALL_FOLLOWER__TEST_HELPERS_HPP_
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "wall_follower/sector_reducer.hpp"
+
+
+// The range limits of the LDS-01
+#define RANGE_MIN	0.12f
+#define RANGE_MAX	3.5f
+
+// num_ranges beams spread evenly anticlockwise from the front, 360 gives one
+// beam per degree
+inline ScanGeometry lidar(size_t num_ranges = 360)
+{
+	ScanGeometry geometry;
+	geometry.angle_min = 0.0;
+	geometry.angle_increment = 2.0 * M_PI / num_ranges;
+	geometry.num_ranges = num_ranges;
+	return geometry;
+}
+
+// A file for the test to map, removed afterwards
+class TempPath
+{
+public:
+	TempPath()
+	{
+		char path[] = "/tmp/wall_follower_test_XXXXXX";
+		int fd = mkstemp(path);
+		if (fd >= 0)
+			::close(fd);
+		path_ = path;
+	}
+	~TempPath() { std::remove(path_.c_str()); }
+	const std::string & str() const { return path_; }
+
+private:
+	std::string path_;
+};
+
+inline std::vector<uint8_t> read_file(const std::string & path)
+{
+	std::ifstream f(path, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+inline void write_file(const std::string & path, const std::vector<uint8_t> & data)
+{
+	std::ofstream f(path, std::ios::binary | std::ios::trunc);
+	f.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+#endif  // WALL_FOLLOWER__TEST_HELPERS_HPP_
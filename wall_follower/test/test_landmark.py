@@ -0,0 +1,89 @@
+"""
+The Python Landmark estimator. The observations and expected values are the
+same as in test_landmark_estimator.cpp, so the C++ LandmarkEstimator and this
+agree.
+"""
+
+import pytest
+
+from wall_follower.landmark import Landmark, marker_type
+
+
+class Point:
+
+	def __init__(self, x, y):
+		self.x = x
+		self.y = y
+
+
+def observation(i):
+	"""A small spread around (1, -2) with one outlier"""
+	if i == 25:
+		return Point(3.0, 1.0)
+	return Point(1.0 + 0.01*((i*7) % 11 - 5), -2.0 + 0.01*((i*5) % 13 - 6))
+
+
+def test_matches_cpp_estimator():
+	landmark = Landmark(0, [], min_change=0.0)
+	changed = sum(landmark.update_position(observation(i)) for i in range(40))
+
+	# The outlier is gated out
+	assert landmark.count == 39
+	assert changed == 39
+	assert landmark.mean_x == pytest.approx(1.0001451340220311, abs=1e-12)
+	assert landmark.mean_y == pytest.approx(-2.0027552756489397, abs=1e-12)
+	assert landmark.var_xx == pytest.approx(0.0010044397080393181, abs=1e-15)
+	assert landmark.var_xy == pytest.approx(9.3148946496311526e-05, abs=1e-15)
+	assert landmark.var_yy == pytest.approx(0.0014949673156810579, abs=1e-15)
+
+
+def test_adds_markers_on_first_observation():
+	markers = []
+	landmark = Landmark(2, markers)
+	assert markers == []
+	assert landmark.update_position(Point(1.0, 2.0))
+	assert len(markers) == 2
+	top, bottom = markers
+	assert top.ns == marker_type[2]
+	assert (top.id, bottom.id) == (4, 5)
+	assert (top.pose.position.x, top.pose.position.y) == (1.0, 2.0)
+	assert top.pose.position.z > bottom.pose.position.z
+
+	# Moving less than min_change leaves the markers where they are
+	assert not landmark.update_position(Point(1.001, 2.0))
+	assert top.pose.position.x == 1.0
+	assert len(markers) == 2
+
+
+def test_restarts_after_a_run_of_rejections():
+	landmark = Landmark(0, [])
+	for _ in range(landmark.min_count):
+		landmark.update_position(Point(0.0, 0.0))
+	for _ in range(1, landmark.max_rejects):
+		assert not landmark.update_position(Point(5.0, 5.0))
+	assert landmark.count == landmark.min_count
+	assert landmark.update_position(Point(5.0, 5.0))
+	assert landmark.count == 1
+	assert (landmark.mean_x, landmark.mean_y) == (5.0, 5.0)
+
+
+def test_mahalanobis_uses_the_noise_floor():
+	landmark = Landmark(0, [])
+	landmark.update_position(Point(0.0, 0.0))
+	assert landmark.mahalanobis2(0.05, 0.0) == pytest.approx(1.0)
+	assert landmark.mahalanobis2(0.0, 0.15) == pytest.approx(9.0)
+
+
+def test_restore_round_trip():
+	markers = []
+	saved = Landmark(3, [], min_change=0.0)
+	for i in range(20):
+		saved.update_position(observation(i))
+
+	landmark = Landmark(3, markers)
+	landmark.restore(*saved.snapshot())
+	assert landmark.snapshot() == saved.snapshot()
+	assert len(markers) == 2
+	assert markers[0].pose.position.x == saved.mean_x
+	# Gating applies straight away
+	assert not landmark.update_position(Point(4.0, 4.0))
@@ -0,0 +1,122 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LandmarkEstimator. The observations and expected values are the same as
+// in test_landmark.py, so that the C++ and Python estimators agree.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "wall_follower/landmark_estimator.hpp"
+
+
+// The observations of test_landmark.py: a small spread around (1, -2) with
+// one outlier
+static void observation(int i, double & x, double & y)
+{
+	x = 1.0 + 0.01 * ((i * 7) % 11 - 5);
+	y = -2.0 + 0.01 * ((i * 5) % 13 - 6);
+	if (i == 25)
+	{
+		x = 3.0;
+		y = 1.0;
+	}
+}
+
+TEST(LandmarkEstimator, StartsUnseen)
+{
+	LandmarkEstimator estimator;
+	EXPECT_FALSE(estimator.seen());
+	EXPECT_EQ(estimator.count(), 0u);
+	EXPECT_TRUE(estimator.update(1.0, 2.0));
+	EXPECT_TRUE(estimator.seen());
+	EXPECT_EQ(estimator.x(), 1.0);
+	EXPECT_EQ(estimator.y(), 2.0);
+}
+
+TEST(LandmarkEstimator, MatchesPythonLandmark)
+{
+	LandmarkConfig config;
+	config.min_change = 0.0;
+	LandmarkEstimator estimator(config);
+	int changed = 0;
+	for (int i = 0; i < 40; i++)
+	{
+		double x, y;
+		observation(i, x, y);
+		changed += estimator.update(x, y);
+	}
+
+	// The outlier is gated out
+	EXPECT_EQ(estimator.count(), 39u);
+	EXPECT_EQ(changed, 39);
+	EXPECT_NEAR(estimator.x(), 1.0001451340220311, 1e-12);
+	EXPECT_NEAR(estimator.y(), -2.0027552756489397, 1e-12);
+	EXPECT_NEAR(estimator.cov_xx(), 0.0010044397080393181, 1e-15);
+	EXPECT_NEAR(estimator.cov_xy(), 9.3148946496311526e-05, 1e-15);
+	EXPECT_NEAR(estimator.cov_yy(), 0.0014949673156810579, 1e-15);
+}
+
+TEST(LandmarkEstimator, SmallMovesDoNotChangeTheShownPosition)
+{
+	LandmarkEstimator estimator;
+	EXPECT_TRUE(estimator.update(1.0, 1.0));
+	EXPECT_FALSE(estimator.update(1.001, 1.0));
+	EXPECT_EQ(estimator.x(), 1.0);
+	EXPECT_TRUE(estimator.update(1.1, 1.0));
+	EXPECT_GT(estimator.x(), 1.0);
+}
+
+TEST(LandmarkEstimator, RestartsAfterARunOfRejections)
+{
+	LandmarkConfig config;
+	LandmarkEstimator estimator(config);
+	for (uint32_t i = 0; i < config.min_count; i++)
+		estimator.update(0.0, 0.0);
+
+	// The landmark was really somewhere else
+	for (uint32_t i = 1; i < config.max_rejects; i++)
+		EXPECT_FALSE(estimator.update(5.0, 5.0)) << "rejection " << i;
+	EXPECT_EQ(estimator.count(), config.min_count);
+	EXPECT_TRUE(estimator.update(5.0, 5.0));
+	EXPECT_EQ(estimator.count(), 1u);
+	EXPECT_EQ(estimator.x(), 5.0);
+	EXPECT_EQ(estimator.y(), 5.0);
+}
+
+TEST(LandmarkEstimator, MahalanobisUsesTheNoiseFloor)
+{
+	LandmarkConfig config;
+	LandmarkEstimator estimator(config);
+	estimator.update(0.0, 0.0);
+	// No spread yet, so only min_sigma in each axis
+	const double sigma = config.min_sigma;
+	EXPECT_NEAR(estimator.mahalanobis2(sigma, 0.0), 1.0, 1e-12);
+	EXPECT_NEAR(estimator.mahalanobis2(0.0, 3.0 * sigma), 9.0, 1e-12);
+}
+
+TEST(LandmarkEstimator, RestoresASavedEstimate)
+{
+	LandmarkEstimator estimator;
+	estimator.restore(12, 1.5, -0.5, 0.01, 0.0, 0.02);
+	EXPECT_TRUE(estimator.seen());
+	EXPECT_EQ(estimator.count(), 12u);
+	EXPECT_EQ(estimator.x(), 1.5);
+	EXPECT_EQ(estimator.y(), -0.5);
+	EXPECT_EQ(estimator.cov_yy(), 0.02);
+	// Gating applies straight away
+	EXPECT_FALSE(estimator.update(4.0, 4.0));
+
+	estimator.restore(0, 0.0, 0.0, 0.0, 0.0, 0.0);
+	EXPECT_FALSE(estimator.seen());
+}
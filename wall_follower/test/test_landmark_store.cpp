@@ -0,0 +1,197 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// LandmarkStore. The record is the same as in test_landmark_store.py, so
+// that the snapshot files the C++ and Python sides write are interchangeable.
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "wall_follower/landmark_store.hpp"
+#include "wall_follower/marker_types.hpp"
+
+#include "test_helpers.hpp"
+
+
+// The record of test_landmark_store.py, as written by either side
+static const char golden_record[] =
+	"0200000027000000000000000000f43f00000000000004c07b14ae47e17a843f"
+	"fca9f1d24d62603fb81e85eb51b89e3f00002040fc54d941000000002012d45d";
+
+static std::vector<uint8_t> from_hex(const char * hex)
+{
+	std::vector<uint8_t> bytes;
+	for (size_t i = 0; hex[i] && hex[i + 1]; i += 2)
+		bytes.push_back((uint8_t) std::strtoul(std::string(hex + i, 2).c_str(), nullptr, 16));
+	return bytes;
+}
+
+static LandmarkRecord golden()
+{
+	LandmarkRecord record = {};
+	record.type = 2;
+	record.count = 39;
+	record.x = 1.25;
+	record.y = -2.5;
+	record.cov_xx = 0.01;
+	record.cov_xy = 0.002;
+	record.cov_yy = 0.03;
+	record.stamp = 1700000000.5;
+	return record;
+}
+
+TEST(LandmarkStore, CrcMatchesZlib)
+{
+	EXPECT_EQ(crc32("123456789", 9), 0xcbf43926u);
+	EXPECT_EQ(crc32("", 0), 0u);
+}
+
+TEST(LandmarkStore, FileMatchesPythonFormat)
+{
+	TempPath path;
+	LandmarkStore store;
+	ASSERT_TRUE(store.open(path.str(), MAX_MARKERS)) << store.error();
+	store.update(golden());
+	store.close();
+
+	std::vector<uint8_t> data = read_file(path.str());
+	ASSERT_EQ(data.size(), sizeof(LandmarkStoreHeader) + MAX_MARKERS * sizeof(LandmarkRecord));
+	LandmarkStoreHeader header;
+	std::memcpy(&header, data.data(), sizeof(header));
+	EXPECT_EQ(std::memcmp(header.magic, "WFLM", 4), 0);
+	EXPECT_EQ(header.version, (uint32_t) LANDMARK_STORE_VERSION);
+	EXPECT_EQ(header.num_records, (uint32_t) MAX_MARKERS);
+	EXPECT_EQ(header.record_size, 64u);
+
+	std::vector<uint8_t> expected = from_hex(golden_record);
+	ASSERT_EQ(expected.size(), sizeof(LandmarkRecord));
+	std::vector<uint8_t> record(data.begin() + sizeof(header) + 2 * sizeof(LandmarkRecord),
+		data.begin() + sizeof(header) + 3 * sizeof(LandmarkRecord));
+	EXPECT_EQ(record, expected);
+}
+
+TEST(LandmarkStore, LoadsWhatWasSaved)
+{
+	TempPath path;
+	{
+		LandmarkStore store;
+		ASSERT_TRUE(store.open(path.str(), MAX_MARKERS));
+		store.update(golden());
+		LandmarkRecord unseen = golden();
+		unseen.type = 4;
+		unseen.count = 0;
+		store.update(unseen);
+	}
+
+	LandmarkStore store;
+	ASSERT_TRUE(store.open(path.str(), MAX_MARKERS));
+	std::vector<LandmarkRecord> records = store.load();
+	ASSERT_EQ(records.size(), 1u);
+	EXPECT_EQ(records[0].type, 2u);
+	EXPECT_EQ(records[0].count, 39u);
+	EXPECT_EQ(records[0].x, 1.25);
+	EXPECT_EQ(records[0].cov_yy, 0.03);
+	EXPECT_EQ(records[0].stamp, 1700000000.5);
+}
+
+TEST(LandmarkStore, LoadsRecordsWrittenByPython)
+{
+	TempPath path;
+	{
+		LandmarkStore store;
+		ASSERT_TRUE(store.open(path.str(), MAX_MARKERS));
+	}
+	std::vector<uint8_t> data = read_file(path.str());
+	std::vector<uint8_t> record = from_hex(golden_record);
+	std::copy(record.begin(), record.end(), data.begin() + sizeof(LandmarkStoreHeader) + 2 * sizeof(LandmarkRecord));
+	write_file(path.str(), data);
+
+	LandmarkStore store;
+	ASSERT_TRUE(store.open(path.str(), MAX_MARKERS));
+	std::vector<LandmarkRecord> records = store.load();
+	ASSERT_EQ(records.size(), 1u);
+	EXPECT_EQ(records[0].x, 1.25);
+	EXPECT_EQ(records[0].y, -2.5);
+}
+
+TEST(LandmarkStore, IgnoresCorruptRecords)
+{
+	TempPath path;
+	{
+		LandmarkStore store;
+		ASSERT_TRUE(store.open(path.str(), MAX_MARKERS));
+		LandmarkRecord record = golden();
+		store.update(record);
+		record.type = 3;
+		store.update(record);
+	}
+	std::vector<uint8_t> data = read_file(path.str());
+	data[sizeof(LandmarkStoreHeader) + 2 * sizeof(LandmarkRecord) + 8] ^= 0x01;	// a bit of x
+	write_file(path.str(), data);
+
+	LandmarkStore store;
+	ASSERT_TRUE(store.open(path.str(), MAX_MARKERS));
+	std::vector<LandmarkRecord> records = store.load();
+	ASSERT_EQ(records.size(), 1u);
+	EXPECT_EQ(records[0].type, 3u);
+}
+
+TEST(LandmarkStore, ResetsMismatchedFiles)
+{
+	TempPath path;
+	{
+		LandmarkStore store;
+		ASSERT_TRUE(store.open(path.str(), MAX_MARKERS));
+		store.update(golden());
+	}
+	LandmarkStore store;
+	ASSERT_TRUE(store.open(path.str(), MAX_MARKERS + 1));
+	EXPECT_TRUE(store.load().empty());
+	store.close();
+	EXPECT_EQ(read_file(path.str()).size(), sizeof(LandmarkStoreHeader) + (MAX_MARKERS + 1) * sizeof(LandmarkRecord));
+}
+
+TEST(LandmarkStore, BackgroundWriter)
+{
+	TempPath path;
+	LandmarkStore store;
+	ASSERT_TRUE(store.open(path.str(), MAX_MARKERS));
+	store.start(std::chrono::milliseconds(10));
+	store.update(golden());
+
+	// The writer thread saves it without a close
+	bool saved = false;
+	for (int i = 0; i < 200 && !saved; i++)
+	{
+		std::vector<uint8_t> data = read_file(path.str());
+		saved = data[sizeof(LandmarkStoreHeader) + 2 * sizeof(LandmarkRecord) + 4] == 39;
+		if (!saved)
+			usleep(10000);
+	}
+	EXPECT_TRUE(saved);
+	store.close();
+}
+
+TEST(LandmarkStore, ReportsOpenErrors)
+{
+	LandmarkStore store;
+	EXPECT_FALSE(store.open("/nonexistent/wall_follower/landmarks.bin", MAX_MARKERS));
+	EXPECT_FALSE(store.error().empty());
+}
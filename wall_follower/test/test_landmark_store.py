@@ -0,0 +1,139 @@
+"""
+The Python LandmarkStore, and its file format against the C++ one: the
+record below is what both write for the same landmark
+(test_landmark_store.cpp checks the C++ side).
+"""
+
+import struct
+import time
+import zlib
+
+from wall_follower import landmark_store
+from wall_follower.landmark_store import HEADER, LandmarkStore, MAGIC, RECORD_SIZE, VERSION
+
+NUM_RECORDS = 6
+GOLDEN_RECORD = bytes.fromhex(
+	'0200000027000000000000000000f43f00000000000004c07b14ae47e17a843f'
+	'fca9f1d24d62603fb81e85eb51b89e3f00002040fc54d941000000002012d45d')
+GOLDEN_STAMP = 1700000000.5
+
+
+class Saved:
+	"""Stands in for a Landmark, which only needs mtype and snapshot()"""
+
+	def __init__(self, mtype, count=39, x=1.25, y=-2.5, cov_xx=0.01, cov_xy=0.002, cov_yy=0.03):
+		self.mtype = mtype
+		self.state = (count, x, y, cov_xx, cov_xy, cov_yy)
+
+	def snapshot(self):
+		return self.state
+
+
+def record_offset(mtype):
+	return HEADER.size + mtype*RECORD_SIZE
+
+
+def read(path):
+	with open(path, 'rb') as f:
+		return bytearray(f.read())
+
+
+def write(path, data):
+	with open(path, 'wb') as f:
+		f.write(data)
+
+
+def test_crc_is_zlib():
+	# The C++ crc32() is checked against the same value
+	assert zlib.crc32(b'123456789') == 0xcbf43926
+	assert struct.unpack('<I', GOLDEN_RECORD[-4:])[0] == zlib.crc32(GOLDEN_RECORD[:-4])
+
+
+def test_file_matches_cpp_format(tmp_path, monkeypatch):
+	monkeypatch.setattr(landmark_store.time, 'time', lambda: GOLDEN_STAMP)
+	path = str(tmp_path / 'landmarks.bin')
+	store = LandmarkStore(path, NUM_RECORDS)
+	store.update(Saved(2))
+	store.close()
+
+	data = read(path)
+	assert len(data) == 16 + NUM_RECORDS*64
+	assert HEADER.unpack_from(data, 0) == (MAGIC, VERSION, NUM_RECORDS, 64)
+	assert data[record_offset(2):record_offset(3)] == GOLDEN_RECORD
+	assert data[record_offset(0):record_offset(2)] == bytes(2*RECORD_SIZE)
+
+
+def test_loads_what_was_saved(tmp_path):
+	path = str(tmp_path / 'landmarks.bin')
+	store = LandmarkStore(path, NUM_RECORDS)
+	store.update(Saved(1, count=7, x=0.5, y=0.25))
+	store.update(Saved(4, count=0))
+	store.close()
+
+	store = LandmarkStore(path, NUM_RECORDS)
+	assert store.load() == [(1, 7, 0.5, 0.25, 0.01, 0.002, 0.03)]
+	store.close()
+
+
+def test_loads_records_written_by_cpp(tmp_path):
+	path = str(tmp_path / 'landmarks.bin')
+	LandmarkStore(path, NUM_RECORDS).close()
+	data = read(path)
+	data[record_offset(2):record_offset(3)] = GOLDEN_RECORD
+	write(path, data)
+
+	store = LandmarkStore(path, NUM_RECORDS)
+	assert store.load() == [(2, 39, 1.25, -2.5, 0.01, 0.002, 0.03)]
+	store.close()
+
+
+def test_ignores_corrupt_records(tmp_path):
+	path = str(tmp_path / 'landmarks.bin')
+	store = LandmarkStore(path, NUM_RECORDS)
+	store.update(Saved(2))
+	store.update(Saved(3))
+	store.close()
+	data = read(path)
+	data[record_offset(2) + 8] ^= 0x01
+	# A valid record in the wrong slot is not trusted either
+	data[record_offset(5):record_offset(6)] = data[record_offset(3):record_offset(4)]
+	write(path, data)
+
+	store = LandmarkStore(path, NUM_RECORDS)
+	assert [record[0] for record in store.load()] == [3]
+	store.close()
+
+
+def test_resets_mismatched_files(tmp_path):
+	path = str(tmp_path / 'landmarks.bin')
+	store = LandmarkStore(path, NUM_RECORDS)
+	store.update(Saved(2))
+	store.close()
+
+	store = LandmarkStore(path, NUM_RECORDS + 1)
+	assert store.load() == []
+	store.close()
+	assert len(read(path)) == HEADER.size + (NUM_RECORDS + 1)*RECORD_SIZE
+
+	# Right size, wrong version
+	data = read(path)
+	struct.pack_into('<I', data, 4, VERSION + 1)
+	write(path, data)
+	store = LandmarkStore(path, NUM_RECORDS + 1)
+	assert HEADER.unpack_from(store.mm, 0) == (MAGIC, VERSION, NUM_RECORDS + 1, RECORD_SIZE)
+	store.close()
+
+
+def test_background_writer(tmp_path):
+	path = str(tmp_path / 'landmarks.bin')
+	store = LandmarkStore(path, NUM_RECORDS)
+	store.start(0.01)
+	store.update(Saved(2))
+
+	# The writer thread saves it without a close
+	for _ in range(200):
+		if read(path)[record_offset(2) + 4] == 39:
+			break
+		time.sleep(0.01)
+	assert read(path)[record_offset(2):record_offset(3)][:8] == GOLDEN_RECORD[:8]
+	store.close()
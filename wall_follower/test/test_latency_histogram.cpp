@@ -0,0 +1,118 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "wall_follower/latency_histogram.hpp"
+
+
+TEST(LatencyHistogram, SmallValuesHaveTheirOwnBuckets)
+{
+	for (uint64_t v = 0; v < LatencyHistogram::SUB_BUCKETS; v++)
+	{
+		EXPECT_EQ(LatencyHistogram::bucket_index(v), v);
+		EXPECT_EQ(LatencyHistogram::bucket_upper(v), v);
+	}
+}
+
+TEST(LatencyHistogram, BucketsAreContiguous)
+{
+	for (size_t i = 0; i + 1 < LatencyHistogram::NUM_BUCKETS; i++)
+	{
+		uint64_t upper = LatencyHistogram::bucket_upper(i);
+		ASSERT_EQ(LatencyHistogram::bucket_index(upper), i) << "bucket " << i;
+		ASSERT_EQ(LatencyHistogram::bucket_index(upper + 1), i + 1) << "bucket " << i;
+	}
+}
+
+TEST(LatencyHistogram, BucketErrorWithinOneSixteenth)
+{
+	for (uint64_t v = 1; v < ((uint64_t) 1 << 40); v = v * 3 / 2 + 1)
+	{
+		uint64_t upper = LatencyHistogram::bucket_upper(LatencyHistogram::bucket_index(v));
+		EXPECT_GE(upper, v);
+		EXPECT_LE((double) upper, v * (1.0 + 1.0 / LatencyHistogram::SUB_BUCKETS)) << "value " << v;
+	}
+}
+
+TEST(LatencyHistogram, ClampsHugeValues)
+{
+	EXPECT_EQ(LatencyHistogram::bucket_index(UINT64_MAX), LatencyHistogram::NUM_BUCKETS - 1);
+	EXPECT_EQ(LatencyHistogram::bucket_index((uint64_t) 1 << 50), LatencyHistogram::NUM_BUCKETS - 1);
+}
+
+TEST(LatencyHistogram, Percentiles)
+{
+	LatencyHistogram histogram;
+	// 1 .. 1000 microseconds
+	for (int64_t us = 1; us <= 1000; us++)
+		histogram.record(us * 1000);
+
+	LatencySummary summary = histogram.take();
+	EXPECT_EQ(summary.count, 1000u);
+	EXPECT_EQ(summary.max, 1000000u);
+	EXPECT_GE(summary.p50, 500000u);
+	EXPECT_LE(summary.p50, 500000u * 17 / 16);
+	EXPECT_GE(summary.p99, 990000u);
+	EXPECT_LE(summary.p99, summary.max);
+}
+
+TEST(LatencyHistogram, TakeStartsANewInterval)
+{
+	LatencyHistogram histogram;
+	histogram.record(5000);
+	histogram.record(-20);		// counts as zero
+	LatencySummary first = histogram.take();
+	EXPECT_EQ(first.count, 2u);
+	EXPECT_EQ(first.max, 5000u);
+	EXPECT_EQ(first.p50, 0u);
+
+	LatencySummary empty = histogram.take();
+	EXPECT_EQ(empty.count, 0u);
+	EXPECT_EQ(empty.p50, 0u);
+	EXPECT_EQ(empty.p99, 0u);
+	EXPECT_EQ(empty.max, 0u);
+}
+
+TEST(LatencyHistogram, SingleValueReportsItself)
+{
+	LatencyHistogram histogram;
+	histogram.record(123457);
+	LatencySummary summary = histogram.take();
+	// Percentiles are capped at the maximum rather than the bucket edge
+	EXPECT_EQ(summary.p50, 123457u);
+	EXPECT_EQ(summary.p99, 123457u);
+}
+
+TEST(LatencyHistogram, ConcurrentRecording)
+{
+	LatencyHistogram histogram;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&histogram, t]()
+		{
+			for (int64_t i = 0; i < 10000; i++)
+				histogram.record(1000 + t * 10000 + i);
+		});
+	}
+	for (std::thread & thread : threads)
+		thread.join();
+
+	LatencySummary summary = histogram.take();
+	EXPECT_EQ(summary.count, 40000u);
+	EXPECT_EQ(summary.max, 1000u + 3 * 10000 + 9999);
+}
@@ -0,0 +1,99 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// predict_sectors against motions whose effect on the sectors is known
+
+#include <gtest/gtest.h>
+
+#include "wall_follower/motion_compensation.hpp"
+
+#include "test_helpers.hpp"
+
+
+// Sectors at different distances, so that a shift between them shows
+static void distinct_sectors(double * sectors)
+{
+	for (int i = 0; i < NUM_SECTORS; i++)
+		sectors[i] = 1.0 + 0.1 * i;
+}
+
+TEST(MotionCompensation, TranslationShortensFront)
+{
+	double sectors[NUM_SECTORS], out[NUM_SECTORS];
+	distinct_sectors(sectors);
+	const double v = 0.25, dt = 0.2;
+	predict_sectors(sectors, v, 0.0, dt, RANGE_MAX, COMPENSATION_HORIZON, out);
+
+	EXPECT_NEAR(out[FRONT], sectors[FRONT] - v * dt, 1e-9);
+	EXPECT_NEAR(out[BACK], sectors[BACK] + v * dt, 1e-9);
+	// Side points fall behind the robot, which moves further from them
+	EXPECT_NEAR(out[LEFT], std::hypot(sectors[LEFT], v * dt), 1e-9);
+	EXPECT_NEAR(out[RIGHT], std::hypot(sectors[RIGHT], v * dt), 1e-9);
+}
+
+TEST(MotionCompensation, RotationShiftsSectors)
+{
+	double sectors[NUM_SECTORS], out[NUM_SECTORS];
+	distinct_sectors(sectors);
+
+	// Turning left a whole sector spacing brings each sector's left
+	// neighbour round to it
+	const double dt = 0.2;
+	const double w = SECTOR_SPACING * DEG2RAD / dt;
+	predict_sectors(sectors, 0.0, w, dt, RANGE_MAX, COMPENSATION_HORIZON, out);
+	for (int i = 0; i < NUM_SECTORS; i++)
+		EXPECT_NEAR(out[i], sectors[(i + 1) % NUM_SECTORS], 1e-9) << "sector " << i;
+
+	// Half a spacing to the right lands between the sector and its right
+	// neighbour
+	predict_sectors(sectors, 0.0, -w / 2.0, dt, RANGE_MAX, COMPENSATION_HORIZON, out);
+	for (int i = 0; i < NUM_SECTORS; i++)
+	{
+		double right = sectors[(i + NUM_SECTORS - 1) % NUM_SECTORS];
+		EXPECT_NEAR(out[i], 0.5 * (sectors[i] + right), 1e-9) << "sector " << i;
+	}
+}
+
+TEST(MotionCompensation, OpenSectorsStayOpen)
+{
+	double sectors[NUM_SECTORS], out[NUM_SECTORS];
+	distinct_sectors(sectors);
+	sectors[FRONT] = RANGE_MAX;
+	sectors[LEFT] = RANGE_MAX;
+
+	// Driving towards nothing does not make something appear
+	predict_sectors(sectors, 0.25, 0.0, 0.2, RANGE_MAX, COMPENSATION_HORIZON, out);
+	EXPECT_EQ(out[FRONT], RANGE_MAX);
+	EXPECT_EQ(out[LEFT], RANGE_MAX);
+
+	// Nor does turning a little, where an open sector is interpolated
+	// with a closed one
+	predict_sectors(sectors, 0.0, 0.2, 0.2, RANGE_MAX, COMPENSATION_HORIZON, out);
+	EXPECT_EQ(out[FRONT], RANGE_MAX);
+	EXPECT_DOUBLE_EQ(out[LEFT_FRONT], sectors[LEFT_FRONT]);
+}
+
+TEST(MotionCompensation, ClampsToHorizon)
+{
+	double sectors[NUM_SECTORS], clamped[NUM_SECTORS], at_horizon[NUM_SECTORS];
+	distinct_sectors(sectors);
+
+	predict_sectors(sectors, 0.25, 0.5, 2.0, RANGE_MAX, COMPENSATION_HORIZON, clamped);
+	predict_sectors(sectors, 0.25, 0.5, COMPENSATION_HORIZON, RANGE_MAX, COMPENSATION_HORIZON, at_horizon);
+	for (int i = 0; i < NUM_SECTORS; i++)
+		EXPECT_EQ(clamped[i], at_horizon[i]) << "sector " << i;
+
+	// A stamp from the future is not extrapolated backwards
+	predict_sectors(sectors, 0.25, 0.5, -0.1, RANGE_MAX, COMPENSATION_HORIZON, clamped);
+	for (int i = 0; i < NUM_SECTORS; i++)
+		EXPECT_DOUBLE_EQ(clamped[i], sectors[i]) << "sector " << i;
+}
@@ -0,0 +1,101 @@
+import json
+import os
+import tempfile
+import unittest
+
+import launch_testing
+import launch_testing.actions
+import launch_testing.asserts
+import pytest
+import yaml
+
+from ament_index_python.packages import get_package_share_directory
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument, IncludeLaunchDescription, OpaqueFunction
+from launch.launch_description_sources import PythonLaunchDescriptionSource
+from launch.substitutions import LaunchConfiguration
+
+
+# Wall-clock seconds allowed on top of the scenario timeout for gzserver,
+# Cartographer and the nodes to start
+STARTUP_MARGIN = 120.0
+
+
+def resolve_scenario(context, run):
+    """
+    Look up the scenario being run, so that the tests know its timeout and
+    limits
+    """
+    name = LaunchConfiguration('scenario').perform(context)
+    with open(LaunchConfiguration('scenarios_file').perform(context), 'r') as f:
+        scenarios = yaml.safe_load(f)['scenarios']
+    for scenario in scenarios:
+        if scenario['name'] == name:
+            run.update(scenario)
+            return []
+    raise RuntimeError("No scenario '%s' in %s" % (name, LaunchConfiguration('scenarios_file').perform(context)))
+
+
+@pytest.mark.launch_test
+def generate_test_description():
+    """
+    One scenario of perf_suite.launch.py, chosen with scenario:=<name>. The
+    launch is left running when perf_monitor.py exits so that the active test
+    sees the exit, and the metrics are checked against the scenario's limits
+    after shutdown.
+    """
+    share = get_package_share_directory('wall_follower')
+    results_file = os.path.join(tempfile.mkdtemp(prefix='wall_follower_perf_'), 'results.jsonl')
+    run = {}
+
+    return LaunchDescription([
+        DeclareLaunchArgument(
+            'scenario', default_value='maze',
+            description='Name of the scenario in scenarios_file'),
+        DeclareLaunchArgument(
+            'scenarios_file', default_value=os.path.join(share, 'config', 'perf_scenarios.yaml'),
+            description='Worlds, spawn poses and metric limits'),
+        OpaqueFunction(function=resolve_scenario, args=[run]),
+        IncludeLaunchDescription(
+            PythonLaunchDescriptionSource(os.path.join(share, 'launch', 'perf_suite.launch.py')),
+            launch_arguments={
+                'scenario': LaunchConfiguration('scenario'),
+                'scenarios_file': LaunchConfiguration('scenarios_file'),
+                'results_file': results_file,
+                'shutdown_when_done': 'False',
+            }.items()),
+        launch_testing.actions.ReadyToTest(),
+    ]), {'results_file': results_file, 'run': run}
+
+
+class TestScenario(unittest.TestCase):
+
+    def test_scenario_finishes(self, proc_info, run):
+        proc_info.assertWaitForShutdown(process='perf_monitor.py',
+            timeout=float(run.get('timeout', 300.0)) + STARTUP_MARGIN)
+
+
+@launch_testing.post_shutdown_test()
+class TestScenarioResults(unittest.TestCase):
+
+    def load_result(self, results_file, run):
+        self.assertTrue(os.path.exists(results_file), 'perf_monitor.py wrote no results')
+        with open(results_file, 'r') as f:
+            results = [json.loads(line) for line in f if line.strip()]
+        self.assertEqual(len(results), 1)
+        self.assertEqual(results[0]['scenario'], run['name'])
+        return results[0]
+
+    def test_monitor_exit_code(self, proc_info):
+        launch_testing.asserts.assertExitCodes(proc_info, process='perf_monitor.py')
+
+    def test_limits(self, results_file, run):
+        """perf_monitor.py checks the scenario limits, this only reports them"""
+        result = self.load_result(results_file, run)
+        self.assertEqual(result['failures'], [])
+        self.assertTrue(result['passed'])
+
+    def test_markers_mapped(self, results_file, run):
+        result = self.load_result(results_file, run)
+        self.assertEqual(result['markers_found'], result['markers_expected'],
+            '%d of %d markers mapped' % (result['markers_found'], result['markers_expected']))
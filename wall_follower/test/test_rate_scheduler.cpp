@@ -0,0 +1,112 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// RateScheduler with the default periods: fast 0.05 s, slow 0.2 s, idle
+// 1 s, and a hysteresis of a quarter of the current period.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "wall_follower/rate_scheduler.hpp"
+
+
+#define OPEN	3.0		// metres in front, beyond far_distance
+
+// The speed at which open space runs at period, for the default config
+static double speed_for(double period)
+{
+	RateConfig config;
+	return config.fast_speed * (config.slow_period - period) / (config.slow_period - config.fast_period);
+}
+
+TEST(RateScheduler, StartsAtControlPeriod)
+{
+	RateScheduler scheduler;
+	EXPECT_EQ(scheduler.period(), CONTROL_PERIOD);
+}
+
+TEST(RateScheduler, Hysteresis)
+{
+	RateScheduler scheduler;
+
+	// Within a quarter of 0.1 s: not reported
+	EXPECT_FALSE(scheduler.update(OPEN, speed_for(0.12), false));
+	EXPECT_FALSE(scheduler.update(OPEN, speed_for(0.08), false));
+	EXPECT_EQ(scheduler.period(), CONTROL_PERIOD);
+
+	EXPECT_TRUE(scheduler.update(OPEN, 0.0, false));
+	EXPECT_DOUBLE_EQ(scheduler.period(), 0.2);
+
+	// The band follows the period
+	EXPECT_FALSE(scheduler.update(OPEN, speed_for(0.16), false));
+	EXPECT_TRUE(scheduler.update(OPEN, speed_for(0.14), false));
+	EXPECT_NEAR(scheduler.period(), 0.14, 1e-12);
+}
+
+TEST(RateScheduler, JumpsToFastPeriod)
+{
+	// 0.05 s is within the hysteresis of 0.06 s, but the fastest period is
+	// taken straight away, for an obstacle or for speed
+	for (bool obstacle : {true, false})
+	{
+		RateScheduler scheduler;
+		ASSERT_TRUE(scheduler.update(OPEN, speed_for(0.06), false));
+		ASSERT_NEAR(scheduler.period(), 0.06, 1e-12);
+
+		EXPECT_TRUE(obstacle ? scheduler.update(0.3, 0.0, false) : scheduler.update(OPEN, -0.3, false));
+		EXPECT_EQ(scheduler.period(), scheduler.config().fast_period);
+
+		// Nothing more to report while it stays urgent
+		EXPECT_FALSE(scheduler.update(0.2, 0.3, false));
+	}
+}
+
+TEST(RateScheduler, IdlesWhenStopped)
+{
+	RateScheduler scheduler;
+	EXPECT_TRUE(scheduler.update(0.3, 0.0, true));
+	EXPECT_EQ(scheduler.period(), scheduler.config().idle_period);
+	EXPECT_FALSE(scheduler.update(0.3, 0.0, true));
+
+	// Moving again near an obstacle
+	EXPECT_TRUE(scheduler.update(0.3, 0.0, false));
+	EXPECT_EQ(scheduler.period(), scheduler.config().fast_period);
+}
+
+TEST(RateScheduler, ConfigureOrdersPeriods)
+{
+	RateConfig config;
+	config.fast_period = 0.3;
+	config.slow_period = 0.1;
+	config.idle_period = 0.05;
+	config.near_distance = 0.5;
+	config.far_distance = 0.2;
+
+	RateScheduler scheduler;
+	scheduler.configure(config);
+	const RateConfig & ordered = scheduler.config();
+	EXPECT_EQ(ordered.fast_period, 0.3);
+	EXPECT_EQ(ordered.slow_period, 0.3);
+	EXPECT_EQ(ordered.idle_period, 0.3);
+	EXPECT_GT(ordered.far_distance, ordered.near_distance);
+	// The starting period lies within the configured range
+	EXPECT_EQ(scheduler.period(), 0.3);
+
+	// No division by zero between near and far
+	scheduler.update(0.5, 0.0, false);
+	EXPECT_TRUE(std::isfinite(scheduler.period()));
+
+	config.fast_period = 0.0;
+	scheduler.configure(config);
+	EXPECT_GT(scheduler.config().fast_period, 0.0);
+}
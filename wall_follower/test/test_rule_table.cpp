@@ -0,0 +1,123 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "wall_follower/rule_table.hpp"
+#include "wall_follower/sectors.hpp"
+
+
+static void fill(double * sectors, double d)
+{
+	for (int i = 0; i < NUM_SECTORS; i++)
+		sectors[i] = d;
+}
+
+TEST(RuleTable, SectorNames)
+{
+	for (int i = 0; i < NUM_SECTORS; i++)
+		EXPECT_EQ(sector_index(sector_name(i)), i);
+	EXPECT_STREQ(sector_name(LEFT_FRONT), "LEFT_FRONT");
+	EXPECT_STREQ(sector_name(NUM_SECTORS), "UNKNOWN");
+	EXPECT_STREQ(sector_name(-1), "UNKNOWN");
+	EXPECT_EQ(sector_index("left_front"), -1);
+	EXPECT_EQ(sector_index(""), -1);
+}
+
+TEST(RuleTable, DefaultLadder)
+{
+	RuleTable table;
+	ASSERT_EQ(table.size(), 5u);
+	double sectors[NUM_SECTORS];
+
+	// Open on the left: turn towards the wall
+	fill(sectors, 2.0);
+	EXPECT_EQ(table.rule(table.evaluate(sectors)).name, "left_front_open");
+
+	// Wall on the left, blocked ahead: turn right on the spot
+	fill(sectors, 2.0);
+	sectors[LEFT_FRONT] = 0.5;
+	sectors[FRONT] = 0.5;
+	EXPECT_EQ(table.rule(table.evaluate(sectors)).name, "front_blocked");
+	EXPECT_EQ(table.rule(table.evaluate(sectors)).linear, 0.0);
+
+	sectors[FRONT] = 2.0;
+	sectors[FRONT_LEFT] = 0.5;
+	EXPECT_EQ(table.rule(table.evaluate(sectors)).name, "front_left_close");
+
+	sectors[FRONT_LEFT] = 2.0;
+	sectors[FRONT_RIGHT] = 0.5;
+	EXPECT_EQ(table.rule(table.evaluate(sectors)).name, "front_right_close");
+
+	sectors[FRONT_RIGHT] = 2.0;
+	sectors[LEFT_FRONT] = 0.7;
+	EXPECT_EQ(table.rule(table.evaluate(sectors)).name, "left_front_clear");
+
+	// Nothing holds: the fallback drives straight on
+	sectors[LEFT_FRONT] = 0.5;
+	size_t i = table.evaluate(sectors);
+	EXPECT_EQ(i, table.size());
+	EXPECT_EQ(table.rule(i).name, "path_clear");
+	EXPECT_EQ(table.rule(i).linear, LINEAR_VELOCITY);
+	EXPECT_EQ(table.rule(i).angular, 0.0);
+}
+
+TEST(RuleTable, FirstRuleThatHoldsWins)
+{
+	std::vector<Rule> rules = {
+		{"near", FRONT, RuleCondition::LESS, 0.5, 0.0, 1.0},
+		{"nearer", FRONT, RuleCondition::LESS, 0.3, 0.0, -1.0},
+		{"far_left", LEFT, RuleCondition::GREATER, 1.0, 0.2, 0.5},
+	};
+	Rule fallback = {"straight", FRONT, RuleCondition::LESS, 0.0, 0.4, 0.0};
+	RuleTable table;
+	table.set_rules(rules, fallback);
+	ASSERT_EQ(table.size(), 3u);
+
+	double sectors[NUM_SECTORS];
+	fill(sectors, 0.8);
+	sectors[FRONT] = 0.2;
+	EXPECT_EQ(table.evaluate(sectors), 0u);		// "nearer" also holds but comes later
+
+	sectors[FRONT] = 0.6;
+	sectors[LEFT] = 1.5;
+	EXPECT_EQ(table.evaluate(sectors), 2u);
+
+	// Thresholds are strict
+	sectors[LEFT] = 1.0;
+	sectors[FRONT] = 0.5;
+	EXPECT_EQ(table.evaluate(sectors), 3u);
+	EXPECT_EQ(table.rule(3).name, "straight");
+	EXPECT_EQ(table.rule(3).linear, 0.4);
+}
+
+TEST(RuleTable, EmptyTableUsesFallback)
+{
+	RuleTable table;
+	table.set_rules({}, RuleTable::default_fallback());
+	double sectors[NUM_SECTORS];
+	fill(sectors, 0.1);
+	EXPECT_EQ(table.size(), 0u);
+	EXPECT_EQ(table.evaluate(sectors), 0u);
+	EXPECT_EQ(table.rule(0).name, "path_clear");
+}
+
+TEST(RuleTable, Descriptions)
+{
+	RuleTable table;
+	EXPECT_EQ(table.description(1), "Rule 'front_blocked' (FRONT < 0.70): linear 0.00, angular -1.50");
+	EXPECT_EQ(table.description(0), "Rule 'left_front_open' (LEFT_FRONT > 0.90): linear 0.20, angular 1.50");
+	EXPECT_EQ(table.description(table.size()), "Rule 'path_clear': linear 0.30, angular 0.00");
+}
@@ -0,0 +1,129 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "wall_follower/scan_filter.hpp"
+
+#include "test_helpers.hpp"
+
+
+static ScanFilter make_filter(int depth, double spike_threshold)
+{
+	ScanFilterConfig config;
+	config.depth = depth;
+	config.spike_threshold = spike_threshold;
+	ScanFilter filter;
+	filter.configure(config);
+	return filter;
+}
+
+TEST(ScanFilter, DisabledPassesRangesThrough)
+{
+	ScanFilter filter = make_filter(1, 0.0);
+	EXPECT_FALSE(filter.enabled());
+	std::vector<float> ranges(360, 1.0f);
+	EXPECT_EQ(filter.apply(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX), ranges.data());
+}
+
+TEST(ScanFilter, DepthIsOddAndBounded)
+{
+	EXPECT_EQ(make_filter(4, 0.0).config().depth, 3);
+	EXPECT_EQ(make_filter(5, 0.0).config().depth, 5);
+	EXPECT_EQ(make_filter(0, 0.0).config().depth, 1);
+	EXPECT_EQ(make_filter(-3, 0.0).config().depth, 1);
+	EXPECT_EQ(make_filter(100, 0.0).config().depth, SCAN_FILTER_MAX_DEPTH);
+	EXPECT_EQ(make_filter(1, -1.0).config().spike_threshold, 0.0);
+}
+
+TEST(ScanFilter, InvalidReadingsBecomeInfinite)
+{
+	ScanFilter filter = make_filter(1, 10.0);
+	std::vector<float> ranges = {1.0f, std::numeric_limits<float>::quiet_NaN(), 0.05f, 4.0f, 2.0f};
+	const float * out = filter.apply(lidar(ranges.size()), ranges.data(), RANGE_MIN, RANGE_MAX);
+	EXPECT_EQ(out[0], 1.0f);
+	EXPECT_TRUE(std::isinf(out[1]));
+	EXPECT_TRUE(std::isinf(out[2]));
+	EXPECT_TRUE(std::isinf(out[3]));
+	EXPECT_EQ(out[4], 2.0f);
+}
+
+TEST(ScanFilter, RejectsIsolatedSpikes)
+{
+	ScanFilter filter = make_filter(1, 0.5);
+	// A spike out, a spike in, a step edge, and spikes on the end beams
+	std::vector<float> ranges = {3.0f, 1.0f, 1.0f, 3.0f, 1.0f, 1.0f, 0.2f, 1.0f, 1.0f, 2.0f, 2.0f, 2.0f, 0.5f};
+	const float * out = filter.apply(lidar(ranges.size()), ranges.data(), RANGE_MIN, RANGE_MAX);
+	std::vector<float> expected = {3.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 2.0f, 2.0f, 2.0f, 0.5f};
+	for (size_t i = 0; i < ranges.size(); i++)
+		EXPECT_EQ(out[i], expected[i]) << "beam " << i;
+}
+
+TEST(ScanFilter, TemporalMedian)
+{
+	ScanFilter filter = make_filter(3, 0.0);
+	const ScanGeometry geometry = lidar(1);
+	// The history starts filled with the first scan
+	const float scans[] = {1.0f, 5.0f, 2.0f, 3.0f, 3.0f};
+	const float expected[] = {1.0f, 1.0f, 2.0f, 3.0f, 3.0f};
+	for (int k = 0; k < 5; k++)
+		EXPECT_EQ(*filter.apply(geometry, &scans[k], RANGE_MIN, RANGE_MAX), expected[k]) << "scan " << k;
+}
+
+TEST(ScanFilter, TemporalMedianMatchesSort)
+{
+	const size_t n = 360;
+	const int depth = 5;
+	ScanFilter filter = make_filter(depth, 0.0);
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> range(RANGE_MIN, RANGE_MAX);
+	std::deque<std::vector<float>> history;
+
+	for (int k = 0; k < 30; k++)
+	{
+		std::vector<float> ranges(n);
+		for (float & r : ranges)
+			r = range(rng);
+		if (history.empty())
+			history.assign(depth, ranges);
+		history.push_back(ranges);
+		history.pop_front();
+
+		const float * out = filter.apply(lidar(n), ranges.data(), RANGE_MIN, RANGE_MAX);
+		for (size_t i = 0; i < n; i++)
+		{
+			std::vector<float> last;
+			for (const std::vector<float> & row : history)
+				last.push_back(row[i]);
+			std::nth_element(last.begin(), last.begin() + depth / 2, last.end());
+			ASSERT_EQ(out[i], last[depth / 2]) << "scan " << k << ", beam " << i;
+		}
+	}
+}
+
+TEST(ScanFilter, GeometryChangeClearsHistory)
+{
+	ScanFilter filter = make_filter(3, 0.0);
+	std::vector<float> near(360, 0.5f), far(720, 2.5f);
+	filter.apply(lidar(), near.data(), RANGE_MIN, RANGE_MAX);
+	filter.apply(lidar(), near.data(), RANGE_MIN, RANGE_MAX);
+	const float * out = filter.apply(lidar(720), far.data(), RANGE_MIN, RANGE_MAX);
+	for (size_t i = 0; i < far.size(); i++)
+		ASSERT_EQ(out[i], 2.5f) << "beam " << i;
+}
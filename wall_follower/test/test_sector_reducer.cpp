@@ -0,0 +1,242 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SectorReducer against the windows of the original scan_callback, which
+// took the minimum of beams [centre - BEAM_WIDTH, centre + BEAM_WIDTH) of a
+// 360 beam scan starting at 0, with FRONT wrapping past the last beam.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "wall_follower/sector_reducer.hpp"
+#include "wall_follower/sectors.hpp"
+
+#include "test_helpers.hpp"
+
+
+// The original windows, for a scan of beams_per_degree beams per degree
+static void baseline_sectors(const std::vector<float> & ranges, int beams_per_degree, double * out)
+{
+	const int n = (int) ranges.size();
+	for (int s = 0; s < NUM_SECTORS; s++)
+	{
+		double closest = RANGE_MAX;
+		int centre = s * SECTOR_SPACING * beams_per_degree;
+		for (int b = centre - BEAM_WIDTH * beams_per_degree; b < centre + BEAM_WIDTH * beams_per_degree; b++)
+			closest = std::min(closest, (double) ranges[(b + n) % n]);
+		out[s] = closest;
+	}
+}
+
+static SectorReducer lidar_reducer(int beams_per_degree)
+{
+	double centres[NUM_SECTORS];
+	for (int s = 0; s < NUM_SECTORS; s++)
+		centres[s] = s * SECTOR_SPACING * DEG2RAD;
+
+	SectorReducer reducer;
+	reducer.set_sectors(centres, NUM_SECTORS, BEAM_WIDTH * DEG2RAD);
+	EXPECT_TRUE(reducer.update(lidar(360 * beams_per_degree)));
+	return reducer;
+}
+
+static std::vector<float> random_scan(size_t n, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> range(RANGE_MIN, RANGE_MAX);
+	std::vector<float> ranges(n);
+	for (float & r : ranges)
+		r = range(rng);
+	return ranges;
+}
+
+TEST(SectorReducer, SpansMatchBaselineWindows)
+{
+	SectorReducer reducer = lidar_reducer(1);
+	ASSERT_EQ(reducer.size(), (size_t) NUM_SECTORS);
+
+	// FRONT wraps: beams 350 .. 359 and 0 .. 9
+	const Sector & front = reducer.sector(FRONT);
+	ASSERT_EQ(front.num_spans, 2u);
+	EXPECT_EQ(front.span[0].begin, 350u);
+	EXPECT_EQ(front.span[0].end, 360u);
+	EXPECT_EQ(front.span[1].begin, 0u);
+	EXPECT_EQ(front.span[1].end, 10u);
+
+	for (int s = 1; s < NUM_SECTORS; s++)
+	{
+		const Sector & sector = reducer.sector(s);
+		ASSERT_EQ(sector.num_spans, 1u) << "sector " << s;
+		EXPECT_EQ(sector.span[0].begin, (uint32_t) (s * SECTOR_SPACING - BEAM_WIDTH)) << "sector " << s;
+		EXPECT_EQ(sector.span[0].end, (uint32_t) (s * SECTOR_SPACING + BEAM_WIDTH)) << "sector " << s;
+	}
+}
+
+TEST(SectorReducer, MinMatchesBaseline)
+{
+	for (int beams_per_degree : {1, 2, 4})
+	{
+		SectorReducer reducer = lidar_reducer(beams_per_degree);
+		for (unsigned seed = 0; seed < 20; seed++)
+		{
+			std::vector<float> ranges = random_scan(360 * beams_per_degree, seed);
+			double expected[NUM_SECTORS], sectors[NUM_SECTORS];
+			baseline_sectors(ranges, beams_per_degree, expected);
+			reducer.reduce_min(ranges.data(), RANGE_MIN, RANGE_MAX, sectors);
+			for (int s = 0; s < NUM_SECTORS; s++)
+				EXPECT_EQ(sectors[s], expected[s]) << beams_per_degree << " beams/degree, seed " << seed
+					<< ", sector " << s;
+		}
+	}
+}
+
+TEST(SectorReducer, MasksInvalidReadings)
+{
+	SectorReducer reducer = lidar_reducer(1);
+	std::vector<float> ranges(360, 2.0f);
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const float inf = std::numeric_limits<float>::infinity();
+
+	// LEFT (beams 80 .. 99): one valid reading among invalid ones
+	for (int b = 80; b < 100; b++)
+		ranges[b] = b % 3 == 0 ? nan : b % 3 == 1 ? inf : 0.05f;
+	ranges[95] = 1.25f;
+	// RIGHT (beams 260 .. 279): nothing valid
+	for (int b = 260; b < 280; b++)
+		ranges[b] = b % 2 ? nan : RANGE_MAX + 1.0f;
+
+	double sectors[NUM_SECTORS];
+	reducer.reduce_min(ranges.data(), RANGE_MIN, RANGE_MAX, sectors);
+	EXPECT_FLOAT_EQ(sectors[LEFT], 1.25f);
+	EXPECT_FLOAT_EQ(sectors[RIGHT], RANGE_MAX);
+	EXPECT_FLOAT_EQ(sectors[FRONT], 2.0f);
+}
+
+TEST(SectorReducer, PercentileOfValidReadings)
+{
+	SectorReducer reducer = lidar_reducer(1);
+	std::vector<float> ranges = random_scan(360, 7);
+	// LEFT_BACK (beams 110 .. 129) holds 1.0 .. 2.9, plus an invalid reading
+	for (int b = 110; b < 130; b++)
+		ranges[b] = 1.0f + 0.1f * (b - 110);
+	ranges[120] = std::numeric_limits<float>::quiet_NaN();
+
+	double minimum[NUM_SECTORS], q0[NUM_SECTORS], q1[NUM_SECTORS], median[NUM_SECTORS];
+	reducer.reduce_min(ranges.data(), RANGE_MIN, RANGE_MAX, minimum);
+	reducer.reduce_percentile(ranges.data(), RANGE_MIN, RANGE_MAX, 0.0, q0);
+	reducer.reduce_percentile(ranges.data(), RANGE_MIN, RANGE_MAX, 1.0, q1);
+	reducer.reduce_percentile(ranges.data(), RANGE_MIN, RANGE_MAX, 0.5, median);
+	for (int s = 0; s < NUM_SECTORS; s++)
+	{
+		EXPECT_EQ(q0[s], minimum[s]);
+		EXPECT_GE(q1[s], median[s]);
+		EXPECT_GE(median[s], minimum[s]);
+	}
+	// 19 valid readings (2.0 is the invalid one), the median is the 10th
+	EXPECT_FLOAT_EQ(q0[LEFT_BACK], 1.0f);
+	EXPECT_FLOAT_EQ(median[LEFT_BACK], 1.9f);
+	EXPECT_FLOAT_EQ(q1[LEFT_BACK], 2.9f);
+}
+
+TEST(SectorReducer, RebuildsOnlyWhenGeometryChanges)
+{
+	SectorReducer reducer = lidar_reducer(1);
+	EXPECT_EQ(reducer.rebuilds(), 1u);
+
+	ScanGeometry geometry = reducer.geometry();
+	EXPECT_TRUE(reducer.update(geometry));
+	EXPECT_EQ(reducer.rebuilds(), 1u);
+
+	EXPECT_TRUE(reducer.update(lidar(720)));
+	EXPECT_EQ(reducer.rebuilds(), 2u);
+	EXPECT_EQ(reducer.sector(LEFT).span[0].begin, 160u);
+	EXPECT_EQ(reducer.sector(LEFT).span[0].end, 200u);
+}
+
+TEST(SectorReducer, RejectsUnusableGeometry)
+{
+	SectorReducer reducer = lidar_reducer(1);
+	ScanGeometry geometry = reducer.geometry();
+
+	geometry.num_ranges = 0;
+	EXPECT_FALSE(reducer.update(geometry));
+	EXPECT_FALSE(reducer.configured());
+
+	geometry.num_ranges = 360;
+	geometry.angle_increment = 0.0;
+	EXPECT_FALSE(reducer.update(geometry));
+
+	geometry.angle_increment = DEG2RAD;
+	geometry.angle_min = std::numeric_limits<double>::quiet_NaN();
+	EXPECT_FALSE(reducer.update(geometry));
+}
+
+TEST(SectorReducer, ClipsSectorsToPartialScan)
+{
+	// A lidar covering -90 .. 90 degrees: the rear sectors have no beams
+	SectorReducer reducer = lidar_reducer(1);
+	ScanGeometry geometry;
+	geometry.angle_min = -90.0 * DEG2RAD;
+	geometry.angle_increment = DEG2RAD;
+	geometry.num_ranges = 181;
+	ASSERT_TRUE(reducer.update(geometry));
+
+	EXPECT_EQ(reducer.sector(BACK).num_spans, 0u);
+	ASSERT_EQ(reducer.sector(FRONT).num_spans, 1u);
+	EXPECT_EQ(reducer.sector(FRONT).span[0].begin, 80u);
+	EXPECT_EQ(reducer.sector(FRONT).span[0].end, 100u);
+
+	std::vector<float> ranges(181, 1.5f);
+	double sectors[NUM_SECTORS];
+	reducer.reduce_min(ranges.data(), RANGE_MIN, RANGE_MAX, sectors);
+	EXPECT_FLOAT_EQ(sectors[FRONT], 1.5f);
+	EXPECT_FLOAT_EQ(sectors[BACK], RANGE_MAX);
+}
+
+
+/********************************************************************************
+** BeamFan
+********************************************************************************/
+
+TEST(BeamFan, IndexesBeamsAcrossTheWindow)
+{
+	BeamFan fan;
+	fan.set_window(-90.0 * DEG2RAD, 90.0 * DEG2RAD);
+	ASSERT_TRUE(fan.update(lidar()));
+
+	ASSERT_EQ(fan.size(), 181u);
+	EXPECT_EQ(fan.index(0), 270);
+	EXPECT_EQ(fan.index(89), 359);
+	EXPECT_EQ(fan.index(90), 0);
+	EXPECT_EQ(fan.index(180), 90);
+	EXPECT_NEAR(fan.angle(90), 0.0, 1e-12);
+}
+
+TEST(BeamFan, MarksAnglesWithoutBeams)
+{
+	BeamFan fan;
+	fan.set_window(-90.0 * DEG2RAD, 90.0 * DEG2RAD);
+	ScanGeometry geometry;
+	geometry.angle_min = 0.0;
+	geometry.angle_increment = DEG2RAD;
+	geometry.num_ranges = 180;		// 0 .. 179 degrees only
+	ASSERT_TRUE(fan.update(geometry));
+
+	for (size_t i = 0; i < 90; i++)
+		EXPECT_EQ(fan.index(i), -1) << "step " << i;
+	for (size_t i = 90; i < fan.size(); i++)
+		EXPECT_EQ(fan.index(i), (int32_t) (i - 90)) << "step " << i;
+}
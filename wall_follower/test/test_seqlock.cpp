@@ -0,0 +1,101 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "wall_follower/seqlock.hpp"
+
+
+// Every field is derived from n, so a torn read shows as a mismatch
+struct Snapshot
+{
+	uint64_t n;
+	double values[8];
+	uint64_t check;
+};
+
+static Snapshot make_snapshot(uint64_t n)
+{
+	Snapshot s;
+	s.n = n;
+	for (int i = 0; i < 8; i++)
+		s.values[i] = (double) n * (i + 1);
+	s.check = ~n;
+	return s;
+}
+
+static bool consistent(const Snapshot & s)
+{
+	for (int i = 0; i < 8; i++)
+		if (s.values[i] != (double) s.n * (i + 1))
+			return false;
+	return s.check == ~s.n;
+}
+
+TEST(SeqLock, StartsZeroed)
+{
+	SeqLock<Snapshot> lock;
+	Snapshot s = lock.load();
+	EXPECT_EQ(s.n, 0u);
+	EXPECT_EQ(s.check, 0u);
+}
+
+TEST(SeqLock, LoadsLastStore)
+{
+	SeqLock<Snapshot> lock;
+	for (uint64_t n = 1; n <= 10; n++)
+	{
+		lock.store(make_snapshot(n));
+		Snapshot s = lock.load();
+		EXPECT_EQ(s.n, n);
+		EXPECT_TRUE(consistent(s));
+	}
+}
+
+TEST(SeqLock, ReadersNeverSeeTornWrites)
+{
+	SeqLock<Snapshot> lock;
+	lock.store(make_snapshot(1));
+	std::atomic<bool> done(false);
+	std::atomic<int> torn(0), backwards(0);
+
+	std::vector<std::thread> readers;
+	for (int r = 0; r < 3; r++)
+	{
+		readers.emplace_back([&]()
+		{
+			uint64_t last = 0;
+			while (!done.load(std::memory_order_relaxed))
+			{
+				Snapshot s = lock.load();
+				torn += !consistent(s);
+				backwards += s.n < last;
+				last = s.n;
+			}
+		});
+	}
+
+	for (uint64_t n = 2; n < 200000; n++)
+		lock.store(make_snapshot(n));
+	done = true;
+	for (std::thread & reader : readers)
+		reader.join();
+
+	EXPECT_EQ(torn.load(), 0);
+	EXPECT_EQ(backwards.load(), 0);
+	EXPECT_EQ(lock.load().n, 199999u);
+}
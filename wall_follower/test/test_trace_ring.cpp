@@ -0,0 +1,252 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "wall_follower/trace_ring.hpp"
+
+#include "test_helpers.hpp"
+
+
+#define RECORDS_OFFSET	(sizeof(TraceHeader) + TRACE_RULE_NAMES * TRACE_RULE_NAME_SIZE)
+
+static TraceHeader header_of(const std::vector<uint8_t> & data)
+{
+	TraceHeader header;
+	std::memcpy(&header, data.data(), sizeof(header));
+	return header;
+}
+
+static TraceRecord slot_of(const std::vector<uint8_t> & data, size_t i)
+{
+	TraceRecord record;
+	std::memcpy(&record, data.data() + RECORDS_OFFSET + i * sizeof(TraceRecord), sizeof(record));
+	return record;
+}
+
+static TraceRecord make_record(int i)
+{
+	TraceRecord record = {};
+	record.scan_stamp = 1000000000LL + i * 100000000LL;
+	record.cmd_time = record.scan_stamp + 2500000;
+	for (int s = 0; s < NUM_SECTORS; s++)
+		record.sectors[s] = 0.1f * s + i;
+	record.linear = 0.3f;
+	record.angular = -1.5f;
+	record.rule = i % 3;
+	record.flags = TRACE_STEERED;
+	record.decide_ns = 800 + i;
+	return record;
+}
+
+static const std::vector<std::string> rule_names = {"left_front_open", "front_blocked", "path_clear"};
+
+TEST(TraceRing, Layout)
+{
+	TempPath path;
+	TraceRing ring;
+	ASSERT_TRUE(ring.open(path.str(), 8, rule_names)) << ring.error();
+	ring.write(make_record(0));
+	ring.close();
+
+	std::vector<uint8_t> data = read_file(path.str());
+	ASSERT_EQ(data.size(), RECORDS_OFFSET + 8 * sizeof(TraceRecord));
+	TraceHeader header = header_of(data);
+	EXPECT_EQ(std::memcmp(header.magic, "WFTR", 4), 0);
+	EXPECT_EQ(header.version, (uint32_t) TRACE_RING_VERSION);
+	EXPECT_EQ(header.record_size, 128u);
+	EXPECT_EQ(header.capacity, 8u);
+	EXPECT_EQ(header.num_sectors, (uint32_t) NUM_SECTORS);
+	EXPECT_EQ(header.num_rules, 3u);
+	EXPECT_EQ(header.runs, 1u);
+	EXPECT_GT(header.created, 0);
+
+	for (size_t i = 0; i < rule_names.size(); i++)
+		EXPECT_STREQ(reinterpret_cast<const char *>(data.data() + sizeof(TraceHeader) + i * TRACE_RULE_NAME_SIZE),
+			rule_names[i].c_str());
+
+	TraceRecord record = slot_of(data, 0);
+	TraceRecord expected = make_record(0);
+	EXPECT_EQ(record.seq, 1u);
+	EXPECT_EQ(record.run, 1u);
+	EXPECT_EQ(record.scan_stamp, expected.scan_stamp);
+	EXPECT_EQ(record.cmd_time, expected.cmd_time);
+	EXPECT_EQ(record.sectors[LEFT], expected.sectors[LEFT]);
+	EXPECT_EQ(record.angular, expected.angular);
+	EXPECT_EQ(record.rule, expected.rule);
+	EXPECT_EQ(record.decide_ns, expected.decide_ns);
+	EXPECT_EQ(slot_of(data, 1).seq, 0u);
+}
+
+TEST(TraceRing, WrapsAround)
+{
+	TempPath path;
+	TraceRing ring;
+	ASSERT_TRUE(ring.open(path.str(), 8, rule_names));
+	for (int i = 0; i < 19; i++)
+		ring.write(make_record(i));
+	EXPECT_EQ(ring.written(), 19u);
+	ring.close();
+
+	// Seq s goes in slot (s - 1) % capacity, so slots 0 .. 2 hold 17 .. 19
+	std::vector<uint8_t> data = read_file(path.str());
+	for (size_t i = 0; i < 8; i++)
+	{
+		uint64_t seq = i < 3 ? 17 + i : 9 + i;
+		TraceRecord record = slot_of(data, i);
+		EXPECT_EQ(record.seq, seq) << "slot " << i;
+		EXPECT_EQ(record.decide_ns, 800u + seq - 1) << "slot " << i;
+	}
+}
+
+TEST(TraceRing, ReopenCarriesOn)
+{
+	TempPath path;
+	{
+		TraceRing ring;
+		ASSERT_TRUE(ring.open(path.str(), 8, rule_names));
+		for (int i = 0; i < 5; i++)
+			ring.write(make_record(i));
+	}
+
+	TraceRing ring;
+	ASSERT_TRUE(ring.open(path.str(), 8, rule_names));
+	EXPECT_EQ(ring.written(), 5u);
+	ring.write(make_record(5));
+	ring.close();
+
+	std::vector<uint8_t> data = read_file(path.str());
+	EXPECT_EQ(header_of(data).runs, 2u);
+	EXPECT_EQ(slot_of(data, 4).run, 1u);
+	EXPECT_EQ(slot_of(data, 5).seq, 6u);
+	EXPECT_EQ(slot_of(data, 5).run, 2u);
+}
+
+TEST(TraceRing, SkipsTornRecordOnReopen)
+{
+	TempPath path;
+	{
+		TraceRing ring;
+		ASSERT_TRUE(ring.open(path.str(), 8, rule_names));
+		for (int i = 0; i < 5; i++)
+			ring.write(make_record(i));
+	}
+
+	// Clear the seq of the newest record, as a crash mid-write would leave it
+	std::vector<uint8_t> data = read_file(path.str());
+	std::memset(data.data() + RECORDS_OFFSET + 4 * sizeof(TraceRecord), 0, sizeof(uint64_t));
+	write_file(path.str(), data);
+
+	TraceRing ring;
+	ASSERT_TRUE(ring.open(path.str(), 8, rule_names));
+	EXPECT_EQ(ring.written(), 4u);
+}
+
+TEST(TraceRing, ResetsWhenLayoutOrRulesChange)
+{
+	TempPath path;
+	{
+		TraceRing ring;
+		ASSERT_TRUE(ring.open(path.str(), 8, rule_names));
+		ring.write(make_record(0));
+	}
+	{
+		TraceRing ring;
+		ASSERT_TRUE(ring.open(path.str(), 16, rule_names));
+		EXPECT_EQ(ring.written(), 0u) << "capacity changed";
+		ring.write(make_record(0));
+	}
+	{
+		TraceRing ring;
+		ASSERT_TRUE(ring.open(path.str(), 16, {"left_front_open", "path_clear"}));
+		EXPECT_EQ(ring.written(), 0u) << "rules changed";
+		ring.write(make_record(0));
+	}
+	TraceRing ring;
+	ASSERT_TRUE(ring.open(path.str(), 16, {"left_front_open", "path_clear"}));
+	EXPECT_EQ(ring.written(), 1u);
+	ring.close();
+	EXPECT_EQ(header_of(read_file(path.str())).runs, 2u);
+}
+
+TEST(TraceRing, CutsLongRuleNames)
+{
+	TempPath path;
+	std::vector<std::string> names(TRACE_RULE_NAMES + 3, std::string(40, 'r'));
+	TraceRing ring;
+	ASSERT_TRUE(ring.open(path.str(), 8, names));
+	ring.close();
+
+	std::vector<uint8_t> data = read_file(path.str());
+	EXPECT_EQ(header_of(data).num_rules, (uint32_t) TRACE_RULE_NAMES);
+	const char * first = reinterpret_cast<const char *>(data.data() + sizeof(TraceHeader));
+	EXPECT_EQ(std::string(first), std::string(TRACE_RULE_NAME_SIZE - 1, 'r'));
+}
+
+// test/data/trace_v2.bin, decoded by test_decode_trace.py: six ticks in a
+// ring of four, so the first two have been overwritten
+static const int fixture_rules[6] = {0, 1, 2, -3, -4, 1};
+
+static TraceRecord fixture_record(int i)
+{
+	TraceRecord record = {};
+	record.flags = TRACE_STEERED | (i % 2 ? TRACE_EXPLORING : 0);
+	record.scan_stamp = 1000000000LL + i * 100000000LL;
+	record.cmd_time = record.scan_stamp + 2500000;
+	for (int s = 0; s < NUM_SECTORS; s++)
+		record.sectors[s] = 0.25f * s + i;
+	record.x = 0.5f * i;
+	record.y = -1.0f * i;
+	record.yaw = 0.25f;
+	record.odom_linear = 0.2f;
+	record.odom_angular = 0.5f;
+	record.linear = 0.3f;
+	record.angular = -1.5f;
+	record.rule = fixture_rules[i];
+	record.decide_ns = 800 + i;
+	return record;
+}
+
+TEST(TraceRing, MatchesDecoderFixture)
+{
+	TempPath path;
+	TraceRing ring;
+	ASSERT_TRUE(ring.open(path.str(), 4, rule_names));
+	for (int i = 0; i < 6; i++)
+		ring.write(fixture_record(i));
+	ring.close();
+
+	std::vector<uint8_t> data = read_file(path.str());
+	std::vector<uint8_t> fixture = read_file(TEST_DATA_DIR "/trace_v2.bin");
+	ASSERT_EQ(data.size(), fixture.size());
+	// Everything but the creation time
+	const size_t created = offsetof(TraceHeader, created);
+	std::memset(data.data() + created, 0, sizeof(int64_t));
+	std::memset(fixture.data() + created, 0, sizeof(int64_t));
+	EXPECT_TRUE(data == fixture);
+}
+
+TEST(TraceRing, ReportsOpenErrors)
+{
+	TraceRing ring;
+	EXPECT_FALSE(ring.open("/nonexistent/wall_follower/trace.bin", 8));
+	EXPECT_FALSE(ring.is_open());
+	EXPECT_FALSE(ring.error().empty());
+	// Writing to a closed ring is ignored
+	ring.write(make_record(0));
+	EXPECT_EQ(ring.written(), 0u);
+}
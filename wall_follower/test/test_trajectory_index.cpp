@@ -0,0 +1,117 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "wall_follower/trajectory_index.hpp"
+
+
+TEST(TrajectoryIndex, ParsesRevisitPolicies)
+{
+	RevisitPolicy policy = RevisitPolicy::LOG;
+	EXPECT_TRUE(parse_revisit_policy("start", policy));
+	EXPECT_EQ(policy, RevisitPolicy::START);
+	EXPECT_TRUE(parse_revisit_policy("any", policy));
+	EXPECT_EQ(policy, RevisitPolicy::ANY);
+	EXPECT_TRUE(parse_revisit_policy("log", policy));
+	EXPECT_EQ(policy, RevisitPolicy::LOG);
+	EXPECT_TRUE(parse_revisit_policy("explore", policy));
+	EXPECT_EQ(policy, RevisitPolicy::EXPLORE);
+	EXPECT_FALSE(parse_revisit_policy("Explore", policy));
+	EXPECT_EQ(policy, RevisitPolicy::EXPLORE);
+}
+
+TEST(TrajectoryIndex, RecordsEverySpacing)
+{
+	TrajectoryIndex index;
+	EXPECT_TRUE(index.add(0.0, 0.0));
+	EXPECT_FALSE(index.add(0.01, 0.0));
+	EXPECT_FALSE(index.add(0.04, 0.0));
+	EXPECT_TRUE(index.add(0.06, 0.0));
+	EXPECT_TRUE(index.add(0.06, 0.1));
+	ASSERT_EQ(index.size(), 3u);
+	EXPECT_NEAR(index.distance(), 0.16, 1e-12);
+	EXPECT_NEAR(index.pose(2).distance, 0.16, 1e-12);
+	EXPECT_EQ(index.pose(1).x, 0.06);
+
+	index.clear();
+	EXPECT_EQ(index.size(), 0u);
+	EXPECT_EQ(index.distance(), 0.0);
+}
+
+TEST(TrajectoryIndex, FindsOnlyOldPositions)
+{
+	// 5 m along x and back along y = 0.1
+	TrajectoryIndex index;
+	for (int i = 0; i <= 100; i++)
+		index.add(i * 0.05, 0.0);
+	EXPECT_EQ(index.find_visited(4.95, 0.05, REVISIT_RADIUS, REVISIT_GAP), -1) << "driven too recently";
+	for (int i = 100; i >= 0; i--)
+		index.add(i * 0.05, 0.1);
+
+	long i = index.find_visited(1.0, 0.05, REVISIT_RADIUS, REVISIT_GAP);
+	ASSERT_GE(i, 0);
+	EXPECT_NEAR(index.pose(i).x, 1.0, 0.05);
+	EXPECT_LE(index.pose(i).distance, index.distance() - REVISIT_GAP);
+
+	// Less than the gap driven in total, and nothing driven far away
+	TrajectoryIndex recent;
+	for (int i = 0; i <= 20; i++)
+		recent.add(i * 0.05, 0.0);
+	EXPECT_EQ(recent.find_visited(1.0, 0.0, REVISIT_RADIUS, REVISIT_GAP), -1);
+	EXPECT_EQ(index.find_visited(10.0, 10.0, REVISIT_RADIUS, 0.0), -1);
+}
+
+TEST(TrajectoryIndex, MatchesBruteForce)
+{
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<double> turn(-0.5, 0.5);
+	std::uniform_real_distribution<double> place(-4.0, 4.0);
+	TrajectoryIndex index;
+	double x = 0.0, y = 0.0, heading = 0.0;
+	for (int k = 0; k < 5000; k++)
+	{
+		heading += turn(rng);
+		x += 0.02 * std::cos(heading);
+		y += 0.02 * std::sin(heading);
+		index.add(x, y);
+	}
+
+	for (int q = 0; q < 500; q++)
+	{
+		double qx = place(rng), qy = place(rng);
+		long expected = -1;
+		double best = REVISIT_RADIUS * REVISIT_RADIUS;
+		for (size_t i = 0; i < index.size(); i++)
+		{
+			const TrajectoryPose & pose = index.pose(i);
+			double d2 = (pose.x - qx) * (pose.x - qx) + (pose.y - qy) * (pose.y - qy);
+			if (pose.distance <= index.distance() - REVISIT_GAP && d2 <= best)
+			{
+				best = d2;
+				expected = (long) i;
+			}
+		}
+		long found = index.find_visited(qx, qy, REVISIT_RADIUS, REVISIT_GAP);
+		if (expected < 0)
+		{
+			EXPECT_EQ(found, -1);
+			continue;
+		}
+		ASSERT_GE(found, 0);
+		const TrajectoryPose & pose = index.pose(found);
+		EXPECT_DOUBLE_EQ((pose.x - qx) * (pose.x - qx) + (pose.y - qy) * (pose.y - qy), best);
+	}
+}
@@ -0,0 +1,172 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "wall_follower/wall_controller.hpp"
+
+#include "test_helpers.hpp"
+
+
+// A straight wall on the left, distance metres away, with the robot heading
+// towards it by angle radians
+static std::vector<float> left_wall(double distance, double angle)
+{
+	std::vector<float> ranges(360, std::numeric_limits<float>::infinity());
+	for (int a = 1; a < 180; a++)
+	{
+		double s = std::sin(a * DEG2RAD + angle);
+		if (s > 0.0)
+			ranges[a] = (float) (distance / s);
+	}
+	return ranges;
+}
+
+TEST(WallController, GainTable)
+{
+	WallController controller;
+	const WallConfig & config = controller.config();
+	const double dv = config.max_linear / GAIN_TABLE_SIZE;
+
+	// kp = v / lookahead^2 and kd = 2 damping v / lookahead at the upper
+	// edge of each speed bin
+	for (int i = 0; i < GAIN_TABLE_SIZE; i++)
+	{
+		double v = (i + 1) * dv;
+		const WallGains & g = controller.gains(i * dv + 0.5 * dv);
+		EXPECT_NEAR(g.kp, v / (config.lookahead * config.lookahead), 1e-12) << "bin " << i;
+		EXPECT_NEAR(g.kd, 2.0 * config.damping * v / config.lookahead, 1e-12) << "bin " << i;
+		EXPECT_NEAR(g.ki, config.integral_ratio * g.kp, 1e-12) << "bin " << i;
+	}
+	// Out of range speeds use the end bins
+	EXPECT_EQ(&controller.gains(-1.0), &controller.gains(0.0));
+	EXPECT_EQ(&controller.gains(10.0), &controller.gains(config.max_linear));
+}
+
+TEST(WallController, FitsParallelWall)
+{
+	WallController controller;
+	ScanGeometry geometry = lidar();
+	std::vector<float> ranges = left_wall(0.5, 0.0);
+	double linear, angular;
+	// fit() uses the beam window that control() sets up for the geometry
+	ASSERT_TRUE(controller.control(geometry, ranges.data(), RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+
+	WallFit wall;
+	ASSERT_TRUE(controller.fit(ranges.data(), RANGE_MIN, RANGE_MAX, wall));
+	EXPECT_NEAR(wall.distance, 0.5, 1e-3);
+	EXPECT_NEAR(wall.angle, 0.0, 1e-3);
+	EXPECT_GE(wall.points, controller.config().min_points);
+}
+
+TEST(WallController, FitsAngledWall)
+{
+	WallController controller;
+	double linear, angular;
+	for (double angle : {-0.3, -0.1, 0.2, 0.4})
+	{
+		std::vector<float> ranges = left_wall(0.5, angle);
+		ASSERT_TRUE(controller.control(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+		WallFit wall;
+		ASSERT_TRUE(controller.fit(ranges.data(), RANGE_MIN, RANGE_MAX, wall)) << "angle " << angle;
+		EXPECT_NEAR(wall.distance, 0.5, 1e-3) << "angle " << angle;
+		EXPECT_NEAR(wall.angle, angle, 1e-3) << "angle " << angle;
+	}
+}
+
+TEST(WallController, HoldsTheTargetDistance)
+{
+	WallController controller;
+	const WallConfig & config = controller.config();
+	double linear, angular;
+
+	std::vector<float> on_target = left_wall(config.target, 0.0);
+	ASSERT_TRUE(controller.control(lidar(), on_target.data(), RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+	EXPECT_NEAR(angular, 0.0, 1e-3);
+	EXPECT_NEAR(linear, config.max_linear, 1e-3);
+
+	// Too far from the wall: turn towards it, too close: turn away
+	controller.configure(config);
+	std::vector<float> far = left_wall(config.target + 0.2, 0.0);
+	ASSERT_TRUE(controller.control(lidar(), far.data(), RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+	EXPECT_GT(angular, 0.0);
+
+	controller.configure(config);
+	std::vector<float> near = left_wall(config.target - 0.15, 0.0);
+	ASSERT_TRUE(controller.control(lidar(), near.data(), RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+	EXPECT_LT(angular, 0.0);
+
+	// Heading into the wall at the target distance: turn away
+	controller.configure(config);
+	std::vector<float> towards = left_wall(config.target, 0.3);
+	ASSERT_TRUE(controller.control(lidar(), towards.data(), RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+	EXPECT_LT(angular, 0.0);
+	EXPECT_LT(linear, config.max_linear);
+}
+
+TEST(WallController, TurnsOnTheSpotWhenBlocked)
+{
+	WallController controller;
+	std::vector<float> ranges = left_wall(controller.config().target, 0.0);
+	for (int a = -20; a <= 20; a++)
+		ranges[(a + 360) % 360] = 0.25f;
+	double linear, angular;
+	ASSERT_TRUE(controller.control(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+	EXPECT_EQ(linear, 0.0);
+	EXPECT_EQ(angular, -controller.config().max_angular);
+}
+
+TEST(WallController, ArcsLeftWithoutAWall)
+{
+	WallController controller;
+	std::vector<float> ranges(360, std::numeric_limits<float>::infinity());
+	double linear, angular;
+	ASSERT_TRUE(controller.control(lidar(), ranges.data(), RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+	EXPECT_EQ(linear, controller.config().lost_linear);
+	EXPECT_EQ(angular, controller.config().lost_angular);
+
+	WallFit wall;
+	EXPECT_FALSE(controller.fit(ranges.data(), RANGE_MIN, RANGE_MAX, wall));
+	EXPECT_EQ(wall.points, 0);
+}
+
+TEST(WallController, IntegralIsBounded)
+{
+	WallController controller;
+	const WallConfig & config = controller.config();
+	std::vector<float> far = left_wall(config.target + 0.1, 0.0);
+	double linear, angular, first = 0.0;
+	for (int k = 0; k < 200; k++)
+	{
+		ASSERT_TRUE(controller.control(lidar(), far.data(), RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+		if (k == 0)
+			first = angular;
+	}
+	// Clear ahead, so always at full speed. The integral adds at most
+	// ki * integral_limit to the first command.
+	const WallGains & g = controller.gains(config.max_linear);
+	EXPECT_GT(angular, first);
+	EXPECT_LE(angular, first + g.ki * config.integral_limit + 1e-9);
+}
+
+TEST(WallController, RejectsUnusableGeometry)
+{
+	WallController controller;
+	ScanGeometry geometry = lidar();
+	geometry.angle_increment = 0.0;
+	double linear, angular;
+	EXPECT_FALSE(controller.control(geometry, nullptr, RANGE_MIN, RANGE_MAX, 0.1, linear, angular));
+}
@@ -32,33 +32,124 @@ marker_colour = [
 
 max_markers = len(marker_type)
 
-class Landmark:
+# Chi-square 99% point for 2 degrees of freedom
+gate_99 = 9.21
 
-	def __init__(self, mtype, markers):
+class Landmark:
+	"""
+	Position estimate of one marker, in constant memory.
+
+	The first observations are averaged with Welford's algorithm. From
+	1/alpha observations on, it becomes an exponentially weighted mean and
+	covariance, so early bad readings are forgotten. Once min_count
+	observations are in, an observation whose squared Mahalanobis distance
+	from the estimate exceeds gate is rejected. After max_rejects rejections
+	in a row the landmark is assumed to have been badly initialised and
+	starts again.
+	"""
+
+	def __init__(self, mtype, markers, alpha=0.05, gate=gate_99, min_count=5, max_rejects=10,
+			min_sigma=0.05, min_change=0.01):
 		self.mtype = mtype
-		self.count = 0;
-		self.sum_x = 0.0
-		self.sum_y = 0.0
+		self.alpha = alpha
+		self.gate = gate
+		self.min_count = min_count
+		self.max_rejects = max_rejects
+		self.min_var = min_sigma * min_sigma	# observation noise floor, m^2
+		self.min_change = min_change			# metres before the markers are moved
 		self.top_marker = None
 		self.bottom_marker = None
 		self.markers = markers
+		self.reset()
 
 
-	def update_position(self, new_point):
-		if self.count == 0:
+	def reset(self):
+		self.count = 0;
+		self.rejects = 0
+		self.mean_x = 0.0
+		self.mean_y = 0.0
+		self.var_xx = 0.0
+		self.var_xy = 0.0
+		self.var_yy = 0.0
+
+
+	def snapshot(self):
+		return (self.count, self.mean_x, self.mean_y, self.var_xx, self.var_xy, self.var_yy)
+
+
+	def restore(self, count, x, y, cov_xx, cov_xy, cov_yy):
+		"""Start from a saved estimate, e.g. from a LandmarkStore"""
+		self.reset()
+		self.count = count
+		self.mean_x = x
+		self.mean_y = y
+		self.var_xx = cov_xx
+		self.var_xy = cov_xy
+		self.var_yy = cov_yy
+		if self.top_marker is None:
 			self.add_marker()
+		for marker in self.markers_of():
+			marker.pose.position.x = x
+			marker.pose.position.y = y
 
-		self.count += 1
-		self.sum_x += new_point.x
-		self.sum_y += new_point.y
 
-		new_x = self.sum_x/self.count
-		new_y = self.sum_y/self.count
+	@property
+	def covariance(self):
+		return ((self.var_xx, self.var_xy), (self.var_xy, self.var_yy))
+
 
-		self.top_marker.pose.position.x = new_x
-		self.top_marker.pose.position.y = new_y
-		self.bottom_marker.pose.position.x = new_x
-		self.bottom_marker.pose.position.y = new_y
+	def mahalanobis2(self, x, y):
+		dx = x - self.mean_x
+		dy = y - self.mean_y
+		a = self.var_xx + self.min_var
+		b = self.var_xy
+		d = self.var_yy + self.min_var
+		det = a*d - b*b
+		return (d*dx*dx - 2.0*b*dx*dy + a*dy*dy)/det
+
+
+	def update_position(self, new_point):
+		"""
+		Add an observation. Returns True if the displayed position changed,
+		False if the observation was rejected or moved it less than
+		min_change.
+		"""
+		if self.count >= self.min_count and self.mahalanobis2(new_point.x, new_point.y) > self.gate:
+			self.rejects += 1
+			if self.rejects < self.max_rejects:
+				return False
+			self.reset()
+
+		if self.count == 0 and self.top_marker is None:
+			self.add_marker()
+
+		self.rejects = 0
+		self.count += 1
+		w = max(1.0/self.count, self.alpha)
+		dx = new_point.x - self.mean_x
+		dy = new_point.y - self.mean_y
+		self.mean_x += w*dx
+		self.mean_y += w*dy
+
+		# Welford / West update, weighted the same way as the mean
+		self.var_xx = (1.0 - w)*(self.var_xx + w*dx*dx)
+		self.var_xy = (1.0 - w)*(self.var_xy + w*dx*dy)
+		self.var_yy = (1.0 - w)*(self.var_yy + w*dy*dy)
+
+		shown_x = self.top_marker.pose.position.x
+		shown_y = self.top_marker.pose.position.y
+		if self.count > 1 and abs(self.mean_x - shown_x) < self.min_change and abs(self.mean_y - shown_y) < self.min_change:
+			return False
+
+		self.top_marker.pose.position.x = self.mean_x
+		self.top_marker.pose.position.y = self.mean_y
+		self.bottom_marker.pose.position.x = self.mean_x
+		self.bottom_marker.pose.position.y = self.mean_y
+		return True
+
+
+	def markers_of(self):
+		return [self.top_marker, self.bottom_marker] if self.top_marker else []
 
 
 	def add_marker(self):
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+
+"""
+Landmark snapshot file, shared with the C++ LandmarkStore
+(include/wall_follower/landmark_store.hpp).
+
+A 16 byte header followed by one fixed 64 byte record per marker type, all
+little-endian:
+
+	header:	char magic[4] = "WFLM", uint32 version, uint32 num_records,
+		uint32 record_size
+	record:	uint32 type, uint32 count, float64 x, y, cov_xx, cov_xy, cov_yy,
+		float64 stamp (s, clock of the writer), uint32 reserved, uint32 crc32 of the first 60 bytes
+
+The file is memory mapped. Only the records of landmarks that changed are
+rewritten, by a background thread, so writing never blocks observation
+handling. A record with a bad CRC (e.g. torn by a crash) is ignored.
+"""
+
+import mmap
+import os
+import struct
+import threading
+import time
+import zlib
+
+MAGIC = b'WFLM'
+VERSION = 1
+HEADER = struct.Struct('<4sIII')
+RECORD = struct.Struct('<II6dI')
+RECORD_SIZE = RECORD.size + 4
+
+
+class LandmarkStore:
+
+	def __init__(self, path, num_records):
+		self.num_records = num_records
+		size = HEADER.size + num_records*RECORD_SIZE
+
+		fd = os.open(path, os.O_RDWR | os.O_CREAT, 0o644)
+		try:
+			fresh = os.fstat(fd).st_size != size
+			if fresh:
+				os.ftruncate(fd, size)
+			self.mm = mmap.mmap(fd, size)
+		finally:
+			os.close(fd)
+
+		if fresh or HEADER.unpack_from(self.mm, 0) != (MAGIC, VERSION, num_records, RECORD_SIZE):
+			self.mm[:] = bytes(size)
+			HEADER.pack_into(self.mm, 0, MAGIC, VERSION, num_records, RECORD_SIZE)
+			self.mm.flush()
+
+		self.lock = threading.Lock()
+		self.pending = {}
+		self.period = None
+		self.wake = threading.Event()
+		self.thread = None
+
+
+	def load(self):
+		"""Valid records as a list of (type, count, x, y, cov_xx, cov_xy, cov_yy)"""
+		records = []
+		for i in range(self.num_records):
+			offset = HEADER.size + i*RECORD_SIZE
+			data = self.mm[offset:offset + RECORD.size]
+			crc, = struct.unpack_from('<I', self.mm, offset + RECORD.size)
+			if crc != zlib.crc32(data):
+				continue
+			mtype, count, x, y, cov_xx, cov_xy, cov_yy, stamp, reserved = RECORD.unpack(data)
+			if count > 0 and mtype == i:
+				records.append((mtype, count, x, y, cov_xx, cov_xy, cov_yy))
+		return records
+
+
+	def update(self, landmark):
+		"""Queue the state of a landmark to be written, cheap enough for any callback"""
+		with self.lock:
+			self.pending[landmark.mtype] = landmark.snapshot() + (time.time(),)
+
+
+	def write_pending(self):
+		with self.lock:
+			pending, self.pending = self.pending, {}
+		if not pending:
+			return
+		for mtype, (count, x, y, cov_xx, cov_xy, cov_yy, stamp) in pending.items():
+			offset = HEADER.size + mtype*RECORD_SIZE
+			RECORD.pack_into(self.mm, offset, mtype, count, x, y, cov_xx, cov_xy, cov_yy, stamp, 0)
+			crc = zlib.crc32(self.mm[offset:offset + RECORD.size])
+			struct.pack_into('<I', self.mm, offset + RECORD.size, crc)
+		self.mm.flush()
+
+
+	def start(self, period):
+		"""Write the queued records every period seconds on a background thread"""
+		self.period = period
+		self.thread = threading.Thread(target=self.writer_loop, daemon=True)
+		self.thread.start()
+
+
+	def writer_loop(self):
+		while not self.wake.wait(self.period):
+			self.write_pending()
+
+
+	def close(self):
+		if self.thread:
+			self.wake.set()
+			self.thread.join()
+			self.thread = None
+		self.write_pending()
+		self.mm.close()